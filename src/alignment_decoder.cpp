@@ -0,0 +1,527 @@
+
+#include "alignment_decoder.hpp"
+
+#include <stdexcept>
+
+#include <google/protobuf/wire_format_lite.h>
+
+using google::protobuf::io::CodedInputStream;
+using google::protobuf::internal::WireFormatLite;
+
+
+static bool readVarint(uint64_t * value, const uint32_t tag, CodedInputStream * input) {
+
+    if (WireFormatLite::GetTagWireType(tag) != WireFormatLite::WIRETYPE_VARINT) {
+
+        return false;
+    }
+
+    return input->ReadVarint64(value);
+}
+
+static bool readString(string * value, const uint32_t tag, CodedInputStream * input) {
+
+    if (WireFormatLite::GetTagWireType(tag) != WireFormatLite::WIRETYPE_LENGTH_DELIMITED) {
+
+        return false;
+    }
+
+    return WireFormatLite::ReadString(input, value);
+}
+
+// Skips a string and returns only its length.
+static bool skipString(uint32_t * length, const uint32_t tag, CodedInputStream * input) {
+
+    if (WireFormatLite::GetTagWireType(tag) != WireFormatLite::WIRETYPE_LENGTH_DELIMITED) {
+
+        return false;
+    }
+
+    return (input->ReadVarint32(length) && input->Skip(static_cast<int>(*length)));
+}
+
+// Reads both packed and non-packed repeated fields.
+static bool readRepeatedUint32(google::protobuf::RepeatedField<uint32_t> * values, const uint32_t tag, CodedInputStream * input) {
+
+    uint64_t value = 0;
+
+    if (WireFormatLite::GetTagWireType(tag) == WireFormatLite::WIRETYPE_LENGTH_DELIMITED) {
+
+        uint32_t length = 0;
+
+        if (!input->ReadVarint32(&length)) {
+
+            return false;
+        }
+
+        auto limit = input->PushLimit(length);
+
+        while (input->BytesUntilLimit() > 0) {
+
+            if (!input->ReadVarint64(&value)) {
+
+                return false;
+            }
+
+            values->Add(value);
+        }
+
+        input->PopLimit(limit);
+        return true;
+    }
+
+    if (!readVarint(&value, tag, input)) {
+
+        return false;
+    }
+
+    values->Add(value);
+    return true;
+}
+
+template<typename DecodeFunc>
+static bool decodeEmbeddedMessage(const uint32_t tag, CodedInputStream * input, DecodeFunc decode_func) {
+
+    uint32_t length = 0;
+
+    if (WireFormatLite::GetTagWireType(tag) != WireFormatLite::WIRETYPE_LENGTH_DELIMITED || !input->ReadVarint32(&length)) {
+
+        return false;
+    }
+
+    auto limit = input->PushLimit(length);
+
+    if (!decode_func()) {
+
+        return false;
+    }
+
+    input->PopLimit(limit);
+    return true;
+}
+
+
+void AlignmentDecoder::decode(vg::Alignment * alignment, uint32_t * sequence_length, const string & serialized_alignment) const {
+
+    alignment->Clear();
+    *sequence_length = 0;
+
+    CodedInputStream input(reinterpret_cast<const uint8_t *>(serialized_alignment.data()), serialized_alignment.size());
+
+    if (!decodeAlignment(alignment, sequence_length, &input)) {
+
+        throw runtime_error("Could not decode " + alignment->GetTypeName());
+    }
+}
+
+void AlignmentDecoder::decode(vg::MultipathAlignment * alignment, uint32_t * sequence_length, const string & serialized_alignment) const {
+
+    alignment->Clear();
+    *sequence_length = 0;
+
+    CodedInputStream input(reinterpret_cast<const uint8_t *>(serialized_alignment.data()), serialized_alignment.size());
+
+    if (!decodeMultipathAlignment(alignment, sequence_length, &input)) {
+
+        throw runtime_error("Could not decode " + alignment->GetTypeName());
+    }
+}
+
+bool AlignmentDecoder::decodeAlignment(vg::Alignment * alignment, uint32_t * sequence_length, CodedInputStream * input) const {
+
+    uint32_t tag = 0;
+    uint64_t value = 0;
+
+    while ((tag = input->ReadTag()) != 0) {
+
+        bool is_valid = true;
+
+        switch (WireFormatLite::GetTagFieldNumber(tag)) {
+
+            case vg::Alignment::kSequenceFieldNumber:
+                is_valid = skipString(sequence_length, tag, input);
+                break;
+
+            case vg::Alignment::kQualityFieldNumber:
+                is_valid = readString(alignment->mutable_quality(), tag, input);
+                break;
+
+            case vg::Alignment::kPathFieldNumber:
+                is_valid = decodeEmbeddedMessage(tag, input, [&]() { return decodePath(alignment->mutable_path(), input); });
+                break;
+
+            case vg::Alignment::kMappingQualityFieldNumber:
+                is_valid = readVarint(&value, tag, input);
+                alignment->set_mapping_quality(value);
+                break;
+
+            case vg::Alignment::kScoreFieldNumber:
+                is_valid = readVarint(&value, tag, input);
+                alignment->set_score(value);
+                break;
+
+            default:
+                is_valid = WireFormatLite::SkipField(input, tag);
+        }
+
+        if (!is_valid) {
+
+            return false;
+        }
+    }
+
+    return input->ConsumedEntireMessage();
+}
+
+bool AlignmentDecoder::decodeMultipathAlignment(vg::MultipathAlignment * alignment, uint32_t * sequence_length, CodedInputStream * input) const {
+
+    uint32_t tag = 0;
+    uint64_t value = 0;
+
+    while ((tag = input->ReadTag()) != 0) {
+
+        bool is_valid = true;
+
+        switch (WireFormatLite::GetTagFieldNumber(tag)) {
+
+            case vg::MultipathAlignment::kSequenceFieldNumber:
+                is_valid = skipString(sequence_length, tag, input);
+                break;
+
+            case vg::MultipathAlignment::kQualityFieldNumber:
+                is_valid = readString(alignment->mutable_quality(), tag, input);
+                break;
+
+            case vg::MultipathAlignment::kSubpathFieldNumber:
+                is_valid = decodeEmbeddedMessage(tag, input, [&]() { return decodeSubpath(alignment->add_subpath(), input); });
+                break;
+
+            case vg::MultipathAlignment::kMappingQualityFieldNumber:
+                is_valid = readVarint(&value, tag, input);
+                alignment->set_mapping_quality(value);
+                break;
+
+            case vg::MultipathAlignment::kStartFieldNumber:
+                is_valid = readRepeatedUint32(alignment->mutable_start(), tag, input);
+                break;
+
+            case vg::MultipathAlignment::kAnnotationFieldNumber:
+                is_valid = decodeEmbeddedMessage(tag, input, [&]() { return decodeAnnotation(alignment->mutable_annotation(), input); });
+                break;
+
+            default:
+                is_valid = WireFormatLite::SkipField(input, tag);
+        }
+
+        if (!is_valid) {
+
+            return false;
+        }
+    }
+
+    return input->ConsumedEntireMessage();
+}
+
+bool AlignmentDecoder::decodeSubpath(vg::Subpath * subpath, CodedInputStream * input) const {
+
+    uint32_t tag = 0;
+    uint64_t value = 0;
+
+    while ((tag = input->ReadTag()) != 0) {
+
+        bool is_valid = true;
+
+        switch (WireFormatLite::GetTagFieldNumber(tag)) {
+
+            case vg::Subpath::kPathFieldNumber:
+                is_valid = decodeEmbeddedMessage(tag, input, [&]() { return decodePath(subpath->mutable_path(), input); });
+                break;
+
+            case vg::Subpath::kNextFieldNumber:
+                is_valid = readRepeatedUint32(subpath->mutable_next(), tag, input);
+                break;
+
+            case vg::Subpath::kScoreFieldNumber:
+                is_valid = readVarint(&value, tag, input);
+                subpath->set_score(value);
+                break;
+
+            case vg::Subpath::kConnectionFieldNumber:
+                is_valid = decodeEmbeddedMessage(tag, input, [&]() { return decodeConnection(subpath->add_connection(), input); });
+                break;
+
+            default:
+                is_valid = WireFormatLite::SkipField(input, tag);
+        }
+
+        if (!is_valid) {
+
+            return false;
+        }
+    }
+
+    return input->ConsumedEntireMessage();
+}
+
+bool AlignmentDecoder::decodeConnection(vg::Connection * connection, CodedInputStream * input) const {
+
+    uint32_t tag = 0;
+    uint64_t value = 0;
+
+    while ((tag = input->ReadTag()) != 0) {
+
+        bool is_valid = true;
+
+        switch (WireFormatLite::GetTagFieldNumber(tag)) {
+
+            case vg::Connection::kNextFieldNumber:
+                is_valid = readVarint(&value, tag, input);
+                connection->set_next(value);
+                break;
+
+            case vg::Connection::kScoreFieldNumber:
+                is_valid = readVarint(&value, tag, input);
+                connection->set_score(value);
+                break;
+
+            default:
+                is_valid = WireFormatLite::SkipField(input, tag);
+        }
+
+        if (!is_valid) {
+
+            return false;
+        }
+    }
+
+    return input->ConsumedEntireMessage();
+}
+
+bool AlignmentDecoder::decodePath(vg::Path * path, CodedInputStream * input) const {
+
+    uint32_t tag = 0;
+
+    while ((tag = input->ReadTag()) != 0) {
+
+        bool is_valid = true;
+
+        if (WireFormatLite::GetTagFieldNumber(tag) == vg::Path::kMappingFieldNumber) {
+
+            is_valid = decodeEmbeddedMessage(tag, input, [&]() { return decodeMapping(path->add_mapping(), input); });
+
+        } else {
+
+            is_valid = WireFormatLite::SkipField(input, tag);
+        }
+
+        if (!is_valid) {
+
+            return false;
+        }
+    }
+
+    return input->ConsumedEntireMessage();
+}
+
+bool AlignmentDecoder::decodeMapping(vg::Mapping * mapping, CodedInputStream * input) const {
+
+    uint32_t tag = 0;
+
+    while ((tag = input->ReadTag()) != 0) {
+
+        bool is_valid = true;
+
+        switch (WireFormatLite::GetTagFieldNumber(tag)) {
+
+            case vg::Mapping::kPositionFieldNumber:
+                is_valid = decodeEmbeddedMessage(tag, input, [&]() { return decodePosition(mapping->mutable_position(), input); });
+                break;
+
+            case vg::Mapping::kEditFieldNumber:
+                is_valid = decodeEmbeddedMessage(tag, input, [&]() { return decodeEdit(mapping->add_edit(), input); });
+                break;
+
+            default:
+                is_valid = WireFormatLite::SkipField(input, tag);
+        }
+
+        if (!is_valid) {
+
+            return false;
+        }
+    }
+
+    return input->ConsumedEntireMessage();
+}
+
+bool AlignmentDecoder::decodePosition(vg::Position * position, CodedInputStream * input) const {
+
+    uint32_t tag = 0;
+    uint64_t value = 0;
+
+    while ((tag = input->ReadTag()) != 0) {
+
+        bool is_valid = true;
+
+        switch (WireFormatLite::GetTagFieldNumber(tag)) {
+
+            case vg::Position::kNodeIdFieldNumber:
+                is_valid = readVarint(&value, tag, input);
+                position->set_node_id(value);
+                break;
+
+            case vg::Position::kOffsetFieldNumber:
+                is_valid = readVarint(&value, tag, input);
+                position->set_offset(value);
+                break;
+
+            case vg::Position::kIsReverseFieldNumber:
+                is_valid = readVarint(&value, tag, input);
+                position->set_is_reverse(value != 0);
+                break;
+
+            default:
+                is_valid = WireFormatLite::SkipField(input, tag);
+        }
+
+        if (!is_valid) {
+
+            return false;
+        }
+    }
+
+    return input->ConsumedEntireMessage();
+}
+
+bool AlignmentDecoder::decodeEdit(vg::Edit * edit, CodedInputStream * input) const {
+
+    uint32_t tag = 0;
+    uint64_t value = 0;
+
+    while ((tag = input->ReadTag()) != 0) {
+
+        bool is_valid = true;
+
+        switch (WireFormatLite::GetTagFieldNumber(tag)) {
+
+            case vg::Edit::kFromLengthFieldNumber:
+                is_valid = readVarint(&value, tag, input);
+                edit->set_from_length(value);
+                break;
+
+            case vg::Edit::kToLengthFieldNumber:
+                is_valid = readVarint(&value, tag, input);
+                edit->set_to_length(value);
+                break;
+
+            default:
+                is_valid = WireFormatLite::SkipField(input, tag);
+        }
+
+        if (!is_valid) {
+
+            return false;
+        }
+    }
+
+    return input->ConsumedEntireMessage();
+}
+
+bool AlignmentDecoder::decodeAnnotation(google::protobuf::Struct * annotation, CodedInputStream * input) const {
+
+    uint32_t tag = 0;
+
+    while ((tag = input->ReadTag()) != 0) {
+
+        bool is_valid = true;
+
+        if (WireFormatLite::GetTagFieldNumber(tag) == google::protobuf::Struct::kFieldsFieldNumber) {
+
+            is_valid = decodeEmbeddedMessage(tag, input, [&]() { return decodeAnnotationField(annotation, input); });
+
+        } else {
+
+            is_valid = WireFormatLite::SkipField(input, tag);
+        }
+
+        if (!is_valid) {
+
+            return false;
+        }
+    }
+
+    return input->ConsumedEntireMessage();
+}
+
+// Decodes a map entry (key = 1, value = 2) of the annotation and keeps
+// it only if it is the "disconnected" flag.
+bool AlignmentDecoder::decodeAnnotationField(google::protobuf::Struct * annotation, CodedInputStream * input) const {
+
+    string key;
+
+    bool has_bool_value = false;
+    bool bool_value = false;
+
+    uint32_t tag = 0;
+
+    while ((tag = input->ReadTag()) != 0) {
+
+        bool is_valid = true;
+
+        switch (WireFormatLite::GetTagFieldNumber(tag)) {
+
+            case 1:
+                is_valid = readString(&key, tag, input);
+                break;
+
+            case 2:
+                is_valid = decodeEmbeddedMessage(tag, input, [&]() { return decodeBoolValue(&has_bool_value, &bool_value, input); });
+                break;
+
+            default:
+                is_valid = WireFormatLite::SkipField(input, tag);
+        }
+
+        if (!is_valid) {
+
+            return false;
+        }
+    }
+
+    if (key == "disconnected" && has_bool_value) {
+
+        (*annotation->mutable_fields())[key].set_bool_value(bool_value);
+    }
+
+    return input->ConsumedEntireMessage();
+}
+
+bool AlignmentDecoder::decodeBoolValue(bool * has_bool_value, bool * bool_value, CodedInputStream * input) const {
+
+    uint32_t tag = 0;
+    uint64_t value = 0;
+
+    while ((tag = input->ReadTag()) != 0) {
+
+        bool is_valid = true;
+
+        if (WireFormatLite::GetTagFieldNumber(tag) == google::protobuf::Value::kBoolValueFieldNumber) {
+
+            is_valid = readVarint(&value, tag, input);
+
+            *has_bool_value = true;
+            *bool_value = (value != 0);
+
+        } else {
+
+            is_valid = WireFormatLite::SkipField(input, tag);
+        }
+
+        if (!is_valid) {
+
+            return false;
+        }
+    }
+
+    return input->ConsumedEntireMessage();
+}
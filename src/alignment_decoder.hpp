@@ -0,0 +1,48 @@
+
+#ifndef RPVG_SRC_ALIGNMENTDECODER_HPP
+#define RPVG_SRC_ALIGNMENTDECODER_HPP
+
+#include <string>
+
+#include <google/protobuf/io/coded_stream.h>
+#include <google/protobuf/struct.pb.h>
+
+#include "vg/io/basic_stream.hpp"
+
+using namespace std;
+
+
+// Decodes serialized alignments directly from the protobuf wire format.
+// Only the fields used by AlignmentPathFinder are decoded; names, edit
+// sequences and annotations other than "disconnected" are skipped. The
+// read sequence is also skipped and only its length is returned.
+class AlignmentDecoder {
+
+    public:
+
+        // Decoded messages are cleared first, which allows reusing their
+        // memory between alignments. Throws runtime_error if the alignment
+        // is malformed.
+        void decode(vg::Alignment * alignment, uint32_t * sequence_length, const string & serialized_alignment) const;
+        void decode(vg::MultipathAlignment * alignment, uint32_t * sequence_length, const string & serialized_alignment) const;
+
+    private:
+
+        bool decodeAlignment(vg::Alignment * alignment, uint32_t * sequence_length, google::protobuf::io::CodedInputStream * input) const;
+        bool decodeMultipathAlignment(vg::MultipathAlignment * alignment, uint32_t * sequence_length, google::protobuf::io::CodedInputStream * input) const;
+
+        bool decodeSubpath(vg::Subpath * subpath, google::protobuf::io::CodedInputStream * input) const;
+        bool decodeConnection(vg::Connection * connection, google::protobuf::io::CodedInputStream * input) const;
+
+        bool decodePath(vg::Path * path, google::protobuf::io::CodedInputStream * input) const;
+        bool decodeMapping(vg::Mapping * mapping, google::protobuf::io::CodedInputStream * input) const;
+        bool decodePosition(vg::Position * position, google::protobuf::io::CodedInputStream * input) const;
+        bool decodeEdit(vg::Edit * edit, google::protobuf::io::CodedInputStream * input) const;
+
+        bool decodeAnnotation(google::protobuf::Struct * annotation, google::protobuf::io::CodedInputStream * input) const;
+        bool decodeAnnotationField(google::protobuf::Struct * annotation, google::protobuf::io::CodedInputStream * input) const;
+        bool decodeBoolValue(bool * has_bool_value, bool * bool_value, google::protobuf::io::CodedInputStream * input) const;
+};
+
+
+#endif
@@ -220,13 +220,13 @@ AlignmentStats::AlignmentStats() {
     internal_end_next_node = gbwt::ENDMARKER;
 }
 
-void AlignmentStats::updateLeftSoftclipLength(const vg::Path & path) {
+void AlignmentStats::updateLeftSoftclipLength(const PathView & path) {
 
-    auto mapping_it = path.mapping().cbegin();
-    assert(mapping_it != path.mapping().cend());
+    assert(path.mappingSize() > 0);
+    const MappingView first_mapping = path.mapping(0);
 
-    assert(mapping_it->edit_size() > 0);
-    const vg::Edit & first_edit = mapping_it->edit(0);
+    assert(first_mapping.editSize() > 0);
+    const vg::Edit & first_edit = first_mapping.edit(0);
 
     if (first_edit.from_length() == 0) {
 
@@ -238,13 +238,13 @@ void AlignmentStats::updateLeftSoftclipLength(const vg::Path & path) {
     } 
 }
 
-void AlignmentStats::updateRightSoftclipLength(const vg::Path & path) {
+void AlignmentStats::updateRightSoftclipLength(const PathView & path) {
 
-    auto mapping_rit = path.mapping().rbegin();
-    assert(mapping_rit != path.mapping().rend());   
+    assert(path.mappingSize() > 0);
+    const MappingView last_mapping = path.mapping(path.mappingSize() - 1);
 
-    assert(mapping_rit->edit_size() > 0);
-    const vg::Edit & last_edit = mapping_rit->edit(mapping_rit->edit_size() - 1);
+    assert(last_mapping.editSize() > 0);
+    const vg::Edit & last_edit = last_mapping.edit(last_mapping.editSize() - 1);
 
     if (last_edit.from_length() == 0) {
 
@@ -375,8 +375,37 @@ ostream & operator<<(ostream & os, const AlignmentStats & read_align_stats) {
 }
 
 
+const uint32_t SearchPathArena::no_node_idx = numeric_limits<uint32_t>::max();
+
+uint32_t SearchPathArena::addNode(const uint32_t prev_node_idx, const gbwt::node_type node) {
+
+    assert(prev_node_idx == no_node_idx || prev_node_idx < nodes.size());
+    assert(nodes.size() < no_node_idx);
+
+    nodes.emplace_back(prev_node_idx, node);
+    return (nodes.size() - 1);
+}
+
+void SearchPathArena::getPath(vector<gbwt::node_type> * path, const uint32_t last_node_idx) const {
+
+    const uint32_t path_start_idx = path->size();
+    uint32_t cur_node_idx = last_node_idx;
+
+    while (cur_node_idx != no_node_idx) {
+
+        path->emplace_back(nodes.at(cur_node_idx).second);
+        cur_node_idx = nodes.at(cur_node_idx).first;
+    }
+
+    reverse(path->begin() + path_start_idx, path->end());
+}
+
+
 AlignmentSearchPath::AlignmentSearchPath() {
 
+    path_prefix_idx = SearchPathArena::no_node_idx;
+    path_prefix_length = 0;
+
     assert(gbwt_search.first.empty());
     gbwt_search.second = gbwt::FastLocate::NO_POSITION;
     
@@ -386,6 +415,50 @@ AlignmentSearchPath::AlignmentSearchPath() {
     insert_length = 0;
 }
 
+uint32_t AlignmentSearchPath::pathLength() const {
+
+    return (path_prefix_length + path.size());
+}
+
+// Moves all but the last node of path to the arena. The last 
+// node is kept in path so that the path can be extended.
+void AlignmentSearchPath::foldPathPrefix(SearchPathArena * search_path_arena) {
+
+    if (path.size() <= 1) {
+
+        return;
+    }
+
+    for (auto path_it = path.begin(); path_it != path.end() - 1; ++path_it) {
+
+        path_prefix_idx = search_path_arena->addNode(path_prefix_idx, *path_it);
+    }
+
+    path_prefix_length += path.size() - 1;
+    path.erase(path.begin(), path.end() - 1);
+}
+
+void AlignmentSearchPath::unfoldPathPrefix(const SearchPathArena & search_path_arena) {
+
+    if (path_prefix_length == 0) {
+
+        assert(path_prefix_idx == SearchPathArena::no_node_idx);
+        return;
+    }
+
+    vector<gbwt::node_type> prefix_path;
+    prefix_path.reserve(path_prefix_length + path.size());
+
+    search_path_arena.getPath(&prefix_path, path_prefix_idx);
+    assert(prefix_path.size() == path_prefix_length);
+
+    prefix_path.insert(prefix_path.end(), path.begin(), path.end());
+    path = move(prefix_path);
+
+    path_prefix_idx = SearchPathArena::no_node_idx;
+    path_prefix_length = 0;
+}
+
 uint32_t AlignmentSearchPath::fragmentLength() const {
 
     assert(!read_align_stats.empty());
@@ -505,6 +578,9 @@ bool AlignmentSearchPath::isInternal() const {
 
 void AlignmentSearchPath::clear() {
 
+    path_prefix_idx = SearchPathArena::no_node_idx;
+    path_prefix_length = 0;
+
     path.clear();
 
     gbwt_search.first = gbwt::SearchState();
@@ -515,6 +591,8 @@ void AlignmentSearchPath::clear() {
 
 bool operator==(const AlignmentSearchPath & lhs, const AlignmentSearchPath & rhs) { 
 
+    assert(lhs.path_prefix_length == 0 && rhs.path_prefix_length == 0);
+
     return (lhs.path == rhs.path && 
             lhs.gbwt_search == rhs.gbwt_search && 
             lhs.start_offset == rhs.start_offset && 
@@ -530,6 +608,8 @@ bool operator!=(const AlignmentSearchPath & lhs, const AlignmentSearchPath & rhs
 
 bool operator<(const AlignmentSearchPath & lhs, const AlignmentSearchPath & rhs) { 
 
+    assert(lhs.path_prefix_length == 0 && rhs.path_prefix_length == 0);
+
     if (lhs.path.size() != rhs.path.size()) {
 
         return (lhs.path.size() < rhs.path.size());    
@@ -9,6 +9,7 @@
 #include "vg/io/basic_stream.hpp"
 
 #include "utils.hpp"
+#include "alignment_view.hpp"
 
 using namespace std;
 
@@ -106,8 +107,8 @@ class AlignmentStats {
 
         gbwt::node_type internal_end_next_node;
 
-        void updateLeftSoftclipLength(const vg::Path & path);
-        void updateRightSoftclipLength(const vg::Path & path);
+        void updateLeftSoftclipLength(const PathView & path);
+        void updateRightSoftclipLength(const PathView & path);
 
         bool isInternal() const; 
         uint32_t internalPenalty() const; 
@@ -127,12 +128,33 @@ bool operator<(const AlignmentStats & lhs, const AlignmentStats & rhs);
 ostream & operator<<(ostream & os, const AlignmentStats & read_align_stats);
 
 
+class SearchPathArena {
+
+    public: 
+
+        static const uint32_t no_node_idx;
+
+        uint32_t addNode(const uint32_t prev_node_idx, const gbwt::node_type node);
+        void getPath(vector<gbwt::node_type> * path, const uint32_t last_node_idx) const;
+
+    private:
+
+        // Nodes linked to the index of their preceding node.
+        vector<pair<uint32_t, gbwt::node_type> > nodes;
+};
+
+
 class AlignmentSearchPath {
 
     public: 
     
         AlignmentSearchPath();
 
+        // Nodes preceding path can be stored in a SearchPathArena allowing 
+        // branching search paths to share their prefix (see foldPathPrefix()).
+        uint32_t path_prefix_idx;
+        uint32_t path_prefix_length;
+
         vector<gbwt::node_type> path;
         pair<gbwt::SearchState, gbwt::size_type> gbwt_search;
 
@@ -143,6 +165,11 @@ class AlignmentSearchPath {
 
         vector<AlignmentStats> read_align_stats;
 
+        uint32_t pathLength() const;
+
+        void foldPathPrefix(SearchPathArena * search_path_arena);
+        void unfoldPathPrefix(const SearchPathArena & search_path_arena);
+
         uint32_t fragmentLength() const;
         uint32_t minMappingQuality() const;
         int32_t scoreSum() const;
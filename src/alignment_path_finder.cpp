@@ -3,6 +3,8 @@
 
 #include <assert.h>
 #include <stack>
+#include <queue>
+#include <algorithm>
 
 #include "utils.hpp"
 
@@ -26,6 +28,52 @@ bool AlignmentPathFinder<AlignmentType>::alignmentHasPath(const vg::MultipathAli
     return (alignment.subpath_size() > 0);
 }
 
+template<class AlignmentType>
+bool AlignmentPathFinder<AlignmentType>::searchForward() const {
+
+    return (library_type != "rf");
+}
+
+template<class AlignmentType>
+bool AlignmentPathFinder<AlignmentType>::searchReverse() const {
+
+    return (library_type == "rf" || (library_type == "unstranded" && !paths_index.bidirectional()));
+}
+
+template<class AlignmentType>
+void AlignmentPathFinder<AlignmentType>::addAlignmentNodes(vector<gbwt::node_type> * gbwt_nodes, const vg::Path & path, const bool add_forward, const bool add_reverse) const {
+
+    for (auto & mapping: path.mapping()) {
+
+        const gbwt::node_type gbwt_node = Utils::mapping_to_gbwt(mapping);
+
+        if (add_forward) {
+
+            gbwt_nodes->emplace_back(gbwt_node);
+        }
+
+        if (add_reverse) {
+
+            gbwt_nodes->emplace_back(gbwt::Node::reverse(gbwt_node));
+        }
+    }
+}
+
+template<class AlignmentType>
+void AlignmentPathFinder<AlignmentType>::addAlignmentNodes(vector<gbwt::node_type> * gbwt_nodes, const vg::Alignment & alignment, const bool add_forward, const bool add_reverse) const {
+
+    addAlignmentNodes(gbwt_nodes, alignment.path(), add_forward, add_reverse);
+}
+
+template<class AlignmentType>
+void AlignmentPathFinder<AlignmentType>::addAlignmentNodes(vector<gbwt::node_type> * gbwt_nodes, const vg::MultipathAlignment & alignment, const bool add_forward, const bool add_reverse) const {
+
+    for (auto & subpath: alignment.subpath()) {
+
+        addAlignmentNodes(gbwt_nodes, subpath.path(), add_forward, add_reverse);
+    }
+}
+
 template<class AlignmentType>
 bool AlignmentPathFinder<AlignmentType>::alignmentStartInGraph(const AlignmentType & alignment) const {
 
@@ -49,7 +97,7 @@ int32_t AlignmentPathFinder<AlignmentType>::alignmentScore(const char & quality)
 }
 
 template<class AlignmentType>
-int32_t AlignmentPathFinder<AlignmentType>::alignmentScore(const string & quality, const uint32_t & start_offset, const uint32_t & length) const {
+int32_t AlignmentPathFinder<AlignmentType>::alignmentScore(const QualityView & quality, const uint32_t & start_offset, const uint32_t & length) const {
 
     if (quality.empty()) {
 
@@ -68,7 +116,7 @@ int32_t AlignmentPathFinder<AlignmentType>::alignmentScore(const string & qualit
 }
 
 template<class AlignmentType>
-int32_t AlignmentPathFinder<AlignmentType>::optimalAlignmentScore(const string & quality, const uint32_t seq_length) const {
+int32_t AlignmentPathFinder<AlignmentType>::optimalAlignmentScore(const QualityView & quality, const uint32_t seq_length) const {
 
     if (quality.empty()) {
 
@@ -84,19 +132,78 @@ int32_t AlignmentPathFinder<AlignmentType>::optimalAlignmentScore(const string &
 }
 
 template<class AlignmentType>
-int32_t AlignmentPathFinder<AlignmentType>::optimalAlignmentScore(const vg::Alignment & alignment) const {
+vector<AlignmentPath> AlignmentPathFinder<AlignmentType>::findAlignmentPaths(const AlignmentType & alignment) const {
 
-    return optimalAlignmentScore(alignment.quality(), alignment.sequence().size());
+    return findAlignmentPaths(alignment, alignment.sequence().size());
 }
 
 template<class AlignmentType>
-int32_t AlignmentPathFinder<AlignmentType>::optimalAlignmentScore(const vg::MultipathAlignment & alignment) const {
+vector<AlignmentPath> AlignmentPathFinder<AlignmentType>::findAlignmentPaths(const AlignmentType & alignment, const uint32_t seq_length) const {
 
-    return optimalAlignmentScore(alignment.quality(), alignment.sequence().size());
+    return findAlignmentPaths(alignment, seq_length, GBWTRecordBatch());
 }
 
 template<class AlignmentType>
-vector<AlignmentPath> AlignmentPathFinder<AlignmentType>::findAlignmentPaths(const AlignmentType & alignment) const {
+void AlignmentPathFinder<AlignmentType>::findAlignmentPaths(vector<vector<AlignmentPath> > * align_paths_batch, const vector<AlignmentType> & alignments, const vector<uint32_t> & seq_lengths) const {
+
+    assert(alignments.size() == seq_lengths.size());
+
+    GBWTRecordBatch gbwt_records;
+
+    if (paths_index.decodesRecords()) {
+
+        vector<gbwt::node_type> gbwt_nodes;
+
+        for (auto & alignment: alignments) {
+
+            addAlignmentNodes(&gbwt_nodes, alignment, searchForward(), searchReverse());
+        }
+
+        paths_index.decodeRecords(&gbwt_records, &gbwt_nodes);
+    }
+
+    align_paths_batch->clear();
+    align_paths_batch->reserve(alignments.size());
+
+    for (size_t i = 0; i < alignments.size(); ++i) {
+
+        align_paths_batch->emplace_back(findAlignmentPaths(alignments.at(i), seq_lengths.at(i), gbwt_records));
+    }
+}
+
+template<class AlignmentType>
+void AlignmentPathFinder<AlignmentType>::findPairedAlignmentPaths(vector<vector<AlignmentPath> > * align_paths_batch, const vector<AlignmentType> & alignments, const vector<uint32_t> & seq_lengths) const {
+
+    assert(alignments.size() % 2 == 0);
+    assert(alignments.size() == seq_lengths.size());
+
+    GBWTRecordBatch gbwt_records;
+
+    if (paths_index.decodesRecords()) {
+
+        vector<gbwt::node_type> gbwt_nodes;
+
+        for (size_t i = 0; i < alignments.size(); i += 2) {
+
+            // The second mate is searched in the opposite orientation.
+            addAlignmentNodes(&gbwt_nodes, alignments.at(i), searchForward(), searchReverse());
+            addAlignmentNodes(&gbwt_nodes, alignments.at(i + 1), searchReverse(), searchForward());
+        }
+
+        paths_index.decodeRecords(&gbwt_records, &gbwt_nodes);
+    }
+
+    align_paths_batch->clear();
+    align_paths_batch->reserve(alignments.size() / 2);
+
+    for (size_t i = 0; i < alignments.size(); i += 2) {
+
+        align_paths_batch->emplace_back(findPairedAlignmentPaths(alignments.at(i), seq_lengths.at(i), alignments.at(i + 1), seq_lengths.at(i + 1), gbwt_records));
+    }
+}
+
+template<class AlignmentType>
+vector<AlignmentPath> AlignmentPathFinder<AlignmentType>::findAlignmentPaths(const AlignmentType & alignment, const uint32_t seq_length, const GBWTRecordBatch & gbwt_records) const {
 
 #ifdef debug
 
@@ -117,26 +224,22 @@ vector<AlignmentPath> AlignmentPathFinder<AlignmentType>::findAlignmentPaths(con
 
     vector<AlignmentSearchPath> align_search_paths;
 
-    function<size_t(const uint32_t)> node_length_func = [&](const uint32_t node_id) { return paths_index.nodeLength(node_id); };
-
     if (library_type == "fr") {
 
-        findAlignmentSearchPaths(&align_search_paths, alignment);
+        findAlignmentSearchPaths(&align_search_paths, AlignmentView<AlignmentType>(alignment, seq_length, false, paths_index), gbwt_records);
 
     } else if (library_type == "rf") {
 
-        AlignmentType alignment_rc = Utils::lazy_reverse_complement_alignment(alignment, node_length_func);
-        findAlignmentSearchPaths(&align_search_paths, alignment_rc);
+        findAlignmentSearchPaths(&align_search_paths, AlignmentView<AlignmentType>(alignment, seq_length, true, paths_index), gbwt_records);
 
     } else {
 
         assert(library_type == "unstranded");
-        findAlignmentSearchPaths(&align_search_paths, alignment);
+        findAlignmentSearchPaths(&align_search_paths, AlignmentView<AlignmentType>(alignment, seq_length, false, paths_index), gbwt_records);
 
         if (!paths_index.bidirectional()) {
 
-            AlignmentType alignment_rc = Utils::lazy_reverse_complement_alignment(alignment, node_length_func);
-            findAlignmentSearchPaths(&align_search_paths, alignment_rc);
+            findAlignmentSearchPaths(&align_search_paths, AlignmentView<AlignmentType>(alignment, seq_length, true, paths_index), gbwt_records);
         }  
     }
 
@@ -155,29 +258,29 @@ vector<AlignmentPath> AlignmentPathFinder<AlignmentType>::findAlignmentPaths(con
 }
 
 template<class AlignmentType>
-vector<AlignmentSearchPath> AlignmentPathFinder<AlignmentType>::extendAlignmentSearchPath(const AlignmentSearchPath & align_search_path, const vg::Alignment & alignment) const {
+vector<AlignmentSearchPath> AlignmentPathFinder<AlignmentType>::extendAlignmentSearchPath(const AlignmentSearchPath & align_search_path, const AlignmentView<vg::Alignment> & alignment, const GBWTRecordBatch & gbwt_records) const {
 
-    assert(alignment.mapping_quality() >= 0);
-    auto optimal_score = optimalAlignmentScore(alignment);
+    assert(alignment.mappingQuality() >= 0);
+    auto optimal_score = optimalAlignmentScore(alignment.quality(), alignment.sequenceLength());
 
     vector<AlignmentSearchPath> extended_align_search_paths(1, align_search_path);
     
     extended_align_search_paths.back().read_align_stats.emplace_back(AlignmentStats());
     AlignmentStats * read_align_stats = &(extended_align_search_paths.back().read_align_stats.back());
 
-    read_align_stats->mapq = alignment.mapping_quality();
+    read_align_stats->mapq = alignment.mappingQuality();
     read_align_stats->score = alignment.score();
 
-    read_align_stats->internal_start.max_offset = min(read_align_stats->left_softclip_length + max_partial_offset, static_cast<uint32_t>(alignment.sequence().size()));
-    read_align_stats->internal_end.max_offset = min(read_align_stats->right_softclip_length + max_partial_offset, static_cast<uint32_t>(alignment.sequence().size()));
+    read_align_stats->internal_start.max_offset = min(read_align_stats->left_softclip_length + max_partial_offset, alignment.sequenceLength());
+    read_align_stats->internal_end.max_offset = min(read_align_stats->right_softclip_length + max_partial_offset, alignment.sequenceLength());
 
-    extendAlignmentSearchPath(&extended_align_search_paths, alignment.path(), true, true, alignment.quality(), alignment.sequence().size(), true);
+    extendAlignmentSearchPath(&extended_align_search_paths, alignment.path(), true, true, alignment.quality(), alignment.sequenceLength(), true, gbwt_records);
 
     int32_t max_align_path_score = 0;
 
     for (auto & align_search_path: extended_align_search_paths) {
 
-        assert(align_search_path.read_align_stats.back().length <= alignment.sequence().size());
+        assert(align_search_path.read_align_stats.back().length <= alignment.sequenceLength());
         assert(!align_search_path.read_align_stats.back().complete);
 
         if ((align_search_path.isInternal() || !est_missing_noise_prob) && align_search_path.gbwt_search.first.empty()) {
@@ -185,7 +288,7 @@ vector<AlignmentSearchPath> AlignmentPathFinder<AlignmentType>::extendAlignmentS
             continue;
         }
 
-        if (align_search_path.read_align_stats.back().length == alignment.sequence().size()) {
+        if (align_search_path.read_align_stats.back().length == alignment.sequenceLength()) {
 
             align_search_path.read_align_stats.back().complete = true;
             max_align_path_score = max(max_align_path_score, align_search_path.scoreSum());
@@ -216,10 +319,10 @@ vector<AlignmentSearchPath> AlignmentPathFinder<AlignmentType>::extendAlignmentS
         extended_align_search_paths.back().read_align_stats.emplace_back(AlignmentStats());
         AlignmentStats * error_read_align_stats = &(extended_align_search_paths.back().read_align_stats.back());
 
-        error_read_align_stats->mapq = alignment.mapping_quality();
+        error_read_align_stats->mapq = alignment.mappingQuality();
         error_read_align_stats->score = numeric_limits<int32_t>::max();
 
-        error_read_align_stats->length = alignment.sequence().size();
+        error_read_align_stats->length = alignment.sequenceLength();
         error_read_align_stats->complete = true;
     }
 
@@ -227,7 +330,7 @@ vector<AlignmentSearchPath> AlignmentPathFinder<AlignmentType>::extendAlignmentS
 }
 
 template<class AlignmentType>
-void AlignmentPathFinder<AlignmentType>::extendAlignmentSearchPath(vector<AlignmentSearchPath> * align_search_paths, const vg::Path & path, const bool is_first_path, const bool is_last_path, const string & quality, const uint32_t seq_length, const bool add_internal_start) const {
+void AlignmentPathFinder<AlignmentType>::extendAlignmentSearchPath(vector<AlignmentSearchPath> * align_search_paths, const PathView & path, const bool is_first_path, const bool is_last_path, const QualityView & quality, const uint32_t seq_length, const bool add_internal_start, const GBWTRecordBatch & gbwt_records) const {
 
     assert(align_search_paths->size() == 1);
     assert(!align_search_paths->front().read_align_stats.empty());
@@ -243,19 +346,16 @@ void AlignmentPathFinder<AlignmentType>::extendAlignmentSearchPath(vector<Alignm
     }
 
     uint32_t last_internal_start_idx = 0;
+    assert(path.mappingSize() > 0);
 
-    auto mapping_it = path.mapping().cbegin();
-    assert(mapping_it != path.mapping().cend());
-
-    auto end_mapping_it = path.mapping().cend();
-    --end_mapping_it;
+    for (uint32_t mapping_idx = 0; mapping_idx < path.mappingSize(); ++mapping_idx) {
 
-    while (mapping_it != path.mapping().cend()) {
+        const MappingView mapping = path.mapping(mapping_idx);
 
-        auto cur_node = Utils::mapping_to_gbwt(*mapping_it);
-        auto mapping_read_length = Utils::mapping_to_length(*mapping_it);
+        auto cur_node = mapping.gbwtNode();
+        auto mapping_read_length = mapping.toLength();
 
-        const bool is_last_mapping = (is_last_path && mapping_it == end_mapping_it);
+        const bool is_last_mapping = (is_last_path && mapping_idx + 1 == path.mappingSize());
 
         AlignmentSearchPath main_align_search_path;
 
@@ -298,7 +398,7 @@ void AlignmentPathFinder<AlignmentType>::extendAlignmentSearchPath(vector<Alignm
             
             } else {
 
-                extendAlignmentSearchPath(&align_search_path, *mapping_it);
+                extendAlignmentSearchPath(&align_search_path, mapping, gbwt_records);
             }
         }
 
@@ -327,7 +427,7 @@ void AlignmentPathFinder<AlignmentType>::extendAlignmentSearchPath(vector<Alignm
             }
         }
 
-        if (max_partial_offset > 0 && add_internal_start && align_search_paths->at(last_internal_start_idx).path.size() > 1 && !align_search_paths->at(last_internal_start_idx).read_align_stats.back().internal_end.is_internal) {
+        if (max_partial_offset > 0 && add_internal_start && align_search_paths->at(last_internal_start_idx).pathLength() > 1 && !align_search_paths->at(last_internal_start_idx).read_align_stats.back().internal_end.is_internal) {
 
             if (align_search_paths->at(last_internal_start_idx).read_align_stats.back().length <= align_search_paths->at(last_internal_start_idx).read_align_stats.back().internal_start.max_offset) {
 
@@ -340,7 +440,7 @@ void AlignmentPathFinder<AlignmentType>::extendAlignmentSearchPath(vector<Alignm
                 if (internal_start_read_align_stats.internal_start.offset <= max_partial_offset) {
 
                     AlignmentSearchPath new_start_align_search_path;
-                    extendAlignmentSearchPath(&new_start_align_search_path, *mapping_it);
+                    extendAlignmentSearchPath(&new_start_align_search_path, mapping, gbwt_records);
 
                     if (!new_start_align_search_path.gbwt_search.first.empty()) {
 
@@ -363,15 +463,14 @@ void AlignmentPathFinder<AlignmentType>::extendAlignmentSearchPath(vector<Alignm
 
             align_search_path.read_align_stats.back().length += mapping_read_length;
         }
-
-        ++mapping_it;
     }
 }
 
 template<class AlignmentType>
-void AlignmentPathFinder<AlignmentType>::extendAlignmentSearchPath(AlignmentSearchPath * align_search_path, const vg::Mapping & mapping) const {
+void AlignmentPathFinder<AlignmentType>::extendAlignmentSearchPath(AlignmentSearchPath * align_search_path, const MappingView & mapping, const GBWTRecordBatch & gbwt_records) const {
 
-    auto cur_node = Utils::mapping_to_gbwt(mapping);
+    auto cur_node = mapping.gbwtNode();
+    auto mapping_offset = mapping.offset();
 
     if (align_search_path->path.empty()) {
 
@@ -380,15 +479,15 @@ void AlignmentPathFinder<AlignmentType>::extendAlignmentSearchPath(AlignmentSear
         align_search_path->path.emplace_back(cur_node);
         paths_index.find(&(align_search_path->gbwt_search), cur_node);
   
-        align_search_path->start_offset = mapping.position().offset();
+        align_search_path->start_offset = mapping_offset;
 
     } else {
 
         bool is_cycle_visit = false;
 
-        if (align_search_path->path.back() == cur_node && mapping.position().offset() != align_search_path->end_offset) {
+        if (align_search_path->path.back() == cur_node && mapping_offset != align_search_path->end_offset) {
 
-            assert(mapping.position().offset() == 0);
+            assert(mapping_offset == 0);
             is_cycle_visit = true;      
         }
 
@@ -398,19 +497,19 @@ void AlignmentPathFinder<AlignmentType>::extendAlignmentSearchPath(AlignmentSear
 
             if (!align_search_path->gbwt_search.first.empty()) {
 
-                paths_index.extend(&(align_search_path->gbwt_search), cur_node);
+                paths_index.extend(&(align_search_path->gbwt_search), cur_node, gbwt_records);
             }
         } 
     }
 
-    align_search_path->end_offset = mapping.position().offset() + Utils::mapping_from_length(mapping);
+    align_search_path->end_offset = mapping_offset + mapping.fromLength();
 }
 
 template<class AlignmentType>
-vector<AlignmentSearchPath> AlignmentPathFinder<AlignmentType>::extendAlignmentSearchPath(const AlignmentSearchPath & align_search_path, const vg::MultipathAlignment & alignment) const {
+vector<AlignmentSearchPath> AlignmentPathFinder<AlignmentType>::extendAlignmentSearchPath(const AlignmentSearchPath & align_search_path, const AlignmentView<vg::MultipathAlignment> & alignment, const GBWTRecordBatch & gbwt_records) const {
 
-    assert(alignment.mapping_quality() >= 0);
-    auto optimal_score = optimalAlignmentScore(alignment);
+    assert(alignment.mappingQuality() >= 0);
+    auto optimal_score = optimalAlignmentScore(alignment.quality(), alignment.sequenceLength());
 
     vector<AlignmentSearchPath> extended_align_search_paths;
 
@@ -418,16 +517,16 @@ vector<AlignmentSearchPath> AlignmentPathFinder<AlignmentType>::extendAlignmentS
     auto right_softclip_lengths = getAlignmentEndSoftclipLengths(alignment);
 
     auto min_right_softclip_length = *min_element(right_softclip_lengths.begin(), right_softclip_lengths.end());
-    assert(min_right_softclip_length <= alignment.sequence().size());
+    assert(min_right_softclip_length <= alignment.sequenceLength());
 
     auto max_right_softclip_length = *max_element(right_softclip_lengths.begin(), right_softclip_lengths.end());
-    assert(max_right_softclip_length <= alignment.sequence().size());
+    assert(max_right_softclip_length <= alignment.sequenceLength());
 
     vector<pair<int32_t, uint32_t> > start_score_indexes;
 
-    for (auto & start_subpath_idx: alignment.start()) {
+    for (uint32_t i = 0; i < alignment.startSize(); ++i) {
 
-        start_score_indexes.emplace_back(alignment.subpath().Get(start_subpath_idx).score(), start_subpath_idx);
+        start_score_indexes.emplace_back(alignment.subpathScore(alignment.start(i)), alignment.start(i));
     }
 
     sort(start_score_indexes.rbegin(), start_score_indexes.rend());
@@ -435,6 +534,8 @@ vector<AlignmentSearchPath> AlignmentPathFinder<AlignmentType>::extendAlignmentS
     spp::sparse_hash_map<pair<uint32_t, uint32_t>, int32_t> internal_node_subpaths;
     int32_t best_align_score = floor(optimal_score * min_best_score_filter);
 
+    SearchPathArena search_path_arena;
+
     for (auto & start_score_idx: start_score_indexes) {
 
         AlignmentSearchPath init_align_search_path;
@@ -442,16 +543,16 @@ vector<AlignmentSearchPath> AlignmentPathFinder<AlignmentType>::extendAlignmentS
         init_align_search_path.read_align_stats.emplace_back(AlignmentStats());
         AlignmentStats * init_read_align_stats = &(init_align_search_path.read_align_stats.back());
 
-        init_read_align_stats->mapq = alignment.mapping_quality();
+        init_read_align_stats->mapq = alignment.mappingQuality();
 
         AlignmentStats tpm_read_align_stats;
-        tpm_read_align_stats.updateLeftSoftclipLength(alignment.subpath(start_score_idx.second).path());
-        assert(tpm_read_align_stats.left_softclip_length <= alignment.sequence().size());
+        tpm_read_align_stats.updateLeftSoftclipLength(alignment.subpathPath(start_score_idx.second));
+        assert(tpm_read_align_stats.left_softclip_length <= alignment.sequenceLength());
 
-        init_read_align_stats->internal_start.max_offset = min(tpm_read_align_stats.left_softclip_length + max_partial_offset, static_cast<uint32_t>(alignment.sequence().size()));
-        init_read_align_stats->internal_end.max_offset = min(max_right_softclip_length + max_partial_offset, static_cast<uint32_t>(alignment.sequence().size()));
+        init_read_align_stats->internal_start.max_offset = min(tpm_read_align_stats.left_softclip_length + max_partial_offset, alignment.sequenceLength());
+        init_read_align_stats->internal_end.max_offset = min(max_right_softclip_length + max_partial_offset, alignment.sequenceLength());
 
-        extendAlignmentSearchPaths(&extended_align_search_paths, init_align_search_path, alignment.subpath(), start_score_idx.second, alignment.quality(), alignment.sequence().size(), &internal_node_subpaths, &best_align_score, min_right_softclip_length == 0);
+        extendAlignmentSearchPaths(&extended_align_search_paths, init_align_search_path, alignment, start_score_idx.second, &internal_node_subpaths, &best_align_score, min_right_softclip_length == 0, &search_path_arena, gbwt_records);
     }
 
     assert(best_align_score <= optimal_score);
@@ -477,10 +578,10 @@ vector<AlignmentSearchPath> AlignmentPathFinder<AlignmentType>::extendAlignmentS
         extended_align_search_paths.back().read_align_stats.emplace_back(AlignmentStats());
         AlignmentStats * error_read_align_stats = &(extended_align_search_paths.back().read_align_stats.back());
 
-        error_read_align_stats->mapq = alignment.mapping_quality();
+        error_read_align_stats->mapq = alignment.mappingQuality();
         error_read_align_stats->score = numeric_limits<int32_t>::max();
 
-        error_read_align_stats->length = alignment.sequence().size();
+        error_read_align_stats->length = alignment.sequenceLength();
         error_read_align_stats->complete = true;
     }
 
@@ -488,7 +589,10 @@ vector<AlignmentSearchPath> AlignmentPathFinder<AlignmentType>::extendAlignmentS
 }
 
 template<class AlignmentType>
-void AlignmentPathFinder<AlignmentType>::extendAlignmentSearchPaths(vector<AlignmentSearchPath> * align_search_paths, const AlignmentSearchPath & init_align_search_path, const google::protobuf::RepeatedPtrField<vg::Subpath> & subpaths, const uint32_t start_subpath_idx, const string & quality, const uint32_t seq_length, spp::sparse_hash_map<pair<uint32_t, uint32_t>, int32_t> * internal_node_subpaths, int32_t * best_align_score, const bool has_right_bonus) const {
+void AlignmentPathFinder<AlignmentType>::extendAlignmentSearchPaths(vector<AlignmentSearchPath> * align_search_paths, const AlignmentSearchPath & init_align_search_path, const AlignmentView<vg::MultipathAlignment> & alignment, const uint32_t start_subpath_idx, spp::sparse_hash_map<pair<uint32_t, uint32_t>, int32_t> * internal_node_subpaths, int32_t * best_align_score, const bool has_right_bonus, SearchPathArena * search_path_arena, const GBWTRecordBatch & gbwt_records) const {
+
+    const QualityView quality = alignment.quality();
+    const uint32_t seq_length = alignment.sequenceLength();
 
     stack<pair<AlignmentSearchPath, uint32_t> > align_search_paths_stack;
     align_search_paths_stack.emplace(init_align_search_path, start_subpath_idx);
@@ -501,15 +605,17 @@ void AlignmentPathFinder<AlignmentType>::extendAlignmentSearchPaths(vector<Align
 
         align_search_paths_stack.pop();
 
-        const vg::Subpath & subpath = subpaths.Get(subpath_idx);
+        const PathView subpath_path = alignment.subpathPath(subpath_idx);
+        const uint32_t subpath_next_size = alignment.subpathNextSize(subpath_idx);
+
         AlignmentSearchPath * extended_align_search_path = &(extended_align_search_paths.front());
-        extended_align_search_path->read_align_stats.back().score += subpath.score();
+        extended_align_search_path->read_align_stats.back().score += alignment.subpathScore(subpath_idx);
 
         uint32_t subpath_length = 0;
 
-        for (auto & mapping: subpath.path().mapping()) {
+        for (uint32_t i = 0; i < subpath_path.mappingSize(); ++i) {
 
-            subpath_length += Utils::mapping_to_length(mapping);
+            subpath_length += subpath_path.mapping(i).toLength();
         }
 
         assert(extended_align_search_path->read_align_stats.back().length + subpath_length <= seq_length);
@@ -517,7 +623,7 @@ void AlignmentPathFinder<AlignmentType>::extendAlignmentSearchPaths(vector<Align
 
         int32_t max_score = extended_align_search_path->read_align_stats.back().score + seq_length_left;
 
-        if (has_right_bonus && subpath.next_size() > 0) {
+        if (has_right_bonus && subpath_next_size > 0) {
 
             max_score += Utils::default_full_length_bonus;
         }
@@ -556,7 +662,7 @@ void AlignmentPathFinder<AlignmentType>::extendAlignmentSearchPaths(vector<Align
             } 
         }
 
-        extendAlignmentSearchPath(&extended_align_search_paths, subpath.path(), subpath_idx == start_subpath_idx, subpath.next_size() == 0, quality, seq_length, add_internal_start);        
+        extendAlignmentSearchPath(&extended_align_search_paths, subpath_path, subpath_idx == start_subpath_idx, subpath_next_size == 0, quality, seq_length, add_internal_start, gbwt_records);
 
         for (auto & align_search_path: extended_align_search_paths) {
 
@@ -580,23 +686,27 @@ void AlignmentPathFinder<AlignmentType>::extendAlignmentSearchPaths(vector<Align
 
             assert(!align_search_path.path.empty());
 
-            if (subpath.next_size() > 0) {
+            if (subpath_next_size > 0) {
 
                 vector<pair<int32_t, uint32_t> > next_score_indexes;
 
-                for (auto & next_subpath_idx: subpath.next()) {
+                for (uint32_t i = 0; i < subpath_next_size; ++i) {
 
-                    next_score_indexes.emplace_back(subpaths.Get(next_subpath_idx).score(), next_subpath_idx);
+                    const uint32_t next_subpath_idx = alignment.subpathNext(subpath_idx, i);
+                    next_score_indexes.emplace_back(alignment.subpathScore(next_subpath_idx), next_subpath_idx);
                 }
 
                 sort(next_score_indexes.begin(), next_score_indexes.end());
 
+                // Share path prefix between branches.
+                align_search_path.foldPathPrefix(search_path_arena);
+
                 for (auto & next_score_idx: next_score_indexes) {
 
                     align_search_paths_stack.emplace(align_search_path, next_score_idx.second);
                 }
 
-            } else if (subpath.connection_size() == 0) {
+            } else if (alignment.subpathConnectionSize(subpath_idx) == 0) {
 
                 *best_align_score = max(*best_align_score, align_search_path.scoreSum());
 
@@ -604,6 +714,8 @@ void AlignmentPathFinder<AlignmentType>::extendAlignmentSearchPaths(vector<Align
                 assert(!align_search_path.read_align_stats.back().complete);
 
                 align_search_path.read_align_stats.back().complete = true;
+                align_search_path.unfoldPathPrefix(*search_path_arena);
+
                 align_search_paths->emplace_back(move(align_search_path));
             }
         }
@@ -613,11 +725,23 @@ void AlignmentPathFinder<AlignmentType>::extendAlignmentSearchPaths(vector<Align
 template<class AlignmentType>
 vector<AlignmentPath> AlignmentPathFinder<AlignmentType>::findPairedAlignmentPaths(const AlignmentType & alignment_1, const AlignmentType & alignment_2) const {
 
+    return findPairedAlignmentPaths(alignment_1, alignment_1.sequence().size(), alignment_2, alignment_2.sequence().size());
+}
+
+template<class AlignmentType>
+vector<AlignmentPath> AlignmentPathFinder<AlignmentType>::findPairedAlignmentPaths(const AlignmentType & alignment_1, const uint32_t seq_length_1, const AlignmentType & alignment_2, const uint32_t seq_length_2) const {
+
+    return findPairedAlignmentPaths(alignment_1, seq_length_1, alignment_2, seq_length_2, GBWTRecordBatch());
+}
+
+template<class AlignmentType>
+vector<AlignmentPath> AlignmentPathFinder<AlignmentType>::findPairedAlignmentPaths(const AlignmentType & alignment_1, const uint32_t seq_length_1, const AlignmentType & alignment_2, const uint32_t seq_length_2, const GBWTRecordBatch & gbwt_records) const {
+
 #ifdef debug
 
     cerr << endl;
-    findAlignmentPaths(alignment_1);
-    findAlignmentPaths(alignment_2);
+    findAlignmentPaths(alignment_1, seq_length_1);
+    findAlignmentPaths(alignment_2, seq_length_2);
 
 #endif
 
@@ -633,29 +757,22 @@ vector<AlignmentPath> AlignmentPathFinder<AlignmentType>::findPairedAlignmentPat
 
     vector<AlignmentSearchPath> paired_align_search_paths;
 
-    function<size_t(const uint32_t)> node_length_func = [&](const uint32_t node_id) { return paths_index.nodeLength(node_id); };
-    AlignmentType alignment_2_rc = Utils::lazy_reverse_complement_alignment(alignment_2, node_length_func);
-
     if (library_type == "fr") {
 
-        findPairedAlignmentSearchPaths(&paired_align_search_paths, alignment_1, alignment_2_rc);
+        findPairedAlignmentSearchPaths(&paired_align_search_paths, AlignmentView<AlignmentType>(alignment_1, seq_length_1, false, paths_index), AlignmentView<AlignmentType>(alignment_2, seq_length_2, true, paths_index), gbwt_records);
 
     } else if (library_type == "rf") {
 
-        AlignmentType alignment_1_rc = Utils::lazy_reverse_complement_alignment(alignment_1, node_length_func);
-        findPairedAlignmentSearchPaths(&paired_align_search_paths, alignment_2, alignment_1_rc);
+        findPairedAlignmentSearchPaths(&paired_align_search_paths, AlignmentView<AlignmentType>(alignment_2, seq_length_2, false, paths_index), AlignmentView<AlignmentType>(alignment_1, seq_length_1, true, paths_index), gbwt_records);
 
     } else {
 
         assert(library_type == "unstranded");
-
-        AlignmentType alignment_2_rc = Utils::lazy_reverse_complement_alignment(alignment_2, node_length_func);
-        findPairedAlignmentSearchPaths(&paired_align_search_paths, alignment_1, alignment_2_rc);
+        findPairedAlignmentSearchPaths(&paired_align_search_paths, AlignmentView<AlignmentType>(alignment_1, seq_length_1, false, paths_index), AlignmentView<AlignmentType>(alignment_2, seq_length_2, true, paths_index), gbwt_records);
 
         if (!paths_index.bidirectional()) {
 
-            AlignmentType alignment_1_rc = Utils::lazy_reverse_complement_alignment(alignment_1, node_length_func);
-            findPairedAlignmentSearchPaths(&paired_align_search_paths, alignment_2, alignment_1_rc);
+            findPairedAlignmentSearchPaths(&paired_align_search_paths, AlignmentView<AlignmentType>(alignment_2, seq_length_2, false, paths_index), AlignmentView<AlignmentType>(alignment_1, seq_length_1, true, paths_index), gbwt_records);
         }
     }
 
@@ -674,9 +791,9 @@ vector<AlignmentPath> AlignmentPathFinder<AlignmentType>::findPairedAlignmentPat
 }
 
 template<class AlignmentType>
-void AlignmentPathFinder<AlignmentType>::findAlignmentSearchPaths(vector<AlignmentSearchPath> * align_search_paths, const AlignmentType & alignment) const {
+void AlignmentPathFinder<AlignmentType>::findAlignmentSearchPaths(vector<AlignmentSearchPath> * align_search_paths, const AlignmentView<AlignmentType> & alignment, const GBWTRecordBatch & gbwt_records) const {
 
-    auto single_align_search_paths = extendAlignmentSearchPath(AlignmentSearchPath(), alignment);
+    auto single_align_search_paths = extendAlignmentSearchPath(AlignmentSearchPath(), alignment, gbwt_records);
 
     if (single_align_search_paths.empty()) {
 
@@ -699,7 +816,7 @@ void AlignmentPathFinder<AlignmentType>::findAlignmentSearchPaths(vector<Alignme
         }
 
         assert(!single_search_path.path.empty());
-        assert(single_search_path.read_align_stats.back().length == alignment.sequence().size());
+        assert(single_search_path.read_align_stats.back().length == alignment.sequenceLength());
 
         if (i > 0) {
 
@@ -737,10 +854,10 @@ void AlignmentPathFinder<AlignmentType>::findAlignmentSearchPaths(vector<Alignme
 }
 
 template<class AlignmentType>
-void AlignmentPathFinder<AlignmentType>::findPairedAlignmentSearchPaths(vector<AlignmentSearchPath> * paired_align_search_paths, const AlignmentType & start_alignment, const AlignmentType & end_alignment) const {
+void AlignmentPathFinder<AlignmentType>::findPairedAlignmentSearchPaths(vector<AlignmentSearchPath> * paired_align_search_paths, const AlignmentView<AlignmentType> & start_alignment, const AlignmentView<AlignmentType> & end_alignment, const GBWTRecordBatch & gbwt_records) const {
 
-    auto start_align_search_paths = extendAlignmentSearchPath(AlignmentSearchPath(), start_alignment);
-    auto end_align_search_paths = extendAlignmentSearchPath(AlignmentSearchPath(), end_alignment);
+    auto start_align_search_paths = extendAlignmentSearchPath(AlignmentSearchPath(), start_alignment, gbwt_records);
+    auto end_align_search_paths = extendAlignmentSearchPath(AlignmentSearchPath(), end_alignment, gbwt_records);
 
     if (start_align_search_paths.empty() || end_align_search_paths.empty()) {
 
@@ -770,7 +887,7 @@ void AlignmentPathFinder<AlignmentType>::findPairedAlignmentSearchPaths(vector<A
         }
 
         assert(!end_search_path.path.empty());
-        assert(end_search_path.read_align_stats.back().length == end_alignment.sequence().size());
+        assert(end_search_path.read_align_stats.back().length == end_alignment.sequenceLength());
 
         if (i > 0) {
 
@@ -811,26 +928,35 @@ void AlignmentPathFinder<AlignmentType>::findPairedAlignmentSearchPaths(vector<A
         end_search_paths_start_nodes_index_it.first->second.emplace_back(i);
     }
 
-    assert(end_max_left_softclip_length <= end_alignment.sequence().size());
+    assert(end_max_left_softclip_length <= end_alignment.sequenceLength());
 
     bool end_alignment_in_cycle = false;
 
-    for (auto end_search_paths_start_node: end_search_paths_start_nodes_index) {
+    for (auto & end_search_paths_start_node: end_search_paths_start_nodes_index) {
 
-        pair<gbwt::SearchState, gbwt::size_type> start_node_gbwt_search;
-        paths_index.find(&start_node_gbwt_search, end_search_paths_start_node.first);
-
-        const uint32_t num_start_node_paths = paths_index.locatePathIds(start_node_gbwt_search).size();
-        assert(num_start_node_paths <= start_node_gbwt_search.first.size());
-
-        if (num_start_node_paths < start_node_gbwt_search.first.size()) {
+        if (paths_index.isCyclicNode(end_search_paths_start_node.first)) {
 
             end_alignment_in_cycle = true;
             break;
         }
     }
 
-    stack<pair<AlignmentSearchPath, bool> > paired_align_search_path_stack;
+    // Lower bound on the number of bases added to the fragment before 
+    // the end alignment can be reached from each node (bidirectional GBWT only).
+    spp::sparse_hash_map<gbwt::node_type, int32_t> end_search_paths_distances;
+
+    if (paths_index.bidirectional()) {
+
+        findEndSearchPathsDistances(&end_search_paths_distances, end_align_search_paths, end_search_paths_start_nodes_index);
+    }
+
+    // Search tree of path extensions. The extended path nodes are shared 
+    // between extensions in an arena, which avoids copying the search path 
+    // at every branch.
+    SearchPathArena search_path_arena;
+
+    vector<PairedSearchExtension> paired_search_extensions;
+    stack<uint32_t> paired_search_extension_stack;
 
     double joint_start_align_score = numeric_limits<int32_t>::lowest();
     double joint_empty_start_align_score = numeric_limits<int32_t>::lowest();
@@ -846,7 +972,7 @@ void AlignmentPathFinder<AlignmentType>::findPairedAlignmentSearchPaths(vector<A
         }
 
         assert(!start_search_path.path.empty());
-        assert(start_search_path.read_align_stats.back().length == start_alignment.sequence().size());
+        assert(start_search_path.read_align_stats.back().length == start_alignment.sequenceLength());
 
         if (i > 0) {
 
@@ -888,7 +1014,7 @@ void AlignmentPathFinder<AlignmentType>::findPairedAlignmentSearchPaths(vector<A
                 for (auto end_alignment_idx: end_search_paths_start_node.second) {
 
                     AlignmentSearchPath complete_paired_align_search_path = start_search_path;
-                    mergeAlignmentSearchPath(&complete_paired_align_search_path, main_path_start_idx, end_align_search_paths.at(end_alignment_idx));
+                    mergeAlignmentSearchPath(&complete_paired_align_search_path, main_path_start_idx, end_align_search_paths.at(end_alignment_idx), gbwt_records);
 
                     if (!complete_paired_align_search_path.gbwt_search.first.empty() && complete_paired_align_search_path.fragmentLength() <= max_pair_frag_length) {
 
@@ -901,36 +1027,43 @@ void AlignmentPathFinder<AlignmentType>::findPairedAlignmentSearchPaths(vector<A
             }
         }
 
-        paired_align_search_path_stack.emplace(start_search_path, false);
-
-        paired_align_search_path_stack.top().first.insert_length += (node_length - start_search_path.end_offset);
-        paired_align_search_path_stack.top().first.end_offset = node_length;
+        paired_search_extension_stack.emplace(paired_search_extensions.size());
+        paired_search_extensions.emplace_back(PairedSearchExtension(i, SearchPathArena::no_node_idx, start_search_path.gbwt_search, start_search_path.insert_length + node_length - start_search_path.end_offset));
     }
 
     // Perform depth-first path extension.
-    while (!paired_align_search_path_stack.empty()) {
+    while (!paired_search_extension_stack.empty()) {
 
-        const pair<AlignmentSearchPath, bool> cur_paired_align_search_path = paired_align_search_path_stack.top();
-        paired_align_search_path_stack.pop();
-   
-        assert(!cur_paired_align_search_path.first.gbwt_search.first.empty());
-        assert(cur_paired_align_search_path.first.path.back() == cur_paired_align_search_path.first.gbwt_search.first.node);
+        const uint32_t cur_extension_idx = paired_search_extension_stack.top();
+        paired_search_extension_stack.pop();
 
-        if (cur_paired_align_search_path.second) {
+        // Copy as the search tree can be reallocated below.
+        const PairedSearchExtension cur_extension = paired_search_extensions.at(cur_extension_idx);
+        const AlignmentStats & cur_start_align_stats = start_align_search_paths.at(cur_extension.start_search_path_idx).read_align_stats.back();
 
-            auto end_search_paths_start_nodes_index_it = end_search_paths_start_nodes_index.find(cur_paired_align_search_path.first.path.back());
+        assert(!cur_extension.gbwt_search.first.empty());
+
+        const gbwt::node_type cur_node = cur_extension.gbwt_search.first.node;
+        const bool is_extended = cur_extension.isExtended();
+
+        if (is_extended) {
+
+            auto end_search_paths_start_nodes_index_it = end_search_paths_start_nodes_index.find(cur_node);
 
             if (end_search_paths_start_nodes_index_it != end_search_paths_start_nodes_index.end()) {
 
+                const AlignmentSearchPath cur_paired_align_search_path = pairedSearchExtensionToAlignmentSearchPath(cur_extension, start_align_search_paths, search_path_arena);
+                assert(cur_paired_align_search_path.path.back() == cur_node);
+
                 for (auto end_alignment_idx: end_search_paths_start_nodes_index_it->second) {
 
-                    AlignmentSearchPath complete_paired_align_search_path = cur_paired_align_search_path.first;
+                    AlignmentSearchPath complete_paired_align_search_path = cur_paired_align_search_path;
                     complete_paired_align_search_path.insert_length -= complete_paired_align_search_path.end_offset;
 
                     complete_paired_align_search_path.end_offset = end_align_search_paths.at(end_alignment_idx).start_offset;
                     complete_paired_align_search_path.insert_length += complete_paired_align_search_path.end_offset;
 
-                    mergeAlignmentSearchPath(&complete_paired_align_search_path, cur_paired_align_search_path.first.path.size() - 1, end_align_search_paths.at(end_alignment_idx));
+                    mergeAlignmentSearchPath(&complete_paired_align_search_path, cur_paired_align_search_path.path.size() - 1, end_align_search_paths.at(end_alignment_idx), gbwt_records);
 
                     if (!complete_paired_align_search_path.gbwt_search.first.empty() && complete_paired_align_search_path.fragmentLength() <= max_pair_frag_length) {
 
@@ -942,7 +1075,7 @@ void AlignmentPathFinder<AlignmentType>::findPairedAlignmentSearchPaths(vector<A
 
         if (!end_alignment_in_cycle) {
 
-            auto end_search_paths_nodes_it = end_search_paths_nodes.find(cur_paired_align_search_path.first.path.back());
+            auto end_search_paths_nodes_it = end_search_paths_nodes.find(cur_node);
 
             if (end_search_paths_nodes_it != end_search_paths_nodes.end()) {
 
@@ -952,44 +1085,53 @@ void AlignmentPathFinder<AlignmentType>::findPairedAlignmentSearchPaths(vector<A
                 }
             }
         }
-           
-        if (cur_paired_align_search_path.first.fragmentLength() + end_alignment.sequence().size() - end_max_left_softclip_length > max_pair_frag_length) {
+
+        // Fragment length of the current extension (see AlignmentSearchPath::fragmentLength()).
+        const int32_t cur_fragment_length = (cur_extension.insert_length == 0) ? cur_start_align_stats.length : (static_cast<int32_t>(cur_start_align_stats.length) + cur_extension.insert_length - static_cast<int32_t>(cur_start_align_stats.clippedOffsetRightBases()));
+        assert(cur_fragment_length >= 0);
+
+        if (cur_fragment_length + end_alignment.sequenceLength() - end_max_left_softclip_length > max_pair_frag_length) {
 
             continue;
         }
 
-        auto out_edges = paths_index.edges(cur_paired_align_search_path.first.gbwt_search.first.node);
+        const vector<gbwt::node_type> & out_nodes = paths_index.successors(cur_extension.gbwt_search.first.node);
 
         // End current extension if no outgoing edges exist.
-        if (out_edges.empty()) {
+        if (out_nodes.empty()) {
 
             continue;
         }
 
-        auto out_edges_it = out_edges.begin(); 
-        assert(out_edges_it != out_edges.end());
-        
-        while (out_edges_it != out_edges.end()) {
+        // Fragment length excluding the right clipped offset bases of the start alignment, 
+        // which are only subtracted once the path has been extended.
+        const int32_t cur_extended_fragment_length = static_cast<int32_t>(cur_start_align_stats.length) + cur_extension.insert_length - static_cast<int32_t>(cur_start_align_stats.clippedOffsetRightBases());
+
+        for (auto & out_node: out_nodes) {
+
+            if (is_extended || out_node != cur_start_align_stats.internal_end_next_node) {
 
-            if (out_edges_it->first != gbwt::ENDMARKER && out_edges_it->first != cur_paired_align_search_path.first.read_align_stats.back().internal_end_next_node) {
+                // Skip extension if the end alignment can not be reached within the maximum fragment length.
+                if (paths_index.bidirectional()) {
 
-                auto extended_gbwt_search = cur_paired_align_search_path.first.gbwt_search;
-                paths_index.extend(&extended_gbwt_search, out_edges_it->first);
+                    auto end_search_paths_distances_it = end_search_paths_distances.find(out_node);
+
+                    if (end_search_paths_distances_it == end_search_paths_distances.end() || cur_extended_fragment_length + end_search_paths_distances_it->second > static_cast<int32_t>(max_pair_frag_length)) {
+
+                        continue;
+                    }
+                }
+
+                auto extended_gbwt_search = cur_extension.gbwt_search;
+                paths_index.extend(&extended_gbwt_search, out_node, gbwt_records);
 
                 // Add new extension to queue if not empty (path found).
                 if (!extended_gbwt_search.first.empty()) { 
 
-                    paired_align_search_path_stack.emplace(cur_paired_align_search_path.first, true);
-
-                    paired_align_search_path_stack.top().first.path.emplace_back(extended_gbwt_search.first.node);
-                    paired_align_search_path_stack.top().first.gbwt_search = extended_gbwt_search;
-                    paired_align_search_path_stack.top().first.end_offset = paths_index.nodeLength(gbwt::Node::id(paired_align_search_path_stack.top().first.path.back()));
-                    paired_align_search_path_stack.top().first.insert_length += paired_align_search_path_stack.top().first.end_offset;
-                    paired_align_search_path_stack.top().first.read_align_stats.back().internal_end_next_node = gbwt::ENDMARKER;
+                    paired_search_extension_stack.emplace(paired_search_extensions.size());
+                    paired_search_extensions.emplace_back(PairedSearchExtension(cur_extension.start_search_path_idx, search_path_arena.addNode(cur_extension.path_node_idx, extended_gbwt_search.first.node), extended_gbwt_search, cur_extension.insert_length + paths_index.nodeLength(gbwt::Node::id(extended_gbwt_search.first.node))));
                 }
             }
-
-            ++out_edges_it;
         }
     }
 
@@ -1003,7 +1145,75 @@ void AlignmentPathFinder<AlignmentType>::findPairedAlignmentSearchPaths(vector<A
 }
 
 template<class AlignmentType>
-void AlignmentPathFinder<AlignmentType>::mergeAlignmentSearchPath(AlignmentSearchPath * main_align_search_path, uint32_t main_path_start_idx, const AlignmentSearchPath & second_align_search_path) const {
+void AlignmentPathFinder<AlignmentType>::findEndSearchPathsDistances(spp::sparse_hash_map<gbwt::node_type, int32_t> * end_search_paths_distances, const vector<AlignmentSearchPath> & end_align_search_paths, const spp::sparse_hash_map<gbwt::node_type, vector<uint32_t> > & end_search_paths_start_nodes_index) const {
+
+    assert(paths_index.bidirectional());
+    assert(end_search_paths_distances->empty());
+
+    // Min-heap of (distance, node) pairs.
+    priority_queue<pair<int32_t, gbwt::node_type>, vector<pair<int32_t, gbwt::node_type> >, greater<pair<int32_t, gbwt::node_type> > > distance_queue;
+
+    for (auto & end_search_paths_start_node: end_search_paths_start_nodes_index) {
+
+        int32_t min_end_distance = numeric_limits<int32_t>::max();
+
+        // Number of fragment bases added when merging the end alignment at its start node.
+        for (auto end_alignment_idx: end_search_paths_start_node.second) {
+
+            const AlignmentSearchPath & end_search_path = end_align_search_paths.at(end_alignment_idx);
+            min_end_distance = min(min_end_distance, static_cast<int32_t>(end_search_path.start_offset + end_search_path.read_align_stats.back().length) - static_cast<int32_t>(end_search_path.read_align_stats.back().clippedOffsetLeftBases()));
+        }
+
+        distance_queue.emplace(min_end_distance, end_search_paths_start_node.first);
+    }
+
+    // Bounded Dijkstra search backwards from the start nodes of the end 
+    // alignment using the edges of the reverse nodes.
+    while (!distance_queue.empty()) {
+
+        const pair<int32_t, gbwt::node_type> cur_distance = distance_queue.top();
+        distance_queue.pop();
+
+        if (cur_distance.first > static_cast<int32_t>(max_pair_frag_length)) {
+
+            break;
+        }
+
+        if (!end_search_paths_distances->emplace(cur_distance.second, cur_distance.first).second) {
+
+            continue;
+        }
+
+        for (auto & reverse_node: paths_index.successors(gbwt::Node::reverse(cur_distance.second))) {
+
+            const gbwt::node_type prev_node = gbwt::Node::reverse(reverse_node);
+
+            if (end_search_paths_distances->find(prev_node) == end_search_paths_distances->end()) {
+
+                distance_queue.emplace(cur_distance.first + paths_index.nodeLength(gbwt::Node::id(prev_node)), prev_node);
+            }
+        }
+    }
+}
+
+template<class AlignmentType>
+AlignmentSearchPath AlignmentPathFinder<AlignmentType>::pairedSearchExtensionToAlignmentSearchPath(const PairedSearchExtension & extension, const vector<AlignmentSearchPath> & start_align_search_paths, const SearchPathArena & search_path_arena) const {
+
+    assert(extension.isExtended());
+
+    AlignmentSearchPath align_search_path = start_align_search_paths.at(extension.start_search_path_idx);
+    search_path_arena.getPath(&(align_search_path.path), extension.path_node_idx);
+
+    align_search_path.gbwt_search = extension.gbwt_search;
+    align_search_path.end_offset = paths_index.nodeLength(gbwt::Node::id(extension.gbwt_search.first.node));
+    align_search_path.insert_length = extension.insert_length;
+    align_search_path.read_align_stats.back().internal_end_next_node = gbwt::ENDMARKER;
+
+    return align_search_path;
+}
+
+template<class AlignmentType>
+void AlignmentPathFinder<AlignmentType>::mergeAlignmentSearchPath(AlignmentSearchPath * main_align_search_path, uint32_t main_path_start_idx, const AlignmentSearchPath & second_align_search_path, const GBWTRecordBatch & gbwt_records) const {
 
     assert(!main_align_search_path->gbwt_search.first.empty());
     assert(!second_align_search_path.gbwt_search.first.empty());
@@ -1122,7 +1332,7 @@ void AlignmentPathFinder<AlignmentType>::mergeAlignmentSearchPath(AlignmentSearc
     while (second_path_start_idx < second_align_search_path.path.size()) {
 
         main_align_search_path->path.emplace_back(second_align_search_path.path.at(second_path_start_idx));
-        paths_index.extend(&(main_align_search_path->gbwt_search), main_align_search_path->path.back());
+        paths_index.extend(&(main_align_search_path->gbwt_search), main_align_search_path->path.back(), gbwt_records);
 
         if (main_align_search_path->gbwt_search.first.empty()) {
 
@@ -1159,14 +1369,14 @@ vector<gbwt::node_type> AlignmentPathFinder<AlignmentType>::getAlignmentStartNod
 }
 
 template<class AlignmentType>
-vector<uint32_t> AlignmentPathFinder<AlignmentType>::getAlignmentStartSoftclipLengths(const vg::MultipathAlignment & alignment) const {
+vector<uint32_t> AlignmentPathFinder<AlignmentType>::getAlignmentStartSoftclipLengths(const AlignmentView<vg::MultipathAlignment> & alignment) const {
 
     vector<uint32_t> start_softclip_lengths;
     AlignmentStats read_align_stats;
 
-    for (auto & start_idx: alignment.start()) {
+    for (uint32_t i = 0; i < alignment.startSize(); ++i) {
 
-        read_align_stats.updateLeftSoftclipLength(alignment.subpath(start_idx).path());
+        read_align_stats.updateLeftSoftclipLength(alignment.subpathPath(alignment.start(i)));
         start_softclip_lengths.emplace_back(read_align_stats.left_softclip_length);
     }
 
@@ -1175,16 +1385,16 @@ vector<uint32_t> AlignmentPathFinder<AlignmentType>::getAlignmentStartSoftclipLe
 }
 
 template<class AlignmentType>
-vector<uint32_t> AlignmentPathFinder<AlignmentType>::getAlignmentEndSoftclipLengths(const vg::MultipathAlignment & alignment) const {
+vector<uint32_t> AlignmentPathFinder<AlignmentType>::getAlignmentEndSoftclipLengths(const AlignmentView<vg::MultipathAlignment> & alignment) const {
 
     vector<uint32_t> end_softclip_lengths;
     AlignmentStats read_align_stats;
 
-    for (auto & subpath: alignment.subpath()) {
+    for (uint32_t i = 0; i < alignment.subpathSize(); ++i) {
 
-        if (subpath.next_size() == 0) {
+        if (alignment.subpathNextSize(i) == 0) {
 
-            read_align_stats.updateRightSoftclipLength(subpath.path());
+            read_align_stats.updateRightSoftclipLength(alignment.subpathPath(i));
             end_softclip_lengths.emplace_back(read_align_stats.right_softclip_length);
         }
     }
@@ -8,10 +8,29 @@
 #include "vg/io/basic_stream.hpp"
 #include "paths_index.hpp"
 #include "alignment_path.hpp"
+#include "alignment_view.hpp"
 
 using namespace std;
 
 
+// Path extension in the paired alignment search tree. The extended 
+// path nodes are stored in a SearchPathArena.
+struct PairedSearchExtension {
+
+    uint32_t start_search_path_idx;
+    uint32_t path_node_idx;
+
+    pair<gbwt::SearchState, gbwt::size_type> gbwt_search;
+    int32_t insert_length;
+
+    PairedSearchExtension(const uint32_t start_search_path_idx_in, const uint32_t path_node_idx_in, const pair<gbwt::SearchState, gbwt::size_type> & gbwt_search_in, const int32_t insert_length_in) : start_search_path_idx(start_search_path_idx_in), path_node_idx(path_node_idx_in), gbwt_search(gbwt_search_in), insert_length(insert_length_in) {}
+
+    bool isExtended() const {
+
+        return (path_node_idx != SearchPathArena::no_node_idx);
+    }
+};
+
 template<class AlignmentType> 
 class AlignmentPathFinder {
 
@@ -22,6 +41,17 @@ class AlignmentPathFinder {
 		vector<AlignmentPath> findAlignmentPaths(const AlignmentType & alignment) const;
 		vector<AlignmentPath> findPairedAlignmentPaths(const AlignmentType & alignment_1, const AlignmentType & alignment_2) const;
 
+		// Same as above for alignments decoded without their sequence 
+		// (see AlignmentDecoder), where the sequence lengths are given.
+		vector<AlignmentPath> findAlignmentPaths(const AlignmentType & alignment, const uint32_t seq_length) const;
+		vector<AlignmentPath> findPairedAlignmentPaths(const AlignmentType & alignment_1, const uint32_t seq_length_1, const AlignmentType & alignment_2, const uint32_t seq_length_2) const;
+
+		// Finds the alignment paths of each alignment (or interleaved 
+		// pair) in a batch. The GBWT records of all nodes in the batch 
+		// are decoded once and shared by the searches of all alignments.
+		void findAlignmentPaths(vector<vector<AlignmentPath> > * align_paths_batch, const vector<AlignmentType> & alignments, const vector<uint32_t> & seq_lengths) const;
+		void findPairedAlignmentPaths(vector<vector<AlignmentPath> > * align_paths_batch, const vector<AlignmentType> & alignments, const vector<uint32_t> & seq_lengths) const;
+
 	private:
 
        	const PathsIndex & paths_index;
@@ -34,36 +64,47 @@ class AlignmentPathFinder {
        	const int32_t max_score_diff;
        	const double min_best_score_filter;
 
+		vector<AlignmentPath> findAlignmentPaths(const AlignmentType & alignment, const uint32_t seq_length, const GBWTRecordBatch & gbwt_records) const;
+		vector<AlignmentPath> findPairedAlignmentPaths(const AlignmentType & alignment_1, const uint32_t seq_length_1, const AlignmentType & alignment_2, const uint32_t seq_length_2, const GBWTRecordBatch & gbwt_records) const;
+
+		bool searchForward() const;
+		bool searchReverse() const;
+
+		void addAlignmentNodes(vector<gbwt::node_type> * gbwt_nodes, const vg::Path & path, const bool add_forward, const bool add_reverse) const;
+		void addAlignmentNodes(vector<gbwt::node_type> * gbwt_nodes, const vg::Alignment & alignment, const bool add_forward, const bool add_reverse) const;
+		void addAlignmentNodes(vector<gbwt::node_type> * gbwt_nodes, const vg::MultipathAlignment & alignment, const bool add_forward, const bool add_reverse) const;
+
 		bool alignmentHasPath(const vg::Alignment & alignment) const;
 		bool alignmentHasPath(const vg::MultipathAlignment & alignment) const;
 		
        	bool alignmentStartInGraph(const AlignmentType & alignment) const;
 
        	int32_t alignmentScore(const char & quality) const;
-		int32_t alignmentScore(const string & quality, const uint32_t & start_offset, const uint32_t & length) const;
+		int32_t alignmentScore(const QualityView & quality, const uint32_t & start_offset, const uint32_t & length) const;
 
-       	int32_t optimalAlignmentScore(const string & quality, const uint32_t seq_length) const;
-		int32_t optimalAlignmentScore(const vg::Alignment & alignment) const;
-		int32_t optimalAlignmentScore(const vg::MultipathAlignment & alignment) const;
+       	int32_t optimalAlignmentScore(const QualityView & quality, const uint32_t seq_length) const;
 
-		vector<AlignmentSearchPath> extendAlignmentSearchPath(const AlignmentSearchPath & align_search_path, const vg::Alignment & alignment) const;
+		vector<AlignmentSearchPath> extendAlignmentSearchPath(const AlignmentSearchPath & align_search_path, const AlignmentView<vg::Alignment> & alignment, const GBWTRecordBatch & gbwt_records) const;
 
-		void extendAlignmentSearchPath(vector<AlignmentSearchPath> * align_search_paths, const vg::Path & path, const bool is_first_path, const bool is_last_path, const string & quality, const uint32_t seq_length, const bool add_internal_start) const;
-		void extendAlignmentSearchPath(AlignmentSearchPath * align_search_path, const vg::Mapping & mapping) const;
+		void extendAlignmentSearchPath(vector<AlignmentSearchPath> * align_search_paths, const PathView & path, const bool is_first_path, const bool is_last_path, const QualityView & quality, const uint32_t seq_length, const bool add_internal_start, const GBWTRecordBatch & gbwt_records) const;
+		void extendAlignmentSearchPath(AlignmentSearchPath * align_search_path, const MappingView & mapping, const GBWTRecordBatch & gbwt_records) const;
 
-		vector<AlignmentSearchPath> extendAlignmentSearchPath(const AlignmentSearchPath & align_search_path, const vg::MultipathAlignment & alignment) const;
-		void extendAlignmentSearchPaths(vector<AlignmentSearchPath> * align_search_paths, const AlignmentSearchPath & init_align_search_path, const google::protobuf::RepeatedPtrField<vg::Subpath> & subpaths, const uint32_t start_subpath_idx, const string & quality, const uint32_t seq_length, spp::sparse_hash_map<pair<uint32_t, uint32_t>, int32_t> * internal_node_subpaths, int32_t * best_align_score, const bool has_right_bonus) const;
+		vector<AlignmentSearchPath> extendAlignmentSearchPath(const AlignmentSearchPath & align_search_path, const AlignmentView<vg::MultipathAlignment> & alignment, const GBWTRecordBatch & gbwt_records) const;
+		void extendAlignmentSearchPaths(vector<AlignmentSearchPath> * align_search_paths, const AlignmentSearchPath & init_align_search_path, const AlignmentView<vg::MultipathAlignment> & alignment, const uint32_t start_subpath_idx, spp::sparse_hash_map<pair<uint32_t, uint32_t>, int32_t> * internal_node_subpaths, int32_t * best_align_score, const bool has_right_bonus, SearchPathArena * search_path_arena, const GBWTRecordBatch & gbwt_records) const;
 		
-		void findAlignmentSearchPaths(vector<AlignmentSearchPath> * align_search_paths, const AlignmentType & alignment) const;
-		void findPairedAlignmentSearchPaths(vector<AlignmentSearchPath> * paired_align_search_paths, const AlignmentType & start_alignment, const AlignmentType & end_alignment) const;
+		void findAlignmentSearchPaths(vector<AlignmentSearchPath> * align_search_paths, const AlignmentView<AlignmentType> & alignment, const GBWTRecordBatch & gbwt_records) const;
+		void findPairedAlignmentSearchPaths(vector<AlignmentSearchPath> * paired_align_search_paths, const AlignmentView<AlignmentType> & start_alignment, const AlignmentView<AlignmentType> & end_alignment, const GBWTRecordBatch & gbwt_records) const;
+
+		void findEndSearchPathsDistances(spp::sparse_hash_map<gbwt::node_type, int32_t> * end_search_paths_distances, const vector<AlignmentSearchPath> & end_align_search_paths, const spp::sparse_hash_map<gbwt::node_type, vector<uint32_t> > & end_search_paths_start_nodes_index) const;
+		AlignmentSearchPath pairedSearchExtensionToAlignmentSearchPath(const PairedSearchExtension & extension, const vector<AlignmentSearchPath> & start_align_search_paths, const SearchPathArena & search_path_arena) const;
 
-		void mergeAlignmentSearchPath(AlignmentSearchPath * main_align_search_path, uint32_t main_path_start_idx, const AlignmentSearchPath & second_align_search_path) const;
+		void mergeAlignmentSearchPath(AlignmentSearchPath * main_align_search_path, uint32_t main_path_start_idx, const AlignmentSearchPath & second_align_search_path, const GBWTRecordBatch & gbwt_records) const;
 
 		vector<gbwt::node_type> getAlignmentStartNodes(const vg::Alignment & alignment) const;
 		vector<gbwt::node_type> getAlignmentStartNodes(const vg::MultipathAlignment & alignment) const;
 
-		vector<uint32_t> getAlignmentStartSoftclipLengths(const vg::MultipathAlignment & alignment) const;
-		vector<uint32_t> getAlignmentEndSoftclipLengths(const vg::MultipathAlignment & alignment) const;
+		vector<uint32_t> getAlignmentStartSoftclipLengths(const AlignmentView<vg::MultipathAlignment> & alignment) const;
+		vector<uint32_t> getAlignmentEndSoftclipLengths(const AlignmentView<vg::MultipathAlignment> & alignment) const;
 
 		bool isAlignmentDisconnected(const vg::Alignment & alignment) const;
 		bool isAlignmentDisconnected(const vg::MultipathAlignment & alignment) const;
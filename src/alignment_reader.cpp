@@ -0,0 +1,227 @@
+
+#include "alignment_reader.hpp"
+
+#include <iostream>
+#include <stdexcept>
+#include <assert.h>
+
+static const uint32_t num_read_ahead_batches = 3;
+
+// Type tags written by vg as the first message of each group.
+static bool isAlignmentTypeTag(const string & message) {
+
+    return (message == "GAM" || message == "GAMP");
+}
+
+
+AlignmentReader::AlignmentReader(const string & filename, const uint32_t batch_size_in, const uint32_t num_threads) : batch_size(batch_size_in), num_group_messages_left(0), is_group_start(false), is_cancelled(false) {
+
+    assert(batch_size > 0);
+
+    alignments_stream = bgzf_open(filename.c_str(), "r");
+
+    if (!alignments_stream) {
+
+        throw runtime_error("Could not open alignment file " + filename);
+    }
+
+    if (num_threads > 1) {
+
+        bgzf_mt(alignments_stream, num_threads, 256);
+    }
+
+    batch_queue = new ProducerConsumerQueue<vector<string> *>(num_read_ahead_batches);
+    reading_thread = thread(&AlignmentReader::read, this);
+}
+
+AlignmentReader::~AlignmentReader() {
+
+    for (auto & buffered_batch: buffered_batches) {
+
+        delete buffered_batch;
+    }
+
+    is_cancelled.store(true, memory_order_relaxed);
+
+    vector<string> * batch = nullptr;
+
+    // Drain the queue so that a reading thread waiting on a full queue
+    // can see the cancellation and finish.
+    while (batch_queue->pop(&batch)) {
+
+        delete batch;
+    }
+
+    reading_thread.join();
+    delete batch_queue;
+
+    if (bgzf_close(alignments_stream) != 0) {
+
+        cerr << "WARNING: Could not close alignment file." << endl;
+    }
+}
+
+bool AlignmentReader::nextBatch(vector<string> * serialized_alignments) {
+
+    if (!buffered_batches.empty()) {
+
+        serialized_alignments->swap(*buffered_batches.front());
+
+        delete buffered_batches.front();
+        buffered_batches.pop_front();
+
+        return true;
+    }
+
+    vector<string> * batch = nullptr;
+
+    if (batch_queue->pop(&batch)) {
+
+        serialized_alignments->swap(*batch);
+        delete batch;
+
+        return true;
+    }
+
+    if (reading_exception) {
+
+        rethrow_exception(reading_exception);
+    }
+
+    serialized_alignments->clear();
+    return false;
+}
+
+const vector<string> * AlignmentReader::bufferBatch() {
+
+    vector<string> * batch = nullptr;
+
+    if (batch_queue->pop(&batch)) {
+
+        buffered_batches.push_back(batch);
+        return batch;
+    }
+
+    if (reading_exception) {
+
+        rethrow_exception(reading_exception);
+    }
+
+    return nullptr;
+}
+
+void AlignmentReader::read() {
+
+    auto batch = new vector<string>();
+    batch->reserve(batch_size);
+
+    try {
+
+        string message;
+
+        while (!is_cancelled.load(memory_order_relaxed) && readMessage(&message)) {
+
+            batch->emplace_back(move(message));
+
+            if (batch->size() == batch_size) {
+
+                batch_queue->push(batch);
+
+                batch = new vector<string>();
+                batch->reserve(batch_size);
+            }
+        }
+
+    } catch (...) {
+
+        reading_exception = current_exception();
+    }
+
+    if (!batch->empty() && !reading_exception) {
+
+        batch_queue->push(batch);
+
+    } else {
+
+        delete batch;
+    }
+
+    batch_queue->pushedLast();
+}
+
+bool AlignmentReader::readMessage(string * message) {
+
+    while (true) {
+
+        while (num_group_messages_left == 0) {
+
+            if (!readVarint(&num_group_messages_left)) {
+
+                return false;
+            }
+
+            is_group_start = true;
+        }
+
+        uint64_t message_length = 0;
+
+        if (!readVarint(&message_length)) {
+
+            throw runtime_error("Truncated alignment file (missing message length)");
+        }
+
+        readBytes(message, message_length);
+        --num_group_messages_left;
+
+        if (is_group_start) {
+
+            is_group_start = false;
+
+            if (isAlignmentTypeTag(*message)) {
+
+                continue;
+            }
+        }
+
+        return true;
+    }
+}
+
+bool AlignmentReader::readVarint(uint64_t * value) {
+
+    *value = 0;
+
+    for (uint32_t shift = 0; shift < 64; shift += 7) {
+
+        const int byte = bgzf_getc(alignments_stream);
+
+        if (byte < 0) {
+
+            if (byte == -1 && shift == 0) {
+
+                return false;
+            }
+
+            throw runtime_error("Truncated alignment file (incomplete varint)");
+        }
+
+        *value |= static_cast<uint64_t>(byte & 0x7f) << shift;
+
+        if ((byte & 0x80) == 0) {
+
+            return true;
+        }
+    }
+
+    throw runtime_error("Malformed alignment file (varint too long)");
+}
+
+void AlignmentReader::readBytes(string * bytes, const uint64_t length) {
+
+    bytes->resize(length);
+
+    if (length > 0 && bgzf_read(alignments_stream, &((*bytes)[0]), length) != static_cast<ssize_t>(length)) {
+
+        throw runtime_error("Truncated alignment file (incomplete message)");
+    }
+}
@@ -0,0 +1,71 @@
+
+#ifndef RPVG_SRC_ALIGNMENTREADER_HPP
+#define RPVG_SRC_ALIGNMENTREADER_HPP
+
+#include <string>
+#include <vector>
+#include <deque>
+#include <thread>
+#include <atomic>
+#include <exception>
+
+#include "htslib/bgzf.h"
+#include "htslib/hts.h"
+
+#include "producer_consumer_queue.hpp"
+
+using namespace std;
+
+
+// Reads serialized alignments from a GAM or GAMP file. The file consists
+// of groups of length-prefixed protobuf messages, where the first message
+// of a group can be a type tag, and is either BGZF-compressed or
+// uncompressed. A filename of "-" reads from stdin. Compressed blocks are
+// read ahead and decompressed by a htslib thread pool, while a separate
+// reading thread splits the stream into batches of serialized alignments.
+class AlignmentReader {
+
+    public:
+
+        AlignmentReader(const string & filename, const uint32_t batch_size_in, const uint32_t num_threads);
+
+        // Stops the reading thread after its current message, without
+        // reading the rest of the file.
+        ~AlignmentReader();
+
+        // Returns false when all batches have been read. Batches contain
+        // batch_size alignments, except for the last batch. Throws
+        // runtime_error if the file is malformed.
+        bool nextBatch(vector<string> * serialized_alignments);
+
+        // Reads the next batch and keeps it buffered, such that it is
+        // still returned by nextBatch(). Returns nullptr when all batches
+        // have been read.
+        const vector<string> * bufferBatch();
+
+    private:
+
+        const uint32_t batch_size;
+
+        BGZF * alignments_stream;
+
+        uint64_t num_group_messages_left;
+        bool is_group_start;
+
+        ProducerConsumerQueue<vector<string> *> * batch_queue;
+        thread reading_thread;
+        atomic<bool> is_cancelled;
+
+        deque<vector<string> *> buffered_batches;
+
+        exception_ptr reading_exception;
+
+        void read();
+
+        bool readMessage(string * message);
+        bool readVarint(uint64_t * value);
+        void readBytes(string * bytes, const uint64_t length);
+};
+
+
+#endif
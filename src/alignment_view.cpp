@@ -0,0 +1,82 @@
+
+#include "alignment_view.hpp"
+
+
+gbwt::node_type MappingView::gbwtNode() const {
+
+    return gbwt::Node::encode(mapping.position().node_id(), mapping.position().is_reverse() != is_reverse);
+}
+
+uint32_t MappingView::offset() const {
+
+    if (is_reverse) {
+
+        const uint32_t node_length = paths_index.nodeLength(mapping.position().node_id());
+        assert(fromLength() + mapping.position().offset() <= node_length);
+
+        return (node_length - fromLength() - mapping.position().offset());
+
+    } else {
+
+        return mapping.position().offset();
+    }
+}
+
+
+AlignmentView<vg::MultipathAlignment>::AlignmentView(const vg::MultipathAlignment & alignment_in, const uint32_t sequence_length_in, const bool is_reverse_in, const PathsIndex & paths_index_in) : alignment(alignment_in), sequence_length(sequence_length_in), is_reverse(is_reverse_in), paths_index(paths_index_in) {
+
+    if (is_reverse) {
+
+        const uint32_t num_subpaths = alignment.subpath_size();
+
+        reverse_subpath_nexts = vector<vector<uint32_t> >(num_subpaths);
+        reverse_subpath_connection_sizes = vector<uint32_t>(num_subpaths, 0);
+
+        // Iterate in reverse to keep the edges and starts sorted.
+        for (int32_t i = num_subpaths - 1; i >= 0; --i) {
+
+            const vg::Subpath & subpath = alignment.subpath(i);
+
+            for (auto & next_subpath_idx: subpath.next()) {
+
+                reverse_subpath_nexts.at(num_subpaths - next_subpath_idx - 1).emplace_back(num_subpaths - i - 1);
+            }
+
+            for (auto & connection: subpath.connection()) {
+
+                reverse_subpath_connection_sizes.at(num_subpaths - connection.next() - 1)++;
+            }
+
+            // Sinks become starts in reverse if the original starts are labeled.
+            if (alignment.start_size() > 0 && subpath.next_size() == 0 && subpath.connection_size() == 0) {
+
+                reverse_starts.emplace_back(num_subpaths - i - 1);
+            }
+        }
+    }
+}
+
+uint32_t AlignmentView<vg::MultipathAlignment>::startSize() const {
+
+    return (is_reverse ? reverse_starts.size() : alignment.start_size());
+}
+
+uint32_t AlignmentView<vg::MultipathAlignment>::start(const uint32_t idx) const {
+
+    return (is_reverse ? reverse_starts.at(idx) : alignment.start(idx));
+}
+
+uint32_t AlignmentView<vg::MultipathAlignment>::subpathNextSize(const uint32_t subpath_idx) const {
+
+    return (is_reverse ? reverse_subpath_nexts.at(subpath_idx).size() : alignment.subpath(subpath_idx).next_size());
+}
+
+uint32_t AlignmentView<vg::MultipathAlignment>::subpathNext(const uint32_t subpath_idx, const uint32_t next_idx) const {
+
+    return (is_reverse ? reverse_subpath_nexts.at(subpath_idx).at(next_idx) : alignment.subpath(subpath_idx).next(next_idx));
+}
+
+uint32_t AlignmentView<vg::MultipathAlignment>::subpathConnectionSize(const uint32_t subpath_idx) const {
+
+    return (is_reverse ? reverse_subpath_connection_sizes.at(subpath_idx) : alignment.subpath(subpath_idx).connection_size());
+}
@@ -0,0 +1,167 @@
+
+#ifndef RPVG_SRC_ALIGNMENTVIEW_HPP
+#define RPVG_SRC_ALIGNMENTVIEW_HPP
+
+#include <vector>
+#include <string>
+
+#include "gbwt/gbwt.h"
+#include "vg/io/basic_stream.hpp"
+
+#include "paths_index.hpp"
+#include "utils.hpp"
+
+using namespace std;
+
+
+// Strand-aware views of alignments. A reverse view corresponds to the
+// alignment returned by Utils::lazy_reverse_complement_alignment(), but
+// is computed on access without copying the alignment. The sequence
+// length is given separately, because AlignmentDecoder does not decode
+// the sequence itself.
+
+class QualityView {
+
+    public:
+
+        QualityView(const string & quality_in, const bool is_reverse_in) : quality(quality_in), is_reverse(is_reverse_in) {}
+
+        bool empty() const { return quality.empty(); }
+        uint32_t size() const { return quality.size(); }
+
+        char at(const uint32_t idx) const {
+
+            return (is_reverse ? quality.at(quality.size() - idx - 1) : quality.at(idx));
+        }
+
+        char front() const { return at(0); }
+        char back() const { return at(quality.size() - 1); }
+
+    private:
+
+        const string & quality;
+        const bool is_reverse;
+};
+
+class MappingView {
+
+    public:
+
+        MappingView(const vg::Mapping & mapping_in, const bool is_reverse_in, const PathsIndex & paths_index_in) : mapping(mapping_in), is_reverse(is_reverse_in && mapping_in.position().node_id() != 0), paths_index(paths_index_in) {}
+
+        gbwt::node_type gbwtNode() const;
+        uint32_t offset() const;
+
+        uint32_t fromLength() const { return Utils::mapping_from_length(mapping); }
+        uint32_t toLength() const { return Utils::mapping_to_length(mapping); }
+
+        uint32_t editSize() const { return mapping.edit_size(); }
+
+        const vg::Edit & edit(const uint32_t idx) const {
+
+            return (is_reverse ? mapping.edit(mapping.edit_size() - idx - 1) : mapping.edit(idx));
+        }
+
+    private:
+
+        const vg::Mapping & mapping;
+        const bool is_reverse;
+
+        const PathsIndex & paths_index;
+};
+
+class PathView {
+
+    public:
+
+        PathView(const vg::Path & path_in, const bool is_reverse_in, const PathsIndex & paths_index_in) : path(path_in), is_reverse(is_reverse_in), paths_index(paths_index_in) {}
+
+        uint32_t mappingSize() const { return path.mapping_size(); }
+
+        MappingView mapping(const uint32_t idx) const {
+
+            return MappingView(is_reverse ? path.mapping(path.mapping_size() - idx - 1) : path.mapping(idx), is_reverse, paths_index);
+        }
+
+    private:
+
+        const vg::Path & path;
+        const bool is_reverse;
+
+        const PathsIndex & paths_index;
+};
+
+template<class AlignmentType>
+class AlignmentView;
+
+template<>
+class AlignmentView<vg::Alignment> {
+
+    public:
+
+        AlignmentView(const vg::Alignment & alignment_in, const uint32_t sequence_length_in, const bool is_reverse_in, const PathsIndex & paths_index_in) : alignment(alignment_in), sequence_length(sequence_length_in), is_reverse(is_reverse_in), paths_index(paths_index_in) {}
+
+        uint32_t sequenceLength() const { return sequence_length; }
+        QualityView quality() const { return QualityView(alignment.quality(), is_reverse); }
+
+        int32_t mappingQuality() const { return alignment.mapping_quality(); }
+        int32_t score() const { return alignment.score(); }
+
+        PathView path() const { return PathView(alignment.path(), is_reverse, paths_index); }
+
+    private:
+
+        const vg::Alignment & alignment;
+        const uint32_t sequence_length;
+        const bool is_reverse;
+
+        const PathsIndex & paths_index;
+};
+
+template<>
+class AlignmentView<vg::MultipathAlignment> {
+
+    public:
+
+        AlignmentView(const vg::MultipathAlignment & alignment_in, const uint32_t sequence_length_in, const bool is_reverse_in, const PathsIndex & paths_index_in);
+
+        uint32_t sequenceLength() const { return sequence_length; }
+        QualityView quality() const { return QualityView(alignment.quality(), is_reverse); }
+
+        int32_t mappingQuality() const { return alignment.mapping_quality(); }
+
+        uint32_t startSize() const;
+        uint32_t start(const uint32_t idx) const;
+
+        uint32_t subpathSize() const { return alignment.subpath_size(); }
+
+        int32_t subpathScore(const uint32_t subpath_idx) const { return subpath(subpath_idx).score(); }
+        PathView subpathPath(const uint32_t subpath_idx) const { return PathView(subpath(subpath_idx).path(), is_reverse, paths_index); }
+
+        uint32_t subpathNextSize(const uint32_t subpath_idx) const;
+        uint32_t subpathNext(const uint32_t subpath_idx, const uint32_t next_idx) const;
+
+        uint32_t subpathConnectionSize(const uint32_t subpath_idx) const;
+
+    private:
+
+        const vg::MultipathAlignment & alignment;
+        const uint32_t sequence_length;
+        const bool is_reverse;
+
+        const PathsIndex & paths_index;
+
+        // Subpath edges and starts in reverse orientation (only
+        // used in reverse views).
+        vector<vector<uint32_t> > reverse_subpath_nexts;
+        vector<uint32_t> reverse_subpath_connection_sizes;
+        vector<uint32_t> reverse_starts;
+
+        const vg::Subpath & subpath(const uint32_t subpath_idx) const {
+
+            return (is_reverse ? alignment.subpath(alignment.subpath_size() - subpath_idx - 1) : alignment.subpath(subpath_idx));
+        }
+};
+
+
+#endif
@@ -0,0 +1,426 @@
+
+#include "cluster_shards.hpp"
+
+#include <iostream>
+#include <sstream>
+#include <fstream>
+#include <iomanip>
+#include <limits>
+#include <algorithm>
+#include <queue>
+#include <functional>
+
+
+static const string cluster_shard_magic = "RPVGSHARD";
+static const uint32_t cluster_shard_version = 1;
+
+// Maximum number of bytes of cluster estimates that are sorted in memory
+// at a time. Larger files are sorted in runs that are merged afterwards.
+static const uint64_t max_sort_run_bytes = 256 * 1024 * 1024;
+
+// Reads a record prefixed with its length. Returns false at end of file or
+// if the record is truncated, in which case is_truncated is set.
+static bool readRecord(BGZF * reader_stream, string * record, bool * is_truncated) {
+
+    *is_truncated = false;
+
+    uint32_t record_length = 0;
+    const int64_t read_length = bgzf_read(reader_stream, &record_length, sizeof(uint32_t));
+
+    if (read_length == 0) {
+
+        return false;
+    }
+
+    if (read_length != static_cast<int64_t>(sizeof(uint32_t))) {
+
+        *is_truncated = true;
+        return false;
+    }
+
+    record->resize(record_length);
+
+    if (record_length > 0 && bgzf_read(reader_stream, &((*record)[0]), record_length) != static_cast<int64_t>(record_length)) {
+
+        *is_truncated = true;
+        return false;
+    }
+
+    return true;
+}
+
+ClusterShardWriter::ClusterShardWriter(const string filename, const uint32_t num_threads, const uint32_t shard_idx, const uint32_t num_shards, const string & inference_model) : ThreadedOutputWriter(filename, "w", num_threads) {
+
+    auto header_sstream = stringstream();
+
+    Utils::writeBinaryString(&header_sstream, cluster_shard_magic);
+    Utils::writeBinary<uint32_t>(&header_sstream, cluster_shard_version);
+    Utils::writeBinary<uint32_t>(&header_sstream, shard_idx);
+    Utils::writeBinary<uint32_t>(&header_sstream, num_shards);
+    Utils::writeBinaryString(&header_sstream, inference_model);
+
+    auto out_sstream = new stringstream;
+    Utils::writeBinaryString(out_sstream, header_sstream.str());
+
+    output_queue->push(out_sstream);
+}
+
+void ClusterShardWriter::addCluster(const uint32_t cluster_id, const uint32_t cluster_seed_id, const vector<PathInfo> & cluster_paths, const vector<ReadPathProbabilities> & read_path_cluster_probs) {
+
+    auto cluster_sstream = stringstream();
+
+    Utils::writeBinary<uint32_t>(&cluster_sstream, cluster_id);
+    Utils::writeBinary<uint32_t>(&cluster_sstream, cluster_seed_id);
+    Utils::writeBinary<uint32_t>(&cluster_sstream, cluster_paths.size());
+
+    for (auto & path: cluster_paths) {
+
+        path.serialize(&cluster_sstream);
+    }
+
+    Utils::writeBinary<uint32_t>(&cluster_sstream, read_path_cluster_probs.size());
+
+    for (auto & read_path_probs: read_path_cluster_probs) {
+
+        read_path_probs.serialize(&cluster_sstream);
+    }
+
+    // Each record is prefixed with its length.
+    auto out_sstream = new stringstream;
+    Utils::writeBinaryString(out_sstream, cluster_sstream.str());
+
+    output_queue->push(out_sstream);
+}
+
+
+ClusterShardReader::ClusterShardReader(const string & filename) {
+
+    reader_stream = bgzf_open(filename.c_str(), "r");
+    is_valid = false;
+
+    shard_idx = 0;
+    num_shards = 0;
+
+    string header;
+    bool is_truncated = false;
+
+    if (reader_stream && readRecord(reader_stream, &header, &is_truncated)) {
+
+        auto header_sstream = stringstream(header);
+
+        if (Utils::readBinaryString(&header_sstream) == cluster_shard_magic && Utils::readBinary<uint32_t>(&header_sstream) == cluster_shard_version) {
+
+            shard_idx = Utils::readBinary<uint32_t>(&header_sstream);
+            num_shards = Utils::readBinary<uint32_t>(&header_sstream);
+            inference_model = Utils::readBinaryString(&header_sstream);
+
+            is_valid = header_sstream.good();
+        }
+    }
+}
+
+ClusterShardReader::~ClusterShardReader() {
+
+    if (reader_stream && bgzf_close(reader_stream) != 0) {
+
+        cerr << "WARNING: Could not close shard file." << endl;
+    }
+}
+
+bool ClusterShardReader::isValid() const {
+
+    return is_valid;
+}
+
+uint32_t ClusterShardReader::shardIdx() const {
+
+    return shard_idx;
+}
+
+uint32_t ClusterShardReader::numShards() const {
+
+    return num_shards;
+}
+
+const string & ClusterShardReader::inferenceModel() const {
+
+    return inference_model;
+}
+
+bool ClusterShardReader::readCluster(ShardCluster * shard_cluster) {
+
+    if (!is_valid) {
+
+        return false;
+    }
+
+    string cluster;
+    bool is_truncated = false;
+
+    if (!readRecord(reader_stream, &cluster, &is_truncated)) {
+
+        is_valid = !is_truncated;
+        return false;
+    }
+
+    auto cluster_sstream = stringstream(cluster);
+
+    shard_cluster->cluster_id = Utils::readBinary<uint32_t>(&cluster_sstream);
+    shard_cluster->cluster_seed_id = Utils::readBinary<uint32_t>(&cluster_sstream);
+
+    shard_cluster->paths = vector<PathInfo>(Utils::readBinary<uint32_t>(&cluster_sstream), PathInfo(""));
+
+    for (auto & path: shard_cluster->paths) {
+
+        path.deserialize(&cluster_sstream);
+    }
+
+    shard_cluster->read_path_probs = vector<ReadPathProbabilities>(Utils::readBinary<uint32_t>(&cluster_sstream));
+
+    for (auto & read_path_probs: shard_cluster->read_path_probs) {
+
+        read_path_probs.deserialize(&cluster_sstream);
+    }
+
+    is_valid = cluster_sstream.good();
+    return is_valid;
+}
+
+
+ClusterEstimatesWriter::ClusterEstimatesWriter(const string filename, const uint32_t num_threads) : ThreadedOutputWriter(filename, "wu", num_threads) {}
+
+void ClusterEstimatesWriter::addEstimates(const pair<uint32_t, PathClusterEstimates> & path_cluster_estimates) {
+
+    auto estimates_sstream = stringstream();
+
+    Utils::writeBinary<uint32_t>(&estimates_sstream, path_cluster_estimates.first);
+    path_cluster_estimates.second.serializeEstimates(&estimates_sstream);
+
+    auto out_sstream = new stringstream;
+    Utils::writeBinaryString(out_sstream, estimates_sstream.str());
+
+    output_queue->push(out_sstream);
+}
+
+
+ClusterEstimatesReader::ClusterEstimatesReader(const string & filename) {
+
+    reader_stream = bgzf_open(filename.c_str(), "r");
+    is_valid = (reader_stream != nullptr);
+}
+
+ClusterEstimatesReader::~ClusterEstimatesReader() {
+
+    if (reader_stream && bgzf_close(reader_stream) != 0) {
+
+        cerr << "WARNING: Could not close cluster estimates file." << endl;
+    }
+}
+
+bool ClusterEstimatesReader::isValid() const {
+
+    return is_valid;
+}
+
+bool ClusterEstimatesReader::readEstimates(pair<uint32_t, PathClusterEstimates> * path_cluster_estimates) {
+
+    if (!is_valid) {
+
+        return false;
+    }
+
+    string estimates;
+    bool is_truncated = false;
+
+    if (!readRecord(reader_stream, &estimates, &is_truncated)) {
+
+        is_valid = !is_truncated;
+        return false;
+    }
+
+    auto estimates_sstream = stringstream(estimates);
+
+    path_cluster_estimates->first = Utils::readBinary<uint32_t>(&estimates_sstream);
+    path_cluster_estimates->second.deserializeEstimates(&estimates_sstream);
+
+    is_valid = estimates_sstream.good();
+    return is_valid;
+}
+
+int64_t ClusterEstimatesReader::tell() const {
+
+    return (reader_stream ? bgzf_utell(reader_stream) : 0);
+}
+
+// Sorts the estimates by cluster id and writes them to a file.
+static void writeSortedClusterEstimates(const string & filename, vector<pair<uint32_t, PathClusterEstimates> > * path_cluster_estimates, const uint32_t num_threads) {
+
+    sort(path_cluster_estimates->begin(), path_cluster_estimates->end(), [](const pair<uint32_t, PathClusterEstimates> & lhs, const pair<uint32_t, PathClusterEstimates> & rhs) {
+
+        return (lhs.first < rhs.first);
+    });
+
+    ClusterEstimatesWriter cluster_estimates_writer(filename, num_threads);
+
+    for (auto & cur_path_cluster_estimates: *path_cluster_estimates) {
+
+        cluster_estimates_writer.addEstimates(cur_path_cluster_estimates);
+    }
+
+    cluster_estimates_writer.close();
+}
+
+static void removeSortRuns(const vector<string> & run_filenames) {
+
+    for (auto & run_filename: run_filenames) {
+
+        if (remove(run_filename.c_str()) != 0) {
+
+            cerr << "WARNING: Could not remove temporary cluster estimates file (" << run_filename << ")." << endl;
+        }
+    }
+}
+
+bool sortClusterEstimates(const string & sorted_filename, const string & filename, const uint32_t num_threads) {
+
+    ClusterEstimatesReader cluster_estimates_reader(filename);
+
+    vector<string> run_filenames;
+
+    vector<pair<uint32_t, PathClusterEstimates> > run_path_cluster_estimates;
+    uint64_t run_bytes = 0;
+
+    pair<uint32_t, PathClusterEstimates> path_cluster_estimates;
+    int64_t offset = cluster_estimates_reader.tell();
+
+    // Reads the file sequentially into sorted runs of bounded size.
+    while (cluster_estimates_reader.readEstimates(&path_cluster_estimates)) {
+
+        run_bytes += cluster_estimates_reader.tell() - offset;
+        offset = cluster_estimates_reader.tell();
+
+        run_path_cluster_estimates.emplace_back(move(path_cluster_estimates));
+
+        if (run_bytes >= max_sort_run_bytes) {
+
+            run_filenames.emplace_back(sorted_filename + ".run" + to_string(run_filenames.size()));
+            writeSortedClusterEstimates(run_filenames.back(), &run_path_cluster_estimates, num_threads);
+
+            run_path_cluster_estimates.clear();
+            run_bytes = 0;
+        }
+    }
+
+    if (!cluster_estimates_reader.isValid()) {
+
+        removeSortRuns(run_filenames);
+        return false;
+    }
+
+    if (run_filenames.empty()) {
+
+        writeSortedClusterEstimates(sorted_filename, &run_path_cluster_estimates, num_threads);
+        return true;
+    }
+
+    if (!run_path_cluster_estimates.empty()) {
+
+        run_filenames.emplace_back(sorted_filename + ".run" + to_string(run_filenames.size()));
+        writeSortedClusterEstimates(run_filenames.back(), &run_path_cluster_estimates, num_threads);
+
+        run_path_cluster_estimates.clear();
+    }
+
+    const bool is_merged = mergeClusterEstimates(sorted_filename, run_filenames, num_threads);
+    removeSortRuns(run_filenames);
+
+    return is_merged;
+}
+
+bool mergeClusterEstimates(const string & merged_filename, const vector<string> & filenames, const uint32_t num_threads) {
+
+    vector<ClusterEstimatesReader *> cluster_estimates_readers;
+    cluster_estimates_readers.reserve(filenames.size());
+
+    // Only the next estimates of each file are kept in memory.
+    vector<pair<uint32_t, PathClusterEstimates> > next_path_cluster_estimates(filenames.size());
+
+    // Cluster id of the next estimates and index of their file.
+    priority_queue<pair<uint32_t, uint32_t>, vector<pair<uint32_t, uint32_t> >, greater<pair<uint32_t, uint32_t> > > merge_queue;
+
+    for (size_t i = 0; i < filenames.size(); ++i) {
+
+        cluster_estimates_readers.emplace_back(new ClusterEstimatesReader(filenames.at(i)));
+
+        if (cluster_estimates_readers.back()->readEstimates(&(next_path_cluster_estimates.at(i)))) {
+
+            merge_queue.emplace(next_path_cluster_estimates.at(i).first, i);
+        }
+    }
+
+    ClusterEstimatesWriter cluster_estimates_writer(merged_filename, num_threads);
+    bool is_sorted = true;
+
+    while (!merge_queue.empty()) {
+
+        const uint32_t file_idx = merge_queue.top().second;
+        merge_queue.pop();
+
+        auto * cur_path_cluster_estimates = &(next_path_cluster_estimates.at(file_idx));
+        cluster_estimates_writer.addEstimates(*cur_path_cluster_estimates);
+
+        const uint32_t prev_cluster_id = cur_path_cluster_estimates->first;
+
+        if (cluster_estimates_readers.at(file_idx)->readEstimates(cur_path_cluster_estimates)) {
+
+            if (cur_path_cluster_estimates->first < prev_cluster_id) {
+
+                is_sorted = false;
+                break;
+            }
+
+            merge_queue.emplace(cur_path_cluster_estimates->first, file_idx);
+        }
+    }
+
+    cluster_estimates_writer.close();
+
+    bool is_valid = true;
+
+    for (auto & cluster_estimates_reader: cluster_estimates_readers) {
+
+        is_valid = is_valid && cluster_estimates_reader->isValid();
+        delete cluster_estimates_reader;
+    }
+
+    return (is_sorted && is_valid);
+}
+
+bool writeShardTranscriptCount(const string & filename, const double total_transcript_count) {
+
+    ofstream transcript_count_ostream(filename);
+
+    if (!transcript_count_ostream.is_open()) {
+
+        return false;
+    }
+
+    transcript_count_ostream << setprecision(numeric_limits<double>::max_digits10) << total_transcript_count << "\n";
+    transcript_count_ostream.close();
+
+    return !transcript_count_ostream.fail();
+}
+
+bool readShardTranscriptCount(const string & filename, double * total_transcript_count) {
+
+    ifstream transcript_count_istream(filename);
+
+    if (!transcript_count_istream.is_open()) {
+
+        return false;
+    }
+
+    transcript_count_istream >> *total_transcript_count;
+
+    return !transcript_count_istream.fail();
+}
@@ -0,0 +1,112 @@
+
+#ifndef RPVG_SRC_CLUSTERSHARDS_HPP
+#define RPVG_SRC_CLUSTERSHARDS_HPP
+
+#include <string>
+#include <vector>
+
+#include "htslib/bgzf.h"
+
+#include "threaded_output_writer.hpp"
+#include "read_path_probabilities.hpp"
+#include "path_cluster_estimates.hpp"
+#include "utils.hpp"
+
+using namespace std;
+
+
+// Cluster (paths and read path probabilities) stored in a shard.
+struct ShardCluster {
+
+    uint32_t cluster_id;
+    uint32_t cluster_seed_id;
+
+    vector<PathInfo> paths;
+    vector<ReadPathProbabilities> read_path_probs;
+};
+
+class ClusterShardWriter : public ThreadedOutputWriter {
+
+    public: 
+        
+        ClusterShardWriter(const string filename, const uint32_t num_threads, const uint32_t shard_idx, const uint32_t num_shards, const string & inference_model);
+        ~ClusterShardWriter() {};
+
+        void addCluster(const uint32_t cluster_id, const uint32_t cluster_seed_id, const vector<PathInfo> & cluster_paths, const vector<ReadPathProbabilities> & read_path_cluster_probs);
+};
+
+class ClusterShardReader {
+
+    public: 
+        
+        ClusterShardReader(const string & filename);
+        ~ClusterShardReader();
+
+        bool isValid() const;
+
+        uint32_t shardIdx() const;
+        uint32_t numShards() const;
+        const string & inferenceModel() const;
+
+        bool readCluster(ShardCluster * shard_cluster);
+
+    private:
+
+        BGZF * reader_stream;
+        bool is_valid;
+
+        uint32_t shard_idx;
+        uint32_t num_shards;
+        string inference_model;
+
+};
+
+// Temporary storage of inferred cluster estimates.
+class ClusterEstimatesWriter : public ThreadedOutputWriter {
+
+    public: 
+        
+        ClusterEstimatesWriter(const string filename, const uint32_t num_threads);
+        ~ClusterEstimatesWriter() {};
+
+        void addEstimates(const pair<uint32_t, PathClusterEstimates> & path_cluster_estimates);
+};
+
+class ClusterEstimatesReader {
+
+    public: 
+        
+        ClusterEstimatesReader(const string & filename);
+        ~ClusterEstimatesReader();
+
+        // False if the file could not be opened or a record is truncated
+        // or corrupt.
+        bool isValid() const;
+
+        bool readEstimates(pair<uint32_t, PathClusterEstimates> * path_cluster_estimates);
+        int64_t tell() const;
+
+    private:
+
+        BGZF * reader_stream;
+        bool is_valid;
+};
+
+// Sorts a temporary cluster estimates file by cluster id. The file is read
+// sequentially into sorted runs of bounded size, which are then merged.
+// Returns false if the file could not be read.
+bool sortClusterEstimates(const string & sorted_filename, const string & filename, const uint32_t num_threads);
+
+// Merges temporary cluster estimates files, each sorted by cluster id, into
+// a single file ordered by cluster id. Returns false if a file is not sorted
+// or could not be read.
+bool mergeClusterEstimates(const string & merged_filename, const vector<string> & filenames, const uint32_t num_threads);
+
+// Sum of the transcript counts (read count divided by effective length) of
+// a shard, which is its part of the TPM normaliser. The sum is stored with
+// full precision. Returns false if the file could not be written or read.
+bool writeShardTranscriptCount(const string & filename, const double total_transcript_count);
+bool readShardTranscriptCount(const string & filename, double * total_transcript_count);
+
+
+#endif
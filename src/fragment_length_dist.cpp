@@ -3,12 +3,18 @@
 
 #include <sstream>
 #include <string>
+#include <stdexcept>
+#include <unordered_map>
 
-#include "vg/io/protobuf_iterator.hpp"
 #include "utils.hpp"
 
 static const uint32_t frag_length_buffer_size = 1000;
 static const uint32_t max_length_sd_multiplicity = 5;
+static const double frag_length_log_prob_precision = 0.01;
+
+// Maximum total size of the leading alignments, across all readers, that
+// are buffered while searching for the distribution parameters.
+static const uint64_t max_frag_length_buffered_bytes = 256 * 1024 * 1024;
 
 FragmentLengthDist::FragmentLengthDist() : mean_(0), sd_(1) {
 
@@ -24,35 +30,66 @@ FragmentLengthDist::FragmentLengthDist(const double mean_in, const double sd_in)
     setLogProbBuffer(frag_length_buffer_size);
 }
 
-FragmentLengthDist::FragmentLengthDist(istream * alignments_istream, const bool is_multipath) {
+// Parses the leading alignments of each reader in turn until the
+// distribution parameters are found. The parsed batches remain buffered in
+// the readers, which allows streamed input to be used for both the
+// parameters and the alignments.
+FragmentLengthDist::FragmentLengthDist(const vector<unique_ptr<AlignmentReader> > & alignment_readers, const bool is_multipath) : mean_(0), sd_(0), max_length_(0) {
 
-    assert(alignments_istream->good());
+    uint64_t num_buffered_bytes = 0;
 
-    if (is_multipath) {
+    vg::Alignment alignment;
+    vg::MultipathAlignment multipath_alignment;
 
-        for (vg::io::ProtobufIterator<vg::MultipathAlignment> alignment_it(*alignments_istream); alignment_it.has_current(); ++alignment_it) {
+    for (auto & alignment_reader: alignment_readers) {
 
-            if (parseMultipathAlignment(*alignment_it)) {
+        const vector<string> * serialized_alignments = nullptr;
 
-                break;
-            }
-        }
+        while (num_buffered_bytes < max_frag_length_buffered_bytes && (serialized_alignments = alignment_reader->bufferBatch())) {
 
-    } else {
+            for (auto & serialized_alignment: *serialized_alignments) {
+
+                bool is_parsed = false;
+
+                if (is_multipath) {
+
+                    if (!multipath_alignment.ParseFromString(serialized_alignment)) {
+
+                        throw runtime_error("Could not parse " + multipath_alignment.GetTypeName());
+                    }
+
+                    is_parsed = parseMultipathAlignment(multipath_alignment);
+
+                } else {
+
+                    if (!alignment.ParseFromString(serialized_alignment)) {
 
-        for (vg::io::ProtobufIterator<vg::Alignment> alignment_it(*alignments_istream); alignment_it.has_current(); ++alignment_it) {
+                        throw runtime_error("Could not parse " + alignment.GetTypeName());
+                    }
 
-            if (parseAlignment(*alignment_it)) {
+                    is_parsed = parseAlignment(alignment);
+                }
 
-                break;
-            }        
+                if (is_parsed) {
+
+                    assert(isValid());
+
+                    setMaxLength();
+                    setLogProbBuffer(frag_length_buffer_size);
+
+                    return;
+                }
+
+                num_buffered_bytes += serialized_alignment.size();
+            }
         }
-    }
 
-    assert(isValid());
+        if (num_buffered_bytes >= max_frag_length_buffered_bytes) {
 
-    setMaxLength();
-    setLogProbBuffer(frag_length_buffer_size);
+            cerr << "WARNING: Stopped searching for fragment length distribution parameters after " << num_buffered_bytes / (1024 * 1024) << " MB of leading alignments." << endl;
+            break;
+        }
+    }
 }
 
 FragmentLengthDist::FragmentLengthDist(const vector<uint32_t> & frag_length_counts) {
@@ -175,6 +212,18 @@ double FragmentLengthDist::logProb(const uint32_t value) const {
     }
 }
 
+uint32_t FragmentLengthDist::quantizedLength(const uint32_t value) const {
+
+    if (value < quantized_length_buffer.size()) {
+
+        return quantized_length_buffer.at(value);
+    
+    } else {
+
+        return value;
+    }
+}
+
 void FragmentLengthDist::setMaxLength() {
 
     assert(isValid());
@@ -193,6 +242,33 @@ void FragmentLengthDist::setLogProbBuffer(const uint32_t size) {
 
         log_prob_buffer.at(i) = Utils::log_normal_pdf<double>(i, mean_, sd_);
     }
+
+    setQuantizedLengthBuffer();
+}
+
+void FragmentLengthDist::setQuantizedLengthBuffer() {
+
+    quantized_length_buffer = vector<uint32_t>(log_prob_buffer.size());
+
+    const double max_log_prob = Utils::log_normal_pdf<double>(mean_, mean_, sd_);
+    const uint32_t mean_length = min(static_cast<uint32_t>(ceil(mean_)), static_cast<uint32_t>(log_prob_buffer.size()));
+
+    auto logProbBin = [&](const uint32_t value) { return static_cast<uint32_t>((max_log_prob - log_prob_buffer.at(value)) / frag_length_log_prob_precision); };
+
+    // The first length above the mean in each bin is used as representative
+    // for the bin, since the log probability decreases monotonically there.
+    unordered_map<uint32_t, uint32_t> bin_lengths;
+
+    for (size_t i = mean_length; i < log_prob_buffer.size(); ++i) {
+
+        quantized_length_buffer.at(i) = bin_lengths.emplace(logProbBin(i), i).first->second;
+    }
+
+    for (size_t i = 0; i < mean_length; ++i) {
+
+        auto bin_lengths_it = bin_lengths.find(logProbBin(i));
+        quantized_length_buffer.at(i) = (bin_lengths_it != bin_lengths.end() ? bin_lengths_it->second : i);
+    }
 }
 
 
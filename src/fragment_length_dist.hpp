@@ -4,9 +4,13 @@
 
 #include <iostream>
 #include <fstream>
+#include <vector>
+#include <memory>
 
 #include "vg/io/basic_stream.hpp"
 
+#include "alignment_reader.hpp"
+
 using namespace std;
 
 
@@ -16,7 +20,7 @@ class FragmentLengthDist {
     	
         FragmentLengthDist();
         FragmentLengthDist(const double mean_in, const double sd_in);
-        FragmentLengthDist(istream * alignments_istream, const bool is_multipath);
+        FragmentLengthDist(const vector<unique_ptr<AlignmentReader> > & alignment_readers, const bool is_multipath);
         FragmentLengthDist(const vector<uint32_t> & frag_length_counts);
 
         double mean() const;
@@ -26,6 +30,11 @@ class FragmentLengthDist {
         uint32_t maxLength() const;
         double logProb(const uint32_t value) const;
 
+        // Returns a representative length with approximately the same
+        // log probability as value (within frag_length_log_prob_precision).
+        // Used to reduce the number of distinct lengths in alignment paths.
+        uint32_t quantizedLength(const uint32_t value) const;
+
         bool parseAlignment(const vg::Alignment & alignment);
         bool parseMultipathAlignment(const vg::MultipathAlignment & alignment);
 
@@ -36,9 +45,11 @@ class FragmentLengthDist {
         double max_length_;
 
         vector<double> log_prob_buffer;
+        vector<uint32_t> quantized_length_buffer;
 
         void setMaxLength();
         void setLogProbBuffer(const uint32_t size); 
+        void setQuantizedLengthBuffer();
 };
 
 
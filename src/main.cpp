@@ -8,8 +8,12 @@
 #include <chrono>
 #include <limits>
 #include <algorithm>
+#include <numeric>
+#include <cstdio>
 #include <iomanip>
 #include <thread>
+#include <memory>
+#include <exception>
 #include <sys/stat.h>
 
 #include "cxxopts.hpp"
@@ -29,6 +33,8 @@
 #include "paths_index.hpp"
 #include "alignment_path.hpp"
 #include "alignment_path_finder.hpp"
+#include "alignment_decoder.hpp"
+#include "alignment_reader.hpp"
 #include "producer_consumer_queue.hpp"
 #include "path_clusters.hpp"
 #include "read_path_probabilities.hpp"
@@ -37,9 +43,17 @@
 #include "path_abundance_estimator.hpp"
 #include "path_cluster_estimates.hpp"
 #include "threaded_output_writer.hpp"
+#include "cluster_shards.hpp"
 
 const uint32_t align_paths_buffer_size = 10000;
+const uint32_t alignment_batch_size = 256;
 const uint32_t fragment_length_min_mapq = 40;
+const uint32_t estimates_write_batch_size = 1000;
+
+const uint32_t max_batch_cluster_reads = 256;
+const uint32_t max_batch_cluster_paths = 16;
+const uint32_t cluster_batch_num_reads = 4096;
+const uint32_t cluster_batch_size = 256;
 
 typedef spp::sparse_hash_map<vector<AlignmentPath>, uint32_t> align_paths_index_t;
 typedef spp::sparse_hash_map<uint32_t, spp::sparse_hash_set<uint32_t> > connected_align_paths_t;
@@ -86,8 +100,121 @@ void addAlignmentPathsToBuffer(const vector<AlignmentPath> & align_paths, vector
     }
 }
 
+// Reads serialized alignments in batches and calls batch_func in parallel
+// for batches of alignment_batch_size fragments (num_alignments_per_fragment 
+// consecutive alignments each), such that each thread processes a whole
+// batch at a time. The readers are processed concurrently by taking a batch
+// from each in turn, while the next batches are read ahead. Alignment
+// messages are decoded using AlignmentDecoder and reused within each thread.
+// Errors in the parallel loop are rethrown once the loop has finished.
+template<class AlignmentType> 
+void forEachAlignmentBatchParallel(const vector<unique_ptr<AlignmentReader> > & alignment_readers, const uint32_t num_alignments_per_fragment, const uint32_t num_threads, const function<void(const vector<AlignmentType> &, const vector<uint32_t> &)> & batch_func) {
+
+    const AlignmentDecoder alignment_decoder;
+    const uint32_t num_batch_alignments = alignment_batch_size * num_alignments_per_fragment;
+
+    vector<string> serialized_alignments;
+    vector<string> reader_serialized_alignments;
+
+    auto threaded_alignments = vector<vector<AlignmentType> >(num_threads);
+    auto threaded_sequence_lengths = vector<vector<uint32_t> >(num_threads);
+
+    exception_ptr batch_exception;
+
+    auto active_alignment_readers = vector<AlignmentReader *>();
+
+    for (auto & alignment_reader: alignment_readers) {
+
+        active_alignment_readers.emplace_back(alignment_reader.get());
+    }
+
+    while (!active_alignment_readers.empty()) {
+
+        serialized_alignments.clear();
+
+        auto alignment_readers_it = active_alignment_readers.begin();
+
+        while (alignment_readers_it != active_alignment_readers.end()) {
+
+            if ((*alignment_readers_it)->nextBatch(&reader_serialized_alignments)) {
+
+                if (reader_serialized_alignments.size() % num_alignments_per_fragment != 0) {
+
+                    throw runtime_error("Number of alignments is not a multiple of " + to_string(num_alignments_per_fragment) + " (interleaved paired-end alignments expected)");
+                }
+
+                move(reader_serialized_alignments.begin(), reader_serialized_alignments.end(), back_inserter(serialized_alignments));
+                ++alignment_readers_it;
+
+            } else {
+
+                alignment_readers_it = active_alignment_readers.erase(alignment_readers_it);
+            }
+        }
+
+        const size_t num_batches = (serialized_alignments.size() + num_batch_alignments - 1) / num_batch_alignments;
+
+        #pragma omp parallel for num_threads(num_threads) schedule(dynamic, 1)
+        for (size_t i = 0; i < num_batches; ++i) {
+
+            vector<AlignmentType> & alignments = threaded_alignments.at(omp_get_thread_num());
+            vector<uint32_t> & sequence_lengths = threaded_sequence_lengths.at(omp_get_thread_num());
+
+            const size_t batch_start_idx = i * num_batch_alignments;
+            const size_t batch_size = min(static_cast<size_t>(num_batch_alignments), serialized_alignments.size() - batch_start_idx);
+
+            // Only the last batches of the readers are smaller.
+            alignments.resize(batch_size);
+            sequence_lengths.resize(batch_size);
+
+            // Exceptions can not escape the parallel region.
+            try {
+
+                for (size_t j = 0; j < batch_size; ++j) {
+
+                    alignment_decoder.decode(&(alignments.at(j)), &(sequence_lengths.at(j)), serialized_alignments.at(batch_start_idx + j));
+                }
+
+                batch_func(alignments, sequence_lengths);
+
+            } catch (...) {
+
+                #pragma omp critical(batch_exception)
+                {
+                    if (!batch_exception) {
+
+                        batch_exception = current_exception();
+                    }
+                }
+            }
+        }
+
+        if (batch_exception) {
+
+            rethrow_exception(batch_exception);
+        }
+    }
+}
+
+void addAlignmentPathsBatchToBuffer(const vector<vector<AlignmentPath> > & align_paths_batch, vector<vector<vector<AlignmentPath> > *> * threaded_align_paths_buffer, align_paths_buffer_queue_t * align_paths_buffer_queue) {
+
+    for (auto & align_paths: align_paths_batch) {
+
+        vector<vector<AlignmentPath > > * align_paths_buffer = threaded_align_paths_buffer->at(omp_get_thread_num());
+        addAlignmentPathsToBuffer(align_paths, align_paths_buffer);
+
+        if (align_paths_buffer->size() == align_paths_buffer_size) {
+
+            align_paths_buffer_queue->push(align_paths_buffer);
+
+            threaded_align_paths_buffer->at(omp_get_thread_num()) = new vector<vector<AlignmentPath > >();
+            threaded_align_paths_buffer->at(omp_get_thread_num())->reserve(align_paths_buffer_size);
+        }
+    }
+}
+
 template<class AlignmentType> 
-void findAlignmentPaths(ifstream & alignments_istream, align_paths_buffer_queue_t * align_paths_buffer_queue, const AlignmentPathFinder<AlignmentType> & align_path_finder, const uint32_t num_threads) {
+void findAlignmentPaths(const vector<unique_ptr<AlignmentReader> > & alignment_readers, align_paths_buffer_queue_t * align_paths_buffer_queue, const AlignmentPathFinder<AlignmentType> & align_path_finder, const uint32_t num_threads) {
 
     auto threaded_align_paths_buffer = vector<vector<vector<AlignmentPath > > *>(num_threads);
 
@@ -96,19 +223,15 @@ void findAlignmentPaths(ifstream & alignments_istream, align_paths_buffer_queue_
         align_paths_buffer = new vector<vector<AlignmentPath > >();
         align_paths_buffer->reserve(align_paths_buffer_size);
     }
-  
-    vg::io::for_each_parallel<AlignmentType>(alignments_istream, [&](AlignmentType & alignment) {
 
-        vector<vector<AlignmentPath > > * align_paths_buffer = threaded_align_paths_buffer.at(omp_get_thread_num());
-        addAlignmentPathsToBuffer(align_path_finder.findAlignmentPaths(alignment), align_paths_buffer);
+    auto threaded_align_paths_batch = vector<vector<vector<AlignmentPath> > >(num_threads);
+  
+    forEachAlignmentBatchParallel<AlignmentType>(alignment_readers, 1, num_threads, [&](const vector<AlignmentType> & alignments, const vector<uint32_t> & sequence_lengths) {
 
-        if (align_paths_buffer->size() == align_paths_buffer_size) {
+        vector<vector<AlignmentPath> > & align_paths_batch = threaded_align_paths_batch.at(omp_get_thread_num());
 
-            align_paths_buffer_queue->push(align_paths_buffer);
-            
-            threaded_align_paths_buffer.at(omp_get_thread_num()) = new vector<vector<AlignmentPath > >();
-            threaded_align_paths_buffer.at(omp_get_thread_num())->reserve(align_paths_buffer_size);
-        }
+        align_path_finder.findAlignmentPaths(&align_paths_batch, alignments, sequence_lengths);
+        addAlignmentPathsBatchToBuffer(align_paths_batch, &threaded_align_paths_buffer, align_paths_buffer_queue);
     });
 
     for (auto & align_paths_buffer: threaded_align_paths_buffer) {
@@ -118,7 +241,7 @@ void findAlignmentPaths(ifstream & alignments_istream, align_paths_buffer_queue_
 }
 
 template<class AlignmentType> 
-void findPairedAlignmentPaths(ifstream & alignments_istream, align_paths_buffer_queue_t * align_paths_buffer_queue, const AlignmentPathFinder<AlignmentType> & align_path_finder, const uint32_t num_threads) {
+void findPairedAlignmentPaths(const vector<unique_ptr<AlignmentReader> > & alignment_readers, align_paths_buffer_queue_t * align_paths_buffer_queue, const AlignmentPathFinder<AlignmentType> & align_path_finder, const uint32_t num_threads) {
 
     auto threaded_align_paths_buffer = vector<vector<vector<AlignmentPath > > *>(num_threads);
 
@@ -127,19 +250,15 @@ void findPairedAlignmentPaths(ifstream & alignments_istream, align_paths_buffer_
         align_paths_buffer = new vector<vector<AlignmentPath > >();
         align_paths_buffer->reserve(align_paths_buffer_size);
     }
-  
-    vg::io::for_each_interleaved_pair_parallel<AlignmentType>(alignments_istream, [&](AlignmentType & alignment_1, AlignmentType & alignment_2) {
 
-        vector<vector<AlignmentPath > > * align_paths_buffer = threaded_align_paths_buffer.at(omp_get_thread_num());
-        addAlignmentPathsToBuffer(align_path_finder.findPairedAlignmentPaths(alignment_1, alignment_2), align_paths_buffer);
+    auto threaded_align_paths_batch = vector<vector<vector<AlignmentPath> > >(num_threads);
+  
+    forEachAlignmentBatchParallel<AlignmentType>(alignment_readers, 2, num_threads, [&](const vector<AlignmentType> & alignments, const vector<uint32_t> & sequence_lengths) {
 
-        if (align_paths_buffer->size() == align_paths_buffer_size) {
+        vector<vector<AlignmentPath> > & align_paths_batch = threaded_align_paths_batch.at(omp_get_thread_num());
 
-            align_paths_buffer_queue->push(align_paths_buffer);
-
-            threaded_align_paths_buffer.at(omp_get_thread_num()) = new vector<vector<AlignmentPath > >();
-            threaded_align_paths_buffer.at(omp_get_thread_num())->reserve(align_paths_buffer_size);
-        }
+        align_path_finder.findPairedAlignmentPaths(&align_paths_batch, alignments, sequence_lengths);
+        addAlignmentPathsBatchToBuffer(align_paths_batch, &threaded_align_paths_buffer, align_paths_buffer_queue);
     });
 
     for (auto & align_paths_buffer: threaded_align_paths_buffer) {
@@ -148,129 +267,659 @@ void findPairedAlignmentPaths(ifstream & alignments_istream, align_paths_buffer_
     }
 }
 
-void addAlignmentPathsBufferToIndexes(align_paths_buffer_queue_t * align_paths_buffer_queue, align_paths_index_t * align_paths_index, FragmentLengthDist * fragment_length_dist, const uint32_t mean_pre_fragment_length) {
+uint32_t addFragmentLengthCounts(const vector<vector<AlignmentPath> > & align_paths_buffer, vector<uint32_t> * fragment_length_counts) {
+
+    uint32_t num_counted_fragments = 0;
+
+    for (auto & align_paths: align_paths_buffer) {
+
+        assert(align_paths.size() > 1);
+        assert(align_paths.back().frag_length == 0);
+
+        if (align_paths.front().min_mapq >= fragment_length_min_mapq && !align_paths.front().is_multimap) {
+
+            uint32_t cur_fragment_length = align_paths.front().frag_length;
+            bool cur_length_is_constant = true;
+
+            for (size_t j = 1; j < align_paths.size() - 1; ++j) {
+
+                assert(align_paths.at(j).min_mapq >= fragment_length_min_mapq);
+                assert(!align_paths.at(j).is_multimap);
+
+                if (align_paths.at(j).frag_length != cur_fragment_length) {
+
+                    cur_length_is_constant = false;
+                    break;
+                }
+            }
+
+            if (cur_length_is_constant) {
+
+                if (fragment_length_counts->size() <= cur_fragment_length) {
+                    
+                    fragment_length_counts->resize(cur_fragment_length + 1, 0);
+                }
+
+                fragment_length_counts->at(cur_fragment_length)++;
+                ++num_counted_fragments;
+            }   
+        }
+    }
+
+    return num_counted_fragments;
+}
+
+// Adds the alignment paths to the index and deletes the buffer. The fragment 
+// lengths are quantized if a quantization distribution is given.
+void addAlignmentPathsBufferToIndex(vector<vector<AlignmentPath> > * align_paths_buffer, align_paths_index_t * align_paths_index, const uint32_t mean_pre_fragment_length, const FragmentLengthDist * quantization_fragment_length_dist) {
+
+    for (auto & align_paths: *align_paths_buffer) {
+
+        if (align_paths.size() == 2) {       
+
+            align_paths.front().frag_length = mean_pre_fragment_length;      
+            align_paths.front().score_sum = 1;       
+        } 
+
+        if (quantization_fragment_length_dist) {
+
+            for (size_t i = 0; i < align_paths.size() - 1; ++i) {
+
+                align_paths.at(i).frag_length = quantization_fragment_length_dist->quantizedLength(align_paths.at(i).frag_length);
+            }
+        }
+
+        auto threaded_align_paths_index_it = align_paths_index->emplace(align_paths, 0);
+        threaded_align_paths_index_it.first->second++;
+    }
+
+    delete align_paths_buffer;
+}
+
+// Estimates the fragment length distribution from all unambiguous read pairs.
+// If num_frag_length_sample_fragments is larger than zero the distribution is
+// instead estimated from the leading read pairs. The alignment paths are
+// buffered until the sample is complete, after which the fragment lengths of
+// all alignment paths are quantized using the estimated distribution.
+void addAlignmentPathsBufferToIndexes(align_paths_buffer_queue_t * align_paths_buffer_queue, align_paths_index_t * align_paths_index, FragmentLengthDist * fragment_length_dist, const uint32_t mean_pre_fragment_length, const uint32_t num_frag_length_sample_fragments) {
+
+    vector<vector<AlignmentPath> > * align_paths_buffer = nullptr;
+    vector<uint32_t> fragment_length_counts(1000, 0);
+
+    uint32_t num_counted_fragments = 0;
+    bool is_sample_complete = false;
+
+    vector<vector<vector<AlignmentPath> > *> sample_align_paths_buffers;
+
+    while (align_paths_buffer_queue->pop(&align_paths_buffer)) {
+
+        if (is_sample_complete) {
+
+            addAlignmentPathsBufferToIndex(align_paths_buffer, align_paths_index, mean_pre_fragment_length, fragment_length_dist);
+            continue;
+        }
+
+        num_counted_fragments += addFragmentLengthCounts(*align_paths_buffer, &fragment_length_counts);
+
+        if (num_frag_length_sample_fragments == 0) {
+
+            addAlignmentPathsBufferToIndex(align_paths_buffer, align_paths_index, mean_pre_fragment_length, nullptr);
+            continue;
+        }
+
+        sample_align_paths_buffers.emplace_back(align_paths_buffer);
+
+        if (num_counted_fragments >= num_frag_length_sample_fragments) {
+
+            *fragment_length_dist = FragmentLengthDist(fragment_length_counts);
+
+            if (fragment_length_dist->isValid()) {
+
+                is_sample_complete = true;
+
+                for (auto & sample_align_paths_buffer: sample_align_paths_buffers) {
+
+                    addAlignmentPathsBufferToIndex(sample_align_paths_buffer, align_paths_index, mean_pre_fragment_length, fragment_length_dist);
+                }
+
+                sample_align_paths_buffers.clear();
+            }
+        }
+    }
+
+    if (!is_sample_complete) {
+
+        for (auto & sample_align_paths_buffer: sample_align_paths_buffers) {
+
+            addAlignmentPathsBufferToIndex(sample_align_paths_buffer, align_paths_index, mean_pre_fragment_length, nullptr);
+        }
+
+        *fragment_length_dist = FragmentLengthDist(fragment_length_counts);
+    }
+}
+
+spp::sparse_hash_map<string, PathInfo> parseHaplotypeTranscriptInfo(const string & filename, const bool parse_haplotype_ids) {
+
+    spp::sparse_hash_map<string, PathInfo> haplotype_transcript_info;
+
+    ifstream info_file(filename);
+    
+    string line;
+    string element;
+
+    spp::sparse_hash_map<string, uint32_t> transcript_id_index;
+    spp::sparse_hash_map<string, uint32_t> haplotype_id_index;
+
+    while (info_file.good()) {
+
+        getline(info_file, line);
+
+        if (line.empty()) {
+
+            continue;
+        }
+
+        auto line_ss = stringstream(line);
+
+        getline(line_ss, element, '\t');
+
+        if (element == "Name") {
+
+            continue;
+        }
+
+        auto haplotype_transcript_info_it = haplotype_transcript_info.emplace(element, PathInfo(element));
+        assert(haplotype_transcript_info_it.second);
+
+        getline(line_ss, element, '\t');        
+        getline(line_ss, element, '\t');
+
+        auto transcript_id_index_it = transcript_id_index.emplace(element, transcript_id_index.size());
+        haplotype_transcript_info_it.first->second.group_id = transcript_id_index_it.first->second;
+
+        getline(line_ss, element, '\t');
+        getline(line_ss, element, '\n');
+
+        if (parse_haplotype_ids) {
+
+            for (auto & haplotype: Utils::splitString(element, ',')) {
+
+                auto haplotype_id_index_it = haplotype_id_index.emplace(haplotype, haplotype_id_index.size());
+                assert(haplotype_transcript_info_it.first->second.source_ids.emplace(haplotype_id_index_it.first->second).second);
+            }
+
+            haplotype_transcript_info_it.first->second.source_count = haplotype_transcript_info_it.first->second.source_ids.size();
+
+        } else {
+
+            haplotype_transcript_info_it.first->second.source_count = count(element.begin(), element.end(), ',') + 1;
+        }
+    }
+
+    info_file.close();
+    return haplotype_transcript_info;
+}
+
+// https://stackoverflow.com/questions/12774207/fastest-way-to-check-if-a-file-exist-using-standard-c-c11-c
+bool doesFileExist(const string name) {
+  
+    struct stat buffer;
+    return (stat(name.c_str(), &buffer) == 0); 
+}
+
+PathEstimator * createPathEstimator(const cxxopts::ParseResult & option_results, const string & inference_model, const double prob_precision) {
+
+    const uint32_t ploidy = option_results["ploidy"].as<uint32_t>();
+
+    const bool ind_hap_inference = option_results.count("ind-hap-inference");
+    const uint32_t num_hap_samples = option_results["num-hap-samples"].as<uint32_t>();
+    const bool use_hap_gibbs = option_results.count("use-hap-gibbs");
+
+    const uint32_t num_gibbs_samples = option_results["num-gibbs-samples"].as<uint32_t>();
+    const uint32_t max_em_its = option_results["max-em-its"].as<uint32_t>();
+    const double max_rel_em_conv = option_results["max-rel-em-conv"].as<double>();
+    const uint32_t gibbs_thin_its = option_results["gibbs-thin-its"].as<uint32_t>();
+    const uint32_t num_gibbs_chains = option_results["num-gibbs-chains"].as<uint32_t>();
+
+    if (inference_model == "haplotypes") {
+
+        return new PathGroupPosteriorEstimator(ploidy, use_hap_gibbs, prob_precision);
+
+    } else if (inference_model == "transcripts") {
+
+        return new PathAbundanceEstimator(max_em_its, max_rel_em_conv, num_gibbs_samples, gibbs_thin_its, num_gibbs_chains, prob_precision);
+
+    } else if (inference_model == "strains") {
+
+        return new MinimumPathAbundanceEstimator(max_em_its, max_rel_em_conv, num_gibbs_samples, gibbs_thin_its, num_gibbs_chains, prob_precision);
+
+    } else if (inference_model == "haplotype-transcripts") {
+
+        return new NestedPathAbundanceEstimator(ploidy, num_hap_samples, !ind_hap_inference, use_hap_gibbs, max_em_its, max_rel_em_conv, num_gibbs_samples, gibbs_thin_its, num_gibbs_chains, prob_precision);
+    }
+
+    assert(false);
+    return nullptr;
+}
+
+// Groups consecutive small clusters (in the order they are inferred) into
+// batches, which are estimated together. Other clusters are estimated alone.
+vector<pair<uint32_t, uint32_t> > createClusterBatches(const vector<pair<uint32_t, uint32_t> > & cluster_sizes) {
+
+    vector<pair<uint32_t, uint32_t> > cluster_batches;
+    uint32_t cur_batch_num_reads = 0;
+
+    for (size_t i = 0; i < cluster_sizes.size(); ++i) {
+
+        const bool is_small_cluster = (cluster_sizes.at(i).first <= max_batch_cluster_reads && cluster_sizes.at(i).second <= max_batch_cluster_paths);
+
+        if (!cluster_batches.empty() && is_small_cluster && cur_batch_num_reads > 0 && cur_batch_num_reads + cluster_sizes.at(i).first <= cluster_batch_num_reads && cluster_batches.back().second - cluster_batches.back().first < cluster_batch_size) {
+
+            cluster_batches.back().second++;
+            cur_batch_num_reads += cluster_sizes.at(i).first;
+
+        } else {
+
+            cluster_batches.emplace_back(i, i + 1);
+            cur_batch_num_reads = (is_small_cluster ? max(cluster_sizes.at(i).first, static_cast<uint32_t>(1)) : 0);
+        }
+    }
+
+    return cluster_batches;
+}
+
+void inferPathClusterEstimates(vector<pair<uint32_t, PathClusterEstimates> > * path_cluster_estimates, const vector<const vector<ReadPathProbabilities> *> & read_path_cluster_probs, const vector<uint32_t> & cluster_seed_ids, const uint64_t rng_seed, PathEstimator * path_estimator, ProbabilityClusterWriter * prob_cluster_writer, ReadCountGibbsSamplesWriter * read_count_samples_writer, ClusterEstimatesWriter * cluster_estimates_writer, double * total_transcript_count) {
+
+    assert(path_cluster_estimates->size() == read_path_cluster_probs.size());
+    assert(path_cluster_estimates->size() == cluster_seed_ids.size());
+
+    vector<mt19937> mt_rngs;
+    mt_rngs.reserve(cluster_seed_ids.size());
+
+    for (auto & cluster_seed_id: cluster_seed_ids) {
+
+        // Seed random number generator using a stable cluster id (smallest path id)
+        // making samples independent of cluster order and number of threads.
+        mt_rngs.emplace_back(Utils::streamMersenneTwister(rng_seed, cluster_seed_id));
+    }
+
+    vector<PathClusterEstimates *> path_cluster_estimates_ptrs;
+    vector<mt19937 *> mt_rngs_ptrs;
+
+    for (size_t i = 0; i < path_cluster_estimates->size(); ++i) {
+
+        path_cluster_estimates_ptrs.emplace_back(&(path_cluster_estimates->at(i).second));
+        mt_rngs_ptrs.emplace_back(&(mt_rngs.at(i)));
+    }
+
+    path_estimator->estimateBatch(path_cluster_estimates_ptrs, read_path_cluster_probs, mt_rngs_ptrs);
+
+    for (size_t i = 0; i < path_cluster_estimates->size(); ++i) {
+
+        auto & cur_path_cluster_estimates = path_cluster_estimates->at(i);
+
+        if (prob_cluster_writer) {
+
+            prob_cluster_writer->addCluster(*(read_path_cluster_probs.at(i)), cur_path_cluster_estimates.second.paths);
+        } 
+
+        if (read_count_samples_writer) {
+
+            read_count_samples_writer->addSamples(cur_path_cluster_estimates);
+            cur_path_cluster_estimates.second.gibbs_read_count_samples.clear();
+        }
+
+        // Abundances are not estimated in haplotype inference.
+        if (cur_path_cluster_estimates.second.abundances.cols() > 0) {
+
+            assert(cur_path_cluster_estimates.second.paths.size() == cur_path_cluster_estimates.second.abundances.cols());
+
+            for (size_t j = 0; j < cur_path_cluster_estimates.second.paths.size(); ++j) {
+
+                if (cur_path_cluster_estimates.second.paths.at(j).effective_length > 0) {
+
+                    *total_transcript_count += (cur_path_cluster_estimates.second.abundances(0, j) / cur_path_cluster_estimates.second.paths.at(j).effective_length);
+                }
+            }
+        }
+
+        // Estimates are written to a temporary file as the TPM
+        // normaliser is only known once all clusters are inferred.
+        cluster_estimates_writer->addEstimates(cur_path_cluster_estimates);
+    }
+}
+
+bool writePathClusterEstimates(const string & cluster_estimates_filename, const bool remove_cluster_estimates_file, const double total_transcript_count, const string & inference_model, const string & output_prefix, const uint32_t num_threads, const uint32_t ploidy, const double prob_precision) {
+
+    HaplotypeEstimatesWriter * haplotype_estimates_writer = nullptr;
+    HaplotypeAbundanceEstimatesWriter * haplotype_abundance_estimates_writer = nullptr;
+    AbundanceEstimatesWriter * abundance_estimates_writer = nullptr;
+
+    if (inference_model == "haplotypes") {
+
+        haplotype_estimates_writer = new HaplotypeEstimatesWriter(output_prefix, num_threads, ploidy, prob_precision);
+
+    } else if (inference_model == "haplotype-transcripts") {
+
+        haplotype_abundance_estimates_writer = new HaplotypeAbundanceEstimatesWriter(output_prefix, num_threads, ploidy, total_transcript_count);
+        haplotype_estimates_writer = new HaplotypeEstimatesWriter(output_prefix + "_haps", num_threads, ploidy, prob_precision);
+
+    } else {
+
+        abundance_estimates_writer = new AbundanceEstimatesWriter(output_prefix, num_threads, total_transcript_count);
+    }
+
+    auto cluster_estimates_reader = new ClusterEstimatesReader(cluster_estimates_filename);
+
+    vector<pair<uint32_t, PathClusterEstimates> > path_cluster_estimates;
+    path_cluster_estimates.reserve(estimates_write_batch_size);
+
+    bool has_estimates = true;
+
+    while (has_estimates) {
+
+        path_cluster_estimates.emplace_back();
+        has_estimates = cluster_estimates_reader->readEstimates(&(path_cluster_estimates.back()));
+
+        if (!has_estimates) {
+
+            path_cluster_estimates.pop_back();
+        }
+
+        if (path_cluster_estimates.size() == estimates_write_batch_size || (!has_estimates && !path_cluster_estimates.empty())) {
+
+            if (haplotype_abundance_estimates_writer) {
+
+                haplotype_abundance_estimates_writer->addEstimates(path_cluster_estimates);
+            }
+
+            if (haplotype_estimates_writer) {
+
+                haplotype_estimates_writer->addEstimates(path_cluster_estimates);
+            }
+
+            if (abundance_estimates_writer) {
+
+                abundance_estimates_writer->addEstimates(path_cluster_estimates);
+            }
+
+            path_cluster_estimates.clear();
+        }
+    }
+
+    const bool is_valid = cluster_estimates_reader->isValid();
+    delete cluster_estimates_reader;
+
+    if (!is_valid) {
+
+        cerr << "ERROR: Could not read cluster estimates file (" << cluster_estimates_filename << "). The file is truncated or corrupt." << endl;
+    }
+
+    if (remove_cluster_estimates_file && remove(cluster_estimates_filename.c_str()) != 0) {
+
+        cerr << "WARNING: Could not remove temporary cluster estimates file (" << cluster_estimates_filename << ")." << endl;
+    }
+
+    if (haplotype_abundance_estimates_writer) {
+
+        haplotype_abundance_estimates_writer->close();
+    }
+
+    if (haplotype_estimates_writer) {
+
+        haplotype_estimates_writer->close();
+    }
+
+    if (abundance_estimates_writer) {
+
+        abundance_estimates_writer->close();
+    }
+
+    delete haplotype_abundance_estimates_writer;
+    delete haplotype_estimates_writer;
+    delete abundance_estimates_writer;
+
+    return is_valid;
+}
+
+string shardFilenamePrefix(const string & output_prefix, const uint32_t shard_idx) {
+
+    return output_prefix + "_shard" + to_string(shard_idx);
+}
+
+int inferShardEstimates(const cxxopts::ParseResult & option_results, const string & inference_model, const uint32_t num_threads, const uint64_t rng_seed) {
+
+    uint32_t shard_idx = 0;
+    uint32_t num_shards = 0;
+
+    if (sscanf(option_results["shard"].as<string>().c_str(), "%u/%u", &shard_idx, &num_shards) != 2 || shard_idx == 0 || shard_idx > num_shards) {
+
+        cerr << "ERROR: Shard (--shard) needs to be given as <i>/<N> with 1 <= i <= N." << endl;
+        return 1;
+    }
+
+    const string shard_prefix = shardFilenamePrefix(option_results["output-prefix"].as<string>(), shard_idx);
+
+    double time_init = gbwt::readTimer();
+
+    ClusterShardReader cluster_shard_reader(shard_prefix + ".bin");
+
+    if (!cluster_shard_reader.isValid()) {
+
+        cerr << "ERROR: Could not read shard file (" << shard_prefix << ".bin). Use --write-shards to create it." << endl;
+        return 1;
+    }
+
+    if (cluster_shard_reader.shardIdx() != shard_idx || cluster_shard_reader.numShards() != num_shards) {
+
+        cerr << "ERROR: Shard file (" << shard_prefix << ".bin) was written as shard " << cluster_shard_reader.shardIdx() << "/" << cluster_shard_reader.numShards() << "." << endl;
+        return 1;
+    }
+
+    if (cluster_shard_reader.inferenceModel() != inference_model) {
+
+        cerr << "ERROR: Shard file (" << shard_prefix << ".bin) was written for the " << cluster_shard_reader.inferenceModel() << " inference model." << endl;
+        return 1;
+    }
+
+    vector<ShardCluster> shard_clusters;
+    ShardCluster shard_cluster;
+
+    while (cluster_shard_reader.readCluster(&shard_cluster)) {
+
+        shard_clusters.emplace_back(move(shard_cluster));
+    }
+
+    if (!cluster_shard_reader.isValid()) {
+
+        cerr << "ERROR: Could not read shard file (" << shard_prefix << ".bin). The file is truncated or corrupt." << endl;
+        return 1;
+    }
+
+    double time_load = gbwt::readTimer();
+    cerr << "Loaded " << shard_clusters.size() << " clusters from shard " << shard_idx << "/" << num_shards << " (" << time_load - time_init << " seconds, " << gbwt::inGigabytes(gbwt::memoryUsage()) << " GB)" << endl;
+
+    const double prob_precision = option_results["prob-precision"].as<double>();
+    assert(prob_precision >= 0 && prob_precision <= 1);
+
+    PathEstimator * path_estimator = createPathEstimator(option_results, inference_model, prob_precision);
+
+    ProbabilityClusterWriter * prob_cluster_writer = nullptr;
+
+    if (option_results.count("write-probs")) {
+
+        prob_cluster_writer = new ProbabilityClusterWriter(shard_prefix + "_probs", num_threads, prob_precision);
+    }
+
+    ReadCountGibbsSamplesWriter * read_count_samples_writer = nullptr;
+
+    if (option_results["num-gibbs-samples"].as<uint32_t>() > 0) {
+
+        read_count_samples_writer = new ReadCountGibbsSamplesWriter(shard_prefix + "_gibbs", num_threads, option_results["num-gibbs-samples"].as<uint32_t>());
+    }
+
+    // Estimates are kept with full precision for merging the shards.
+    auto cluster_estimates_writer = new ClusterEstimatesWriter(shard_prefix + "_estimates.tmp", num_threads);
+    vector<double> threaded_total_transcript_count(num_threads, 0);
+
+    auto shard_clusters_indices = vector<pair<uint32_t, uint32_t> >();
+    shard_clusters_indices.reserve(shard_clusters.size());
+
+    for (size_t i = 0; i < shard_clusters.size(); ++i) {
+
+        shard_clusters_indices.emplace_back(shard_clusters.at(i).read_path_probs.size(), i);
+    }
+
+    sort(shard_clusters_indices.rbegin(), shard_clusters_indices.rend());
+
+    auto shard_clusters_sizes = vector<pair<uint32_t, uint32_t> >();
+    shard_clusters_sizes.reserve(shard_clusters_indices.size());
+
+    for (auto & shard_cluster_idx: shard_clusters_indices) {
+
+        shard_clusters_sizes.emplace_back(shard_cluster_idx.first, shard_clusters.at(shard_cluster_idx.second).paths.size());
+    }
+
+    const vector<pair<uint32_t, uint32_t> > shard_cluster_batches = createClusterBatches(shard_clusters_sizes);
+
+    #pragma omp parallel for schedule(dynamic, 1)
+    for (size_t i = 0; i < shard_cluster_batches.size(); ++i) {
+
+        vector<pair<uint32_t, PathClusterEstimates> > path_cluster_estimates;
+        path_cluster_estimates.reserve(shard_cluster_batches.at(i).second - shard_cluster_batches.at(i).first);
+
+        vector<const vector<ReadPathProbabilities> *> read_path_cluster_probs;
+        vector<uint32_t> cluster_seed_ids;
+
+        for (size_t j = shard_cluster_batches.at(i).first; j < shard_cluster_batches.at(i).second; ++j) {
+
+            auto & cur_shard_cluster = shard_clusters.at(shard_clusters_indices.at(j).second);
+
+            path_cluster_estimates.emplace_back(cur_shard_cluster.cluster_id, PathClusterEstimates());
+            path_cluster_estimates.back().second.paths = move(cur_shard_cluster.paths);
+
+            read_path_cluster_probs.emplace_back(&(cur_shard_cluster.read_path_probs));
+            cluster_seed_ids.emplace_back(cur_shard_cluster.cluster_seed_id);
+        }
+
+        inferPathClusterEstimates(&path_cluster_estimates, read_path_cluster_probs, cluster_seed_ids, rng_seed, path_estimator, prob_cluster_writer, read_count_samples_writer, cluster_estimates_writer, &(threaded_total_transcript_count.at(omp_get_thread_num())));
+
+        for (size_t j = shard_cluster_batches.at(i).first; j < shard_cluster_batches.at(i).second; ++j) {
+
+            auto & cur_shard_cluster = shard_clusters.at(shard_clusters_indices.at(j).second);
+
+            cur_shard_cluster.read_path_probs.clear();
+            cur_shard_cluster.read_path_probs.shrink_to_fit();
+        }
+    }
 
-    vector<vector<AlignmentPath> > * align_paths_buffer = nullptr;
-    vector<uint32_t> fragment_length_counts(1000, 0);
+    delete path_estimator;
 
-    while (align_paths_buffer_queue->pop(&align_paths_buffer)) {
+    if (prob_cluster_writer) {
 
-        for (auto & align_paths: *align_paths_buffer) {
+        prob_cluster_writer->close();
+    } 
 
-            assert(align_paths.size() > 1);
-            assert(align_paths.back().frag_length == 0);
+    if (read_count_samples_writer) {
 
-            if (align_paths.front().min_mapq >= fragment_length_min_mapq && !align_paths.front().is_multimap) {
+        read_count_samples_writer->close();
+    }
 
-                uint32_t cur_fragment_length = align_paths.front().frag_length;
-                bool cur_length_is_constant = true;
+    delete prob_cluster_writer;
+    delete read_count_samples_writer;
 
-                for (size_t j = 1; j < align_paths.size() - 1; ++j) {
+    cluster_estimates_writer->close();
+    delete cluster_estimates_writer;
 
-                    assert(align_paths.at(j).min_mapq >= fragment_length_min_mapq);
-                    assert(!align_paths.at(j).is_multimap);
+    // Shard estimates are sorted by cluster id, such that the shards can be
+    // merged without loading them into memory.
+    const bool is_sorted = sortClusterEstimates(shard_prefix + "_estimates.bin", shard_prefix + "_estimates.tmp", num_threads);
 
-                    if (align_paths.at(j).frag_length != cur_fragment_length) {
+    if (remove((shard_prefix + "_estimates.tmp").c_str()) != 0) {
 
-                        cur_length_is_constant = false;
-                        break;
-                    }
-                }
+        cerr << "WARNING: Could not remove temporary shard estimates file (" << shard_prefix << "_estimates.tmp)." << endl;
+    }
 
-                if (cur_length_is_constant) {
+    if (!is_sorted) {
 
-                    if (fragment_length_counts.size() <= cur_fragment_length) {
-                        
-                        fragment_length_counts.resize(cur_fragment_length + 1, 0);
-                    }
+        cerr << "ERROR: Could not sort shard estimates file (" << shard_prefix << "_estimates.tmp). The file is truncated or corrupt." << endl;
+        return 1;
+    }
 
-                    fragment_length_counts.at(cur_fragment_length)++;
-                }   
-            }
+    const double total_transcript_count = accumulate(threaded_total_transcript_count.begin(), threaded_total_transcript_count.end(), 0.0);
 
-            if (align_paths.size() == 2) {       
+    if (!writeShardTranscriptCount(shard_prefix + "_transcript_count.txt", total_transcript_count)) {
 
-                align_paths.front().frag_length = mean_pre_fragment_length;      
-                align_paths.front().score_sum = 1;       
-            } 
+        cerr << "ERROR: Could not write shard transcript count file (" << shard_prefix << "_transcript_count.txt)." << endl;
+        return 1;
+    }
 
-            auto threaded_align_paths_index_it = align_paths_index->emplace(align_paths, 0);
-            threaded_align_paths_index_it.first->second++;
-        } 
+    if (!writePathClusterEstimates(shard_prefix + "_estimates.bin", false, total_transcript_count, inference_model, shard_prefix, num_threads, option_results["ploidy"].as<uint32_t>(), prob_precision)) {
 
-        delete align_paths_buffer;
+        return 1;
     }
 
-    *fragment_length_dist = FragmentLengthDist(fragment_length_counts);
+    double time_end = gbwt::readTimer();
+    cerr << "Inferred path posterior probabilities" << ((inference_model != "haplotypes") ? " and abundances" : "") << " for shard " << shard_idx << "/" << num_shards << " (" << time_end - time_load << " seconds, " << gbwt::inGigabytes(gbwt::memoryUsage()) << " GB)" << endl;
+
+    return 0;
 }
 
-spp::sparse_hash_map<string, PathInfo> parseHaplotypeTranscriptInfo(const string & filename, const bool parse_haplotype_ids) {
+int mergeShardEstimates(const cxxopts::ParseResult & option_results, const string & inference_model) {
 
-    spp::sparse_hash_map<string, PathInfo> haplotype_transcript_info;
+    const string output_prefix = option_results["output-prefix"].as<string>();
+    const uint32_t num_shards = option_results["merge-shards"].as<uint32_t>();
 
-    ifstream info_file(filename);
-    
-    string line;
-    string element;
+    vector<string> shard_estimates_filenames;
+    shard_estimates_filenames.reserve(num_shards);
 
-    spp::sparse_hash_map<string, uint32_t> transcript_id_index;
-    spp::sparse_hash_map<string, uint32_t> haplotype_id_index;
+    // The TPM normaliser depends on all clusters and is the sum of the
+    // full precision normalisers of the shards.
+    double total_transcript_count = 0;
 
-    while (info_file.good()) {
+    for (uint32_t i = 1; i <= num_shards; ++i) {
 
-        getline(info_file, line);
+        const string shard_prefix = shardFilenamePrefix(output_prefix, i);
 
-        if (line.empty()) {
+        if (!doesFileExist(shard_prefix + "_estimates.bin")) {
 
-            continue;
+            cerr << "ERROR: Shard estimates file (" << shard_prefix << "_estimates.bin) does not exist. Run --shard " << i << "/" << num_shards << " first." << endl;
+            return 1;
         }
 
-        auto line_ss = stringstream(line);
-
-        getline(line_ss, element, '\t');
+        double shard_total_transcript_count = 0;
 
-        if (element == "Name") {
+        if (!readShardTranscriptCount(shard_prefix + "_transcript_count.txt", &shard_total_transcript_count)) {
 
-            continue;
+            cerr << "ERROR: Could not read shard transcript count file (" << shard_prefix << "_transcript_count.txt). Run --shard " << i << "/" << num_shards << " first." << endl;
+            return 1;
         }
 
-        auto haplotype_transcript_info_it = haplotype_transcript_info.emplace(element, PathInfo(element));
-        assert(haplotype_transcript_info_it.second);
-
-        getline(line_ss, element, '\t');        
-        getline(line_ss, element, '\t');
-
-        auto transcript_id_index_it = transcript_id_index.emplace(element, transcript_id_index.size());
-        haplotype_transcript_info_it.first->second.group_id = transcript_id_index_it.first->second;
+        shard_estimates_filenames.emplace_back(shard_prefix + "_estimates.bin");
+        total_transcript_count += shard_total_transcript_count;
+    }
 
-        getline(line_ss, element, '\t');
-        getline(line_ss, element, '\n');
+    const uint32_t num_threads = option_results["threads"].as<uint32_t>();
+    assert(num_threads > 0);
 
-        if (parse_haplotype_ids) {
+    const double prob_precision = option_results["prob-precision"].as<double>();
+    assert(prob_precision >= 0 && prob_precision <= 1);
 
-            for (auto & haplotype: Utils::splitString(element, ',')) {
+    // Clusters are written in cluster id order independent of the shards.
+    if (!mergeClusterEstimates(output_prefix + "_estimates.tmp", shard_estimates_filenames, num_threads)) {
 
-                auto haplotype_id_index_it = haplotype_id_index.emplace(haplotype, haplotype_id_index.size());
-                assert(haplotype_transcript_info_it.first->second.source_ids.emplace(haplotype_id_index_it.first->second).second);
-            }
+        remove((output_prefix + "_estimates.tmp").c_str());
 
-            haplotype_transcript_info_it.first->second.source_count = haplotype_transcript_info_it.first->second.source_ids.size();
+        cerr << "ERROR: Shard estimates files are not sorted by cluster id or could not be read. Rerun --shard for each shard." << endl;
+        return 1;
+    }
 
-        } else {
+    if (!writePathClusterEstimates(output_prefix + "_estimates.tmp", true, total_transcript_count, inference_model, output_prefix, num_threads, option_results["ploidy"].as<uint32_t>(), prob_precision)) {
 
-            haplotype_transcript_info_it.first->second.source_count = count(element.begin(), element.end(), ',') + 1;
-        }
+        return 1;
     }
 
-    info_file.close();
-    return haplotype_transcript_info;
-}
-
-// https://stackoverflow.com/questions/12774207/fastest-way-to-check-if-a-file-exist-using-standard-c-c11-c
-bool doesFileExist(const string name) {
-  
-    struct stat buffer;
-    return (stat(name.c_str(), &buffer) == 0); 
+    return 0;
 }
 
 int main(int argc, char* argv[]) {
@@ -280,13 +929,13 @@ int main(int argc, char* argv[]) {
     options.add_options("Required")
       ("g,graph", "xg graph filename", cxxopts::value<string>())
       ("p,paths", "GBWT index filename", cxxopts::value<string>())
-      ("a,alignments", "gam(p) alignment filename", cxxopts::value<string>())
+      ("a,alignments", "gam(p) alignment filename(s) (use - for stdin)", cxxopts::value<vector<string> >())
       ("o,output-prefix", "prefix used for output filenames (e.g. <prefix>.txt)", cxxopts::value<string>())
       ("i,inference-model", "inference model to use (haplotypes, transcripts, strains or haplotype-transcripts)", cxxopts::value<string>())
       ;
 
     options.add_options("General")
-      ("t,threads", "number of compute threads (+= 1 I/O thread)", cxxopts::value<uint32_t>()->default_value("1"))
+      ("t,threads", "number of compute threads (+= 1 I/O thread and up to the same number of alignment decompression threads)", cxxopts::value<uint32_t>()->default_value("1"))
       ("r,rng-seed", "seed for random number generator (default: unix time)", cxxopts::value<uint64_t>())
       ("h,help", "print help", cxxopts::value<bool>())
       ;
@@ -301,6 +950,7 @@ int main(int argc, char* argv[]) {
     options.add_options("Probability")
       ("m,frag-mean", "mean for fragment length distribution", cxxopts::value<double>())
       ("d,frag-sd", "standard deviation for fragment length distribution", cxxopts::value<double>())
+      ("frag-sample", "estimate fragment length distribution from first <value> unambiguous read pairs and quantize fragment length probabilities (0: use all read pairs)", cxxopts::value<uint32_t>()->default_value("0"))
       ("b,write-probs", "write read path probabilities to file (<prefix>_probs.txt.gz)", cxxopts::value<bool>())
       ("max-par-offset", "maximum start and end offset allowed for partial path alignments", cxxopts::value<uint32_t>()->default_value("4"))
       // ("est-missing-prob", "estimate the probability that the correct alignment path is missing (experimental)", cxxopts::value<bool>())
@@ -324,11 +974,18 @@ int main(int argc, char* argv[]) {
       ("max-em-its", "maximum number of quantification EM iterations", cxxopts::value<uint32_t>()->default_value("10000"))
       ("max-rel-em-conv", "maximum relative abundance difference used for EM convergence", cxxopts::value<double>()->default_value("0.001"))
       ("gibbs-thin-its", "number of Gibbs iterations between samples", cxxopts::value<uint32_t>()->default_value("25"))      
+      ("num-gibbs-chains", "number of independent Gibbs chains per cluster (run in parallel)", cxxopts::value<uint32_t>()->default_value("1"))
+      ;
+
+    options.add_options("Sharding")
+      ("write-shards", "write clusters to <value> shard files (<prefix>_shard<i>.bin) instead of inferring estimates", cxxopts::value<uint32_t>())
+      ("shard", "infer estimates for shard <i>/<N> written using --write-shards (output: <prefix>_shard<i>.txt)", cxxopts::value<string>())
+      ("merge-shards", "merge estimates from <value> inferred shards into <prefix>.txt in cluster order (recomputes TPM)", cxxopts::value<uint32_t>())
       ;
 
     if (argc == 1) {
 
-        cerr << options.help({"Required", "General", "Alignment", "Probability", "Haplotyping", "Quantification"}) << endl;
+        cerr << options.help({"Required", "General", "Alignment", "Probability", "Haplotyping", "Quantification", "Sharding"}) << endl;
         return 1;
     }
 
@@ -336,23 +993,32 @@ int main(int argc, char* argv[]) {
 
     if (option_results.count("help")) {
 
-        cerr << options.help({"Required", "General", "Alignment", "Probability", "Haplotyping", "Quantification"}) << endl;
+        cerr << options.help({"Required", "General", "Alignment", "Probability", "Haplotyping", "Quantification", "Sharding"}) << endl;
+        return 1;
+    }
+
+    if (option_results.count("write-shards") + option_results.count("shard") + option_results.count("merge-shards") > 1) {
+
+        cerr << "ERROR: Only one of --write-shards, --shard and --merge-shards can be given." << endl;
         return 1;
     }
 
-    if (!option_results.count("graph")) {
+    // Inference of sharded clusters only depends on the shard files.
+    const bool require_alignment_input = (!option_results.count("shard") && !option_results.count("merge-shards"));
+
+    if (require_alignment_input && !option_results.count("graph")) {
 
         cerr << "ERROR: Graph (xg format) input required (--graph)." << endl;
         return 1;
     }
 
-    if (!option_results.count("paths")) {
+    if (require_alignment_input && !option_results.count("paths")) {
 
         cerr << "ERROR: Paths (GBWT index) input required (--paths)." << endl;
         return 1;
     }
 
-    if (!option_results.count("alignments")) {
+    if (require_alignment_input && !option_results.count("alignments")) {
 
         cerr << "ERROR: Alignments (gam or gamp format) input required (--alignments)." << endl;
         return 1;
@@ -378,6 +1044,23 @@ int main(int argc, char* argv[]) {
         return 1;
     }
 
+    if (option_results.count("merge-shards")) {
+
+        if (option_results["merge-shards"].as<uint32_t>() == 0) {
+
+            cerr << "ERROR: Number of shards (--merge-shards) can not be 0." << endl;
+            return 1;
+        }
+
+        return mergeShardEstimates(option_results, inference_model);
+    }
+
+    if (option_results.count("write-shards") && option_results["write-shards"].as<uint32_t>() == 0) {
+
+        cerr << "ERROR: Number of shards (--write-shards) can not be 0." << endl;
+        return 1;
+    }
+
     const uint32_t num_threads = option_results["threads"].as<uint32_t>();
     assert(num_threads > 0);
 
@@ -398,6 +1081,25 @@ int main(int argc, char* argv[]) {
     cerr << "Running rpvg (commit: " << GIT_COMMIT << ")" << endl;
     cerr << "Random number generator seed: " << rng_seed << endl;
 
+    const uint32_t ploidy = option_results["ploidy"].as<uint32_t>();
+
+    if (ploidy == 0) {
+
+        cerr << "ERROR: Ploidy (--ploidy) can not be 0." << endl;
+        return 1;        
+    }
+
+    if (option_results["num-gibbs-chains"].as<uint32_t>() == 0) {
+
+        cerr << "ERROR: Number of Gibbs chains (--num-gibbs-chains) can not be 0." << endl;
+        return 1;        
+    }
+
+    if (option_results.count("shard")) {
+
+        return inferShardEstimates(option_results, inference_model, num_threads, rng_seed);
+    }
+
     const string library_type = option_results["strand-specific"].as<string>();
 
     if (library_type != "unstranded" && library_type != "fr" && library_type != "rf") {
@@ -416,6 +1118,48 @@ int main(int argc, char* argv[]) {
         return 1;
     }
 
+    if (!is_long_reads && is_single_end && !option_results.count("frag-mean")) {
+
+        cerr << "ERROR: Both --frag-mean and --frag-sd needs to be given as input when using single-end, short read alignments." << endl;
+        return 1;
+    }
+
+    if (inference_model == "haplotype-transcripts" && !option_results.count("path-info")) {
+
+        cerr << "ERROR: Path haplotype/transcript information file (--path-info) needed when running in haplotype-transcripts inference mode (--write-info output from vg rna)." << endl;
+        return 1;
+    }
+
+    const vector<string> alignments_filenames = option_results["alignments"].as<vector<string> >();
+
+    if (count(alignments_filenames.begin(), alignments_filenames.end(), "-") > 1) {
+
+        cerr << "ERROR: Alignments (--alignments) can only be read from stdin once." << endl;
+        return 1;
+    }
+
+    for (auto & alignments_filename: alignments_filenames) {
+
+        if (alignments_filename != "-" && !doesFileExist(alignments_filename)) {
+
+            cerr << "ERROR: Alignment file (--alignments) " << alignments_filename << " does not exist." << endl;
+            return 1;
+        }
+    }
+
+    // Alignments are read ahead by each reader, while the graph and GBWT are
+    // loaded. The readers are owned here, such that their reading threads
+    // are cancelled and joined on any early return below.
+    auto alignment_readers = vector<unique_ptr<AlignmentReader> >();
+
+    const uint32_t num_alignments_per_fragment = (is_single_end ? 1 : 2);
+    const uint32_t num_reader_threads = max(static_cast<uint32_t>(1), num_threads / static_cast<uint32_t>(alignments_filenames.size()));
+
+    for (auto & alignments_filename: alignments_filenames) {
+
+        alignment_readers.emplace_back(std::make_unique<AlignmentReader>(alignments_filename, alignment_batch_size * num_alignments_per_fragment * num_threads, num_reader_threads));
+    }
+
     FragmentLengthDist pre_fragment_length_dist; 
 
     if (is_long_reads) {
@@ -425,18 +1169,9 @@ int main(int argc, char* argv[]) {
 
     } else if (!option_results.count("frag-mean") && !option_results.count("frag-sd")) {
 
-        if (is_single_end) {
-
-            cerr << "ERROR: Both --frag-mean and --frag-sd needs to be given as input when using single-end, short read alignments." << endl;
-            return 1;            
-        }
-
-        ifstream frag_alignments_istream(option_results["alignments"].as<string>());
-        assert(frag_alignments_istream.is_open());
+        assert(!is_single_end);
 
-        pre_fragment_length_dist = FragmentLengthDist(&frag_alignments_istream, !is_single_path);
-
-        frag_alignments_istream.close();
+        pre_fragment_length_dist = FragmentLengthDist(alignment_readers, !is_single_path);
 
         if (!pre_fragment_length_dist.isValid()) {
 
@@ -474,30 +1209,12 @@ int main(int argc, char* argv[]) {
     const double prob_precision = option_results["prob-precision"].as<double>();
     assert(prob_precision >= 0 && prob_precision <= 1);
 
-    const uint32_t ploidy = option_results["ploidy"].as<uint32_t>();
-
-    if (ploidy == 0) {
-
-        cerr << "ERROR: Ploidy (--ploidy) can not be 0." << endl;
-        return 1;        
-    }
-
-    if (inference_model == "haplotype-transcripts" && !option_results.count("path-info")) {
-
-        cerr << "ERROR: Path haplotype/transcript information file (--path-info) needed when running in haplotype-transcripts inference mode (--write-info output from vg rna)." << endl;
-        return 1;
-    }
-
     assert(pre_fragment_length_dist.isValid());
 
     const bool ind_hap_inference = option_results.count("ind-hap-inference");
-    const uint32_t num_hap_samples = option_results["num-hap-samples"].as<uint32_t>();
-    const bool use_hap_gibbs = option_results.count("use-hap-gibbs");
-
     const uint32_t num_gibbs_samples = option_results["num-gibbs-samples"].as<uint32_t>();
-    const uint32_t max_em_its = option_results["max-em-its"].as<uint32_t>();
-    const double max_rel_em_conv = option_results["max-rel-em-conv"].as<double>();
-    const uint32_t gibbs_thin_its = option_results["gibbs-thin-its"].as<uint32_t>();
+
+    const uint32_t num_shards = option_results.count("write-shards") ? option_results["write-shards"].as<uint32_t>() : 0;
 
     double time_init = gbwt::readTimer();
 
@@ -538,15 +1255,15 @@ int main(int argc, char* argv[]) {
         cerr << "Loaded graph, GBWT and r-index (" << time_load - time_init << " seconds, " << gbwt::inGigabytes(gbwt::memoryUsage()) << " GB)" << endl;        
     }
 
-    ifstream alignments_istream(option_results["alignments"].as<string>());
-    assert(alignments_istream.is_open());
-
     align_paths_index_t align_paths_index;
     auto align_paths_buffer_queue = new align_paths_buffer_queue_t(num_threads * 3);
 
     FragmentLengthDist fragment_length_dist;
 
-    thread indexing_thread(addAlignmentPathsBufferToIndexes, align_paths_buffer_queue, &align_paths_index, &fragment_length_dist, pre_fragment_length_dist.mean());
+    // Fragment length distribution is not re-estimated for single-end reads.
+    const uint32_t num_frag_length_sample_fragments = (is_single_end ? 0 : option_results["frag-sample"].as<uint32_t>());
+
+    thread indexing_thread(addAlignmentPathsBufferToIndexes, align_paths_buffer_queue, &align_paths_index, &fragment_length_dist, pre_fragment_length_dist.mean(), num_frag_length_sample_fragments);
 
     if (is_single_path) {
         
@@ -554,11 +1271,11 @@ int main(int argc, char* argv[]) {
 
         if (is_single_end) {
 
-            findAlignmentPaths<vg::Alignment>(alignments_istream, align_paths_buffer_queue, align_path_finder, num_threads);
+            findAlignmentPaths<vg::Alignment>(alignment_readers, align_paths_buffer_queue, align_path_finder, num_threads);
 
         } else {
 
-            findPairedAlignmentPaths<vg::Alignment>(alignments_istream, align_paths_buffer_queue, align_path_finder, num_threads);
+            findPairedAlignmentPaths<vg::Alignment>(alignment_readers, align_paths_buffer_queue, align_path_finder, num_threads);
         }
 
     } else {
@@ -567,17 +1284,18 @@ int main(int argc, char* argv[]) {
 
         if (is_single_end) {
 
-            findAlignmentPaths<vg::MultipathAlignment>(alignments_istream, align_paths_buffer_queue, align_path_finder, num_threads);
+            findAlignmentPaths<vg::MultipathAlignment>(alignment_readers, align_paths_buffer_queue, align_path_finder, num_threads);
 
         } else {
 
-            findPairedAlignmentPaths<vg::MultipathAlignment>(alignments_istream, align_paths_buffer_queue, align_path_finder, num_threads);
+            findPairedAlignmentPaths<vg::MultipathAlignment>(alignment_readers, align_paths_buffer_queue, align_path_finder, num_threads);
         }        
     }
 
-    alignments_istream.close();
     align_paths_buffer_queue->pushedLast();
 
+    alignment_readers.clear();
+
     indexing_thread.join();
     delete align_paths_buffer_queue;
 
@@ -606,6 +1324,11 @@ int main(int argc, char* argv[]) {
         } else {
 
             cerr << "Fragment length distribution parameters re-estimated from alignment paths (mean: " << fragment_length_dist.mean() << ", standard deviation: " << fragment_length_dist.sd() << ")" << endl;
+
+            if (num_frag_length_sample_fragments > 0) {
+
+                cerr << "Fragment length distribution parameters estimated from first " << num_frag_length_sample_fragments << " unambiguous read pairs (if available)" << endl;
+            }
         }
     }
 
@@ -651,51 +1374,52 @@ int main(int argc, char* argv[]) {
 
     spp::sparse_hash_map<string, PathInfo> haplotype_transcript_info;
 
-    PathEstimator * path_estimator;
+    PathEstimator * path_estimator = nullptr;
 
-    if (inference_model == "haplotypes") {
-
-        path_estimator = new PathGroupPosteriorEstimator(ploidy, use_hap_gibbs, prob_precision);
+    if (inference_model == "haplotype-transcripts") {
 
-    } else if (inference_model == "transcripts") {
+        haplotype_transcript_info = parseHaplotypeTranscriptInfo(option_results["path-info"].as<string>(), !ind_hap_inference);
+    }
 
-        path_estimator = new PathAbundanceEstimator(max_em_its, max_rel_em_conv, num_gibbs_samples, gibbs_thin_its, prob_precision);
+    vector<ClusterShardWriter *> cluster_shard_writers;
 
-    } else if (inference_model == "strains") {
+    if (num_shards > 0) {
 
-        path_estimator = new MinimumPathAbundanceEstimator(max_em_its, max_rel_em_conv, num_gibbs_samples, gibbs_thin_its, prob_precision);
+        cluster_shard_writers.reserve(num_shards);
 
-    } else if (inference_model == "haplotype-transcripts") {
+        for (uint32_t i = 0; i < num_shards; ++i) {
 
-        path_estimator = new NestedPathAbundanceEstimator(ploidy, num_hap_samples, !ind_hap_inference, use_hap_gibbs, max_em_its, max_rel_em_conv, num_gibbs_samples, gibbs_thin_its, prob_precision);
-        haplotype_transcript_info = parseHaplotypeTranscriptInfo(option_results["path-info"].as<string>(), !ind_hap_inference);
+            cluster_shard_writers.emplace_back(new ClusterShardWriter(shardFilenamePrefix(option_results["output-prefix"].as<string>(), i + 1) + ".bin", num_threads, i + 1, num_shards, inference_model));
+        }
 
     } else {
 
-        assert(false);
+        path_estimator = createPathEstimator(option_results, inference_model, prob_precision);
     }
 
     ProbabilityClusterWriter * prob_cluster_writer = nullptr;
 
-    if (option_results.count("write-probs")) {
+    if (option_results.count("write-probs") && num_shards == 0) {
 
         prob_cluster_writer = new ProbabilityClusterWriter(option_results["output-prefix"].as<string>() + "_probs", num_threads, prob_precision);
     }
 
     ReadCountGibbsSamplesWriter * read_count_samples_writer = nullptr;
 
-    if (num_gibbs_samples > 0) {
+    if (num_gibbs_samples > 0 && num_shards == 0) {
 
         read_count_samples_writer = new ReadCountGibbsSamplesWriter(option_results["output-prefix"].as<string>() + "_gibbs", num_threads, num_gibbs_samples);
     }
 
-    vector<vector<pair<uint32_t, PathClusterEstimates> > > threaded_path_cluster_estimates(num_threads);
+    ClusterEstimatesWriter * cluster_estimates_writer = nullptr;
 
-    for (size_t i = 0; i < num_threads; ++i) {
+    if (num_shards == 0) {
 
-        threaded_path_cluster_estimates.at(i).reserve(ceil(align_paths_clusters.size()) / static_cast<float>(num_threads));
+        cluster_estimates_writer = new ClusterEstimatesWriter(option_results["output-prefix"].as<string>() + "_estimates.tmp", num_threads);
     }
 
+    vector<double> threaded_total_transcript_count(num_threads, 0);
+
     auto align_paths_clusters_indices = vector<pair<uint32_t, uint32_t> >();
     align_paths_clusters_indices.reserve(align_paths_clusters.size());
 
@@ -714,197 +1438,196 @@ int main(int argc, char* argv[]) {
 
     sort(align_paths_clusters_indices.rbegin(), align_paths_clusters_indices.rend());
 
-    #pragma omp parallel for schedule(dynamic, 1)
-    for (size_t i = 0; i < align_paths_clusters_indices.size(); ++i) {
+    auto align_paths_clusters_sizes = vector<pair<uint32_t, uint32_t> >();
+    align_paths_clusters_sizes.reserve(align_paths_clusters_indices.size());
 
-        auto align_paths_cluster_idx = align_paths_clusters_indices.at(i).second;
-        auto thread_id = omp_get_thread_num();
+    for (auto & align_paths_cluster_idx: align_paths_clusters_indices) {
 
-        // double debug_time = gbwt::readTimer();
+        align_paths_clusters_sizes.emplace_back(align_paths_cluster_idx.first, path_clusters.cluster_to_paths_index.at(align_paths_cluster_idx.second).size());
+    }
 
-        // if (path_clusters.cluster_to_paths_index.at(align_paths_cluster_idx).size() > 1000 || align_paths_clusters.at(align_paths_cluster_idx).size() > 1000) {
+    const vector<pair<uint32_t, uint32_t> > align_paths_cluster_batches = createClusterBatches(align_paths_clusters_sizes);
 
-        //     #pragma omp critical
-        //     {
-                
-        //         cerr << "DEBUG: Start " << omp_get_thread_num() << ": " << i << " " << path_clusters.cluster_to_paths_index.at(align_paths_cluster_idx).size() << " " << align_paths_clusters.at(align_paths_cluster_idx).size() << " " << gbwt::inGigabytes(gbwt::memoryUsage()) << endl;
-        //     }
-        // }
+    #pragma omp parallel for schedule(dynamic, 1)
+    for (size_t b = 0; b < align_paths_cluster_batches.size(); ++b) {
 
-        spp::sparse_hash_map<uint32_t, uint32_t> clustered_path_index;
+        const uint32_t batch_size = align_paths_cluster_batches.at(b).second - align_paths_cluster_batches.at(b).first;
 
-        auto * path_cluster_estimates = &(threaded_path_cluster_estimates.at(omp_get_thread_num()));
-        path_cluster_estimates->emplace_back(i + 1, PathClusterEstimates());
+        // Reserved to keep references to the last cluster valid.
+        vector<pair<uint32_t, PathClusterEstimates> > batch_path_cluster_estimates;
+        batch_path_cluster_estimates.reserve(batch_size);
 
-        path_cluster_estimates->back().second.paths.reserve(path_clusters.cluster_to_paths_index.at(align_paths_cluster_idx).size());
-        
-        for (auto & path_id: path_clusters.cluster_to_paths_index.at(align_paths_cluster_idx)) {
+        vector<vector<ReadPathProbabilities> > batch_read_path_cluster_probs;
+        batch_read_path_cluster_probs.reserve(batch_size);
 
-            assert(clustered_path_index.emplace(path_id, clustered_path_index.size()).second);
+        vector<uint32_t> batch_cluster_seed_ids;
+        batch_cluster_seed_ids.reserve(batch_size);
 
-            if (inference_model == "haplotype-transcripts") {
+        for (size_t i = align_paths_cluster_batches.at(b).first; i < align_paths_cluster_batches.at(b).second; ++i) {
 
-                auto haplotype_transcript_info_it = haplotype_transcript_info.find(paths_index.pathName(path_id));
-                assert(haplotype_transcript_info_it != haplotype_transcript_info.end());
+            auto align_paths_cluster_idx = align_paths_clusters_indices.at(i).second;
+            auto thread_id = omp_get_thread_num();
 
-                path_cluster_estimates->back().second.paths.emplace_back(move(haplotype_transcript_info_it->second));
-            
-            } else {
+            // double debug_time = gbwt::readTimer();
 
-                path_cluster_estimates->back().second.paths.emplace_back(PathInfo(paths_index.pathName(path_id)));
-            }
+            // if (path_clusters.cluster_to_paths_index.at(align_paths_cluster_idx).size() > 1000 || align_paths_clusters.at(align_paths_cluster_idx).size() > 1000) {
+
+            //     #pragma omp critical
+            //     {
+                
+            //         cerr << "DEBUG: Start " << omp_get_thread_num() << ": " << i << " " << path_clusters.cluster_to_paths_index.at(align_paths_cluster_idx).size() << " " << align_paths_clusters.at(align_paths_cluster_idx).size() << " " << gbwt::inGigabytes(gbwt::memoryUsage()) << endl;
+            //     }
+            // }
 
-            path_cluster_estimates->back().second.paths.back().length = paths_index.pathLength(path_id); 
+            spp::sparse_hash_map<uint32_t, uint32_t> clustered_path_index;
 
-            if (is_long_reads) {
+            batch_path_cluster_estimates.emplace_back(i + 1, PathClusterEstimates());
+            auto & path_cluster_estimates = batch_path_cluster_estimates.back();
 
-                path_cluster_estimates->back().second.paths.back().effective_length = paths_index.pathLength(path_id); 
+            path_cluster_estimates.second.paths.reserve(path_clusters.cluster_to_paths_index.at(align_paths_cluster_idx).size());
+        
+            for (auto & path_id: path_clusters.cluster_to_paths_index.at(align_paths_cluster_idx)) {
 
-            } else {
+                assert(clustered_path_index.emplace(path_id, clustered_path_index.size()).second);
 
-                path_cluster_estimates->back().second.paths.back().effective_length = paths_index.effectivePathLength(path_id, fragment_length_dist); 
-            }
-        }
+                if (inference_model == "haplotype-transcripts") {
+
+                    auto haplotype_transcript_info_it = haplotype_transcript_info.find(paths_index.pathName(path_id));
+                    assert(haplotype_transcript_info_it != haplotype_transcript_info.end());
+
+                    path_cluster_estimates.second.paths.emplace_back(move(haplotype_transcript_info_it->second));
+            
+                } else {
 
-        vector<ReadPathProbabilities> read_path_cluster_probs;
-        read_path_cluster_probs.reserve(align_paths_clusters_indices.at(i).first);
+                    path_cluster_estimates.second.paths.emplace_back(PathInfo(paths_index.pathName(path_id)));
+                }
 
-        for (auto & threaded_align_paths: align_paths_clusters.at(align_paths_cluster_idx)) {
+                path_cluster_estimates.second.paths.back().length = paths_index.pathLength(path_id); 
 
-            for (auto & align_paths: threaded_align_paths) {
+                if (is_long_reads) {
 
-                vector<vector<gbwt::size_type> > align_paths_ids;
-                align_paths_ids.reserve(align_paths->first.size());
+                    path_cluster_estimates.second.paths.back().effective_length = paths_index.pathLength(path_id); 
 
-                for (auto & align_path: align_paths->first) {
+                } else {
 
-                    align_paths_ids.emplace_back(paths_index.locatePathIds(align_path.gbwt_search));
+                    path_cluster_estimates.second.paths.back().effective_length = paths_index.effectivePathLength(path_id, fragment_length_dist); 
                 }
-
-                read_path_cluster_probs.emplace_back(ReadPathProbabilities(align_paths->second, prob_precision));
-                read_path_cluster_probs.back().calcAlignPathProbs(align_paths->first, align_paths_ids, clustered_path_index, path_cluster_estimates->back().second.paths, fragment_length_dist, is_single_end, min_noise_prob);
             }
-        }
 
-        sort(read_path_cluster_probs.begin(), read_path_cluster_probs.end());
+            batch_read_path_cluster_probs.emplace_back();
+            auto & read_path_cluster_probs = batch_read_path_cluster_probs.back();
 
-        if (!read_path_cluster_probs.empty()) {        
+            read_path_cluster_probs.reserve(align_paths_clusters_indices.at(i).first);
 
-            uint32_t prev_unique_probs_idx = 0;
+            for (auto & threaded_align_paths: align_paths_clusters.at(align_paths_cluster_idx)) {
 
-            for (size_t i = 1; i < read_path_cluster_probs.size(); ++i) {
+                for (auto & align_paths: threaded_align_paths) {
 
-                if (!read_path_cluster_probs.at(prev_unique_probs_idx).quickMergeIdentical(read_path_cluster_probs.at(i))) {
+                    vector<vector<gbwt::size_type> > align_paths_ids;
+                    align_paths_ids.reserve(align_paths->first.size());
 
-                    if (prev_unique_probs_idx + 1 < i) {
+                    for (auto & align_path: align_paths->first) {
 
-                        read_path_cluster_probs.at(prev_unique_probs_idx + 1) = read_path_cluster_probs.at(i);
+                        align_paths_ids.emplace_back(paths_index.locatePathIds(align_path.gbwt_search));
                     }
 
-                    prev_unique_probs_idx++;
+                    read_path_cluster_probs.emplace_back(ReadPathProbabilities(align_paths->second, prob_precision));
+                    read_path_cluster_probs.back().calcAlignPathProbs(align_paths->first, align_paths_ids, clustered_path_index, path_cluster_estimates.second.paths, fragment_length_dist, is_single_end, min_noise_prob);
                 }
             }
 
-            read_path_cluster_probs.resize(prev_unique_probs_idx + 1);
-        }
-
-        // Need better solution for this
-        mt19937 mt_rng = mt19937(rng_seed + i);
-        path_estimator->estimate(&(path_cluster_estimates->back().second), read_path_cluster_probs, &mt_rng);
-
-        if (prob_cluster_writer) {
+            sort(read_path_cluster_probs.begin(), read_path_cluster_probs.end());
 
-            prob_cluster_writer->addCluster(read_path_cluster_probs, path_cluster_estimates->back().second.paths);
-        } 
+            if (!read_path_cluster_probs.empty()) {        
 
-        if (read_count_samples_writer) {
+                uint32_t prev_unique_probs_idx = 0;
 
-            read_count_samples_writer->addSamples(path_cluster_estimates->back());
-            path_cluster_estimates->back().second.gibbs_read_count_samples.clear();
-        }
+                for (size_t i = 1; i < read_path_cluster_probs.size(); ++i) {
 
-        // if (path_clusters.cluster_to_paths_index.at(align_paths_cluster_idx).size() > 1000 || align_paths_clusters.at(align_paths_cluster_idx).size() > 1000) {
+                    if (!read_path_cluster_probs.at(prev_unique_probs_idx).quickMergeIdentical(read_path_cluster_probs.at(i))) {
 
-        //     #pragma omp critical
-        //     {
-                
-        //         cerr << "DEBUG: End " << omp_get_thread_num() << ": " << i << " " << path_clusters.cluster_to_paths_index.at(align_paths_cluster_idx).size() << " " << align_paths_clusters.at(align_paths_cluster_idx).size() << " " << gbwt::inGigabytes(gbwt::memoryUsage()) << " " << gbwt::readTimer() - debug_time << endl;
-        //     }
-        // }
-    }
+                        if (prev_unique_probs_idx + 1 < i) {
 
-    delete path_estimator;
+                            read_path_cluster_probs.at(prev_unique_probs_idx + 1) = read_path_cluster_probs.at(i);
+                        }
 
-    if (prob_cluster_writer) {
+                        prev_unique_probs_idx++;
+                    }
+                }
 
-        prob_cluster_writer->close();
-    } 
+                read_path_cluster_probs.resize(prev_unique_probs_idx + 1);
+            }
 
-    if (read_count_samples_writer) {
+            if (num_shards > 0) {
 
-        read_count_samples_writer->close();
-    }
+                cluster_shard_writers.at(i % num_shards)->addCluster(i + 1, path_clusters.cluster_to_paths_index.at(align_paths_cluster_idx).front(), path_cluster_estimates.second.paths, read_path_cluster_probs);
+                continue;
+            }
 
-    delete prob_cluster_writer;
-    delete read_count_samples_writer;
+            batch_cluster_seed_ids.emplace_back(path_clusters.cluster_to_paths_index.at(align_paths_cluster_idx).front());
 
-    if (inference_model == "haplotypes") {
+            // if (path_clusters.cluster_to_paths_index.at(align_paths_cluster_idx).size() > 1000 || align_paths_clusters.at(align_paths_cluster_idx).size() > 1000) {
 
-        HaplotypeEstimatesWriter haplotype_estimates_writer(option_results["output-prefix"].as<string>(), num_threads, ploidy, prob_precision);
+            //     #pragma omp critical
+            //     {
+                
+            //         cerr << "DEBUG: End " << omp_get_thread_num() << ": " << i << " " << path_clusters.cluster_to_paths_index.at(align_paths_cluster_idx).size() << " " << align_paths_clusters.at(align_paths_cluster_idx).size() << " " << gbwt::inGigabytes(gbwt::memoryUsage()) << " " << gbwt::readTimer() - debug_time << endl;
+            //     }
+            // }
+        }
 
-        for (auto & path_cluster_estimates: threaded_path_cluster_estimates) {
+        if (num_shards > 0) {
 
-            haplotype_estimates_writer.addEstimates(path_cluster_estimates);
+            continue;
         }
 
-        haplotype_estimates_writer.close();
+        vector<const vector<ReadPathProbabilities> *> batch_read_path_cluster_probs_ptrs;
+        batch_read_path_cluster_probs_ptrs.reserve(batch_size);
 
-    } else {
+        for (auto & read_path_cluster_probs: batch_read_path_cluster_probs) {
 
-        double total_transcript_count = 0;
+            batch_read_path_cluster_probs_ptrs.emplace_back(&read_path_cluster_probs);
+        }
 
-        for (auto & path_cluster_estimates_thread: threaded_path_cluster_estimates) {
+        inferPathClusterEstimates(&batch_path_cluster_estimates, batch_read_path_cluster_probs_ptrs, batch_cluster_seed_ids, rng_seed, path_estimator, prob_cluster_writer, read_count_samples_writer, cluster_estimates_writer, &(threaded_total_transcript_count.at(omp_get_thread_num())));
+    }
 
-            for (auto & path_cluster_estimates: path_cluster_estimates_thread) {
+    if (num_shards > 0) {
 
-                assert(path_cluster_estimates.second.paths.size() == path_cluster_estimates.second.abundances.cols());
+        for (auto & cluster_shard_writer: cluster_shard_writers) {
 
-                for (size_t i = 0; i < path_cluster_estimates.second.paths.size(); ++i) {
+            cluster_shard_writer->close();
+            delete cluster_shard_writer;
+        }
 
-                    if (path_cluster_estimates.second.paths.at(i).effective_length > 0) {
+        double time_end = gbwt::readTimer();
+        cerr << "Wrote " << align_paths_clusters_indices.size() << " clusters to " << num_shards << " shards (" << time_end - time_clust << " seconds, " << gbwt::inGigabytes(gbwt::memoryUsage()) << " GB)" << endl;
 
-                        total_transcript_count += (path_cluster_estimates.second.abundances(0, i) / path_cluster_estimates.second.paths.at(i).effective_length);
-                    }
-                }
-            }
-        }
+        return 0;
+    }
 
-        if (inference_model == "haplotype-transcripts") {
+    delete path_estimator;
 
-            HaplotypeAbundanceEstimatesWriter haplotype_abundance_estimates_writer(option_results["output-prefix"].as<string>(), num_threads, ploidy, total_transcript_count);
-            HaplotypeEstimatesWriter haplotype_estimates_writer(option_results["output-prefix"].as<string>() + "_haps", num_threads, ploidy, prob_precision);
+    if (prob_cluster_writer) {
 
-            for (auto & path_cluster_estimates: threaded_path_cluster_estimates) {
+        prob_cluster_writer->close();
+    } 
 
-                haplotype_abundance_estimates_writer.addEstimates(path_cluster_estimates);
-                haplotype_estimates_writer.addEstimates(path_cluster_estimates);
-            }
+    if (read_count_samples_writer) {
 
-            haplotype_abundance_estimates_writer.close();
-            haplotype_estimates_writer.close();
-        
-        } else {
+        read_count_samples_writer->close();
+    }
 
-            AbundanceEstimatesWriter abundance_estimates_writer(option_results["output-prefix"].as<string>(), num_threads, total_transcript_count);
+    delete prob_cluster_writer;
+    delete read_count_samples_writer;
 
-            for (auto & path_cluster_estimates: threaded_path_cluster_estimates) {
+    cluster_estimates_writer->close();
+    delete cluster_estimates_writer;
 
-                abundance_estimates_writer.addEstimates(path_cluster_estimates);
-            }
+    if (!writePathClusterEstimates(option_results["output-prefix"].as<string>() + "_estimates.tmp", true, accumulate(threaded_total_transcript_count.begin(), threaded_total_transcript_count.end(), 0.0), inference_model, option_results["output-prefix"].as<string>(), num_threads, ploidy, prob_precision)) {
 
-            abundance_estimates_writer.close();
-        }
-    }    
+        return 1;
+    }
 
     double time_end = gbwt::readTimer();
     cerr << "Inferred path posterior probabilities" << ((inference_model != "haplotypes") ? " and abundances" : "") << " (" << time_end - time_clust << " seconds, " << gbwt::inGigabytes(gbwt::memoryUsage()) << " GB)" << endl;
@@ -0,0 +1,266 @@
+
+#include "multinomial_sampler.hpp"
+
+
+// Binomial samples with a mean below this value are drawn using inversion,
+// otherwise the BTRD algorithm is used.
+static const double binomial_inversion_max_mean = 10;
+
+// Tail of the Stirling approximation of log(k!) for k < 10.
+static const double stirling_approx_tail_values[] = {0.08106146679532726, 0.04134069595540929, 0.02767792568499834, 0.02079067210376509, 0.01664469118982119, 0.01387612882307075, 0.01189670994589177, 0.01041126526197209, 0.009255462182712733, 0.008330563433362871};
+
+Xoshiro256StarStar::Xoshiro256StarStar(uint64_t seed) {
+
+    for (auto & value: state) {
+
+        value = Utils::splitMix64(&seed);
+    }
+}
+
+void MultinomialSampler::sample(uint32_t * counts, const double * probs, const uint32_t num_probs, const uint32_t num_trials, Xoshiro256StarStar * rng) const {
+
+    if (num_trials == 0) {
+
+        return;
+    }
+
+    int32_t last_prob_idx = -1;
+
+    if (num_trials == 1) {
+
+        double rem_uniform_prob = rng->uniform();
+
+        for (uint32_t i = 0; i < num_probs; ++i) {
+
+            if (probs[i] > 0) {
+
+                last_prob_idx = i;
+                rem_uniform_prob -= probs[i];
+
+                if (rem_uniform_prob < 0) {
+
+                    counts[i]++;
+                    return;
+                }
+            }
+        }
+
+        // Probabilities sum to slightly below one due to rounding.
+        assert(last_prob_idx >= 0);
+        counts[last_prob_idx]++;
+
+        return;
+    }
+
+    uint32_t rem_num_trials = num_trials;
+    double rem_sum_probs = 1;
+
+    for (uint32_t i = 0; i < num_probs; ++i) {
+
+        if (probs[i] > 0) {
+
+            assert(rem_sum_probs > 0);
+            last_prob_idx = i;
+
+            auto count = sampleBinomial(rem_num_trials, min(1.0, probs[i] / rem_sum_probs), rng);
+
+            counts[i] += count;
+            rem_num_trials -= count;
+
+            if (rem_num_trials == 0) {
+
+                return;
+            }
+        }
+
+        rem_sum_probs -= probs[i];
+    }
+
+    // Probabilities sum to slightly below one due to rounding.
+    assert(last_prob_idx >= 0);
+    counts[last_prob_idx] += rem_num_trials;
+}
+
+uint32_t MultinomialSampler::sampleBinomial(const uint32_t num_trials, const double prob, Xoshiro256StarStar * rng) const {
+
+    if (num_trials == 0 || prob <= 0) {
+
+        return 0;
+    }
+
+    if (prob >= 1) {
+
+        return num_trials;
+    }
+
+    if (prob > 0.5) {
+
+        return (num_trials - sampleBinomial(num_trials, 1 - prob, rng));
+    }
+
+    if (num_trials * prob < binomial_inversion_max_mean) {
+
+        return sampleBinomialInversion(num_trials, prob, rng);
+    
+    } else {
+
+        return sampleBinomialBTRD(num_trials, prob, rng);
+    }
+}
+
+uint32_t MultinomialSampler::sampleBinomialInversion(const uint32_t num_trials, const double prob, Xoshiro256StarStar * rng) const {
+
+    assert(prob > 0 && prob <= 0.5);
+
+    const double prob_ratio = prob / (1 - prob);
+    const double trials_prob_ratio = (num_trials + 1) * prob_ratio;
+    const double zero_prob = pow(1 - prob, num_trials);
+
+    while (true) {
+
+        double uniform_prob = rng->uniform();
+        double value_prob = zero_prob;
+
+        uint32_t value = 0;
+
+        while (uniform_prob > value_prob) {
+
+            uniform_prob -= value_prob;
+            value++;
+
+            if (value > num_trials) {
+
+                break;
+            }
+
+            value_prob *= (trials_prob_ratio / value - prob_ratio);
+        }
+
+        if (value <= num_trials) {
+
+            return value;
+        }
+    }
+}
+
+// Hormann W. The generation of binomial random variates. Journal of 
+// Statistical Computation and Simulation. 1993.
+uint32_t MultinomialSampler::sampleBinomialBTRD(const uint32_t num_trials, const double prob, Xoshiro256StarStar * rng) const {
+
+    assert(prob > 0 && prob <= 0.5);
+
+    const double n = num_trials;
+    const double m = floor((n + 1) * prob);
+    const double r = prob / (1 - prob);
+    const double nr = (n + 1) * r;
+    const double npq = n * prob * (1 - prob);
+    const double sqrt_npq = sqrt(npq);
+
+    const double b = 1.15 + 2.53 * sqrt_npq;
+    const double a = -0.0873 + 0.0248 * b + 0.01 * prob;
+    const double c = n * prob + 0.5;
+    const double alpha = (2.83 + 5.1 / b) * sqrt_npq;
+    const double v_r = 0.92 - 4.2 / b;
+    const double u_rv_r = 0.86 * v_r;
+
+    while (true) {
+
+        double v = rng->uniform();
+        double u = 0;
+
+        if (v <= u_rv_r) {
+
+            u = v / v_r - 0.43;
+            return static_cast<uint32_t>(floor((2 * a / (0.5 - fabs(u)) + b) * u + c));
+        }
+
+        if (v >= v_r) {
+
+            u = rng->uniform() - 0.5;
+
+        } else {
+
+            u = v / v_r - 0.93;
+            u = ((u < 0) ? -0.5 : 0.5) - u;
+            v = rng->uniform() * v_r;
+        }
+
+        const double us = 0.5 - fabs(u);
+        const double k = floor((2 * a / us + b) * u + c);
+
+        if (k < 0 || k > n) {
+
+            continue;
+        }
+
+        v = v * alpha / (a / (us * us) + b);
+        const double km = fabs(k - m);
+
+        if (km <= 15) {
+
+            // Recursive evaluation of f(k) / f(m).
+            double f = 1;
+
+            if (m < k) {
+
+                for (double i = m + 1; i <= k; ++i) {
+
+                    f *= (nr / i - r);
+                }
+
+            } else if (m > k) {
+
+                for (double i = k + 1; i <= m; ++i) {
+
+                    v *= (nr / i - r);
+                }
+            }
+
+            if (v <= f) {
+
+                return static_cast<uint32_t>(k);
+            }
+
+            continue;
+        }
+
+        // Squeeze acceptance and rejection.
+        v = log(v);
+
+        const double rho = (km / npq) * (((km / 3 + 0.625) * km + 1.0 / 6) / npq + 0.5);
+        const double t = -km * km / (2 * npq);
+
+        if (v < t - rho) {
+
+            return static_cast<uint32_t>(k);
+        }
+
+        if (v > t + rho) {
+
+            continue;
+        }
+
+        const double nm = n - m + 1;
+        const double h = (m + 0.5) * log((m + 1) / (r * nm)) + stirlingApproxTail(m) + stirlingApproxTail(n - m);
+
+        const double nk = n - k + 1;
+
+        if (v <= h + (n + 1) * log(nm / nk) + (k + 0.5) * log(nk * r / (k + 1)) - stirlingApproxTail(k) - stirlingApproxTail(n - k)) {
+
+            return static_cast<uint32_t>(k);
+        }
+    }
+}
+
+double MultinomialSampler::stirlingApproxTail(const uint32_t value) const {
+
+    if (value < 10) {
+
+        return stirling_approx_tail_values[value];
+    }
+
+    const double value_p1 = value + 1;
+    const double value_p1_sq = value_p1 * value_p1;
+
+    return ((1.0 / 12 - (1.0 / 360 - 1.0 / 1260 / value_p1_sq) / value_p1_sq) / value_p1);
+}
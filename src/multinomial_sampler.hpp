@@ -0,0 +1,79 @@
+
+#ifndef RPVG_SRC_MULTINOMIALSAMPLER_HPP
+#define RPVG_SRC_MULTINOMIALSAMPLER_HPP
+
+#include <vector>
+#include <limits>
+
+#include "utils.hpp"
+
+using namespace std;
+
+
+// xoshiro256** pseudo random number generator (https://prng.di.unimi.it).
+// Satisfies UniformRandomBitGenerator and can therefore also be used
+// together with the standard library distributions.
+class Xoshiro256StarStar {
+
+    public:
+
+        typedef uint64_t result_type;
+
+        Xoshiro256StarStar(uint64_t seed);
+
+        static constexpr result_type min() { return 0; }
+        static constexpr result_type max() { return numeric_limits<result_type>::max(); }
+
+        inline result_type operator()() {
+
+            const uint64_t value = rotateLeft(state[1] * 5, 7) * 9;
+            const uint64_t state_1_shift = state[1] << 17;
+
+            state[2] ^= state[0];
+            state[3] ^= state[1];
+            state[1] ^= state[2];
+            state[0] ^= state[3];
+
+            state[2] ^= state_1_shift;
+            state[3] = rotateLeft(state[3], 45);
+
+            return value;
+        }
+
+        // Uniform double in [0,1).
+        inline double uniform() {
+
+            return ((*this)() >> 11) * (1.0 / 9007199254740992.0);
+        }
+
+    private:
+
+        uint64_t state[4];
+
+        static inline uint64_t rotateLeft(const uint64_t value, const int shift) {
+
+            return (value << shift) | (value >> (64 - shift));
+        }
+};
+
+class MultinomialSampler {
+
+    public:
+
+        // Adds a multinomial sample of num_trials trials over the (normalized)
+        // probabilities to counts. Uses a single categorical draw when there is
+        // only one trial and conditional binomial sampling otherwise.
+        void sample(uint32_t * counts, const double * probs, const uint32_t num_probs, const uint32_t num_trials, Xoshiro256StarStar * rng) const;
+
+        uint32_t sampleBinomial(const uint32_t num_trials, const double prob, Xoshiro256StarStar * rng) const;
+
+    private:
+
+        uint32_t sampleBinomialInversion(const uint32_t num_trials, const double prob, Xoshiro256StarStar * rng) const;
+        uint32_t sampleBinomialBTRD(const uint32_t num_trials, const double prob, Xoshiro256StarStar * rng) const;
+
+        double stirlingApproxTail(const uint32_t value) const;
+};
+
+
+#endif
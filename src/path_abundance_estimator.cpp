@@ -10,89 +10,191 @@
 const uint32_t min_em_conv_its = 10;
 const double min_em_abundance = 1e-8;
 
+const double em_warm_start_min_rel_abundance = 0.01;
+
+const uint32_t em_warm_start_subset_spacing = 8;
+
+const uint32_t path_subset_task_size = 8;
+
 const double abundance_gibbs_gamma = 1;
 
 const uint32_t min_rel_likelihood_scaling = 1e4;
 
-PathAbundanceEstimator::PathAbundanceEstimator(const uint32_t max_em_its_in, const double max_rel_em_conv_in, const uint32_t num_gibbs_samples_in, const uint32_t gibbs_thin_its_in, const double prob_precision) : max_em_its(max_em_its_in), max_rel_em_conv(max_rel_em_conv_in), num_gibbs_samples(num_gibbs_samples_in), gibbs_thin_its(gibbs_thin_its_in), PathEstimator(prob_precision) {}
+PathAbundanceEstimator::PathAbundanceEstimator(const uint32_t max_em_its_in, const double max_rel_em_conv_in, const uint32_t num_gibbs_samples_in, const uint32_t gibbs_thin_its_in, const uint32_t num_gibbs_chains_in, const double prob_precision) : max_em_its(max_em_its_in), max_rel_em_conv(max_rel_em_conv_in), num_gibbs_samples(num_gibbs_samples_in), gibbs_thin_its(gibbs_thin_its_in), num_gibbs_chains(num_gibbs_chains_in), PathEstimator(prob_precision) {}
 
 void PathAbundanceEstimator::estimate(PathClusterEstimates * path_cluster_estimates, const vector<ReadPathProbabilities> & cluster_probs, mt19937 * mt_rng) {
 
-    if (!cluster_probs.empty()) {
+    PathAbundanceEstimator::estimateBatch(vector<PathClusterEstimates *>({path_cluster_estimates}), vector<const vector<ReadPathProbabilities> *>({&cluster_probs}), vector<mt19937 *>({mt_rng}));
+}
 
-        Utils::ColMatrixXd read_path_probs;
-        Utils::ColVectorXd noise_probs;
-        Utils::RowVectorXd read_counts;
+void PathAbundanceEstimator::estimateBatch(const vector<PathClusterEstimates *> & path_cluster_estimates, const vector<const vector<ReadPathProbabilities> *> & cluster_probs, const vector<mt19937 *> & mt_rngs) {
 
-        constructProbabilityMatrix(&read_path_probs, &noise_probs, &read_counts, cluster_probs, path_cluster_estimates->paths.size());
-        detractNoiseAndNormalizeProbabilityMatrix(&read_path_probs, &noise_probs, &read_counts);
+    assert(path_cluster_estimates.size() == cluster_probs.size());
+    assert(path_cluster_estimates.size() == mt_rngs.size());
 
-        if (read_path_probs.rows() == 0) {
+    vector<PathClusterEstimates *> em_path_cluster_estimates;
+    em_path_cluster_estimates.reserve(path_cluster_estimates.size());
 
-            assert(noise_probs.rows() == 0);
-            assert(read_counts.cols() == 0);
+    vector<uint32_t> em_cluster_indices;
+    em_cluster_indices.reserve(path_cluster_estimates.size());
 
-            path_cluster_estimates->initEstimates(path_cluster_estimates->paths.size(), 0, true);
-            return;
+    vector<uint32_t> batch_row_offsets(1, 0);
+    batch_row_offsets.reserve(path_cluster_estimates.size() + 1);
+
+    uint32_t max_em_cols = 0;
+
+    for (size_t i = 0; i < path_cluster_estimates.size(); ++i) {
+
+        if (cluster_probs.at(i)->empty()) {
+
+            path_cluster_estimates.at(i)->initEstimates(path_cluster_estimates.at(i)->paths.size(), 0, true);
+            continue;
         }
 
-        const double total_read_count = read_counts.sum();
-        assert(total_read_count > 0);
+        if (num_gibbs_samples == 0) {
 
-        path_cluster_estimates->initEstimates(path_cluster_estimates->paths.size(), 0, false);
-        EMAbundanceEstimator(path_cluster_estimates, read_path_probs, read_counts, total_read_count);
+            vector<uint32_t> trivial_path_ids;
+            double trivial_read_count = 0;
 
-        if (num_gibbs_samples > 0) {
+            if (isTrivialCluster(&trivial_path_ids, &trivial_read_count, *(cluster_probs.at(i)))) {
 
-            vector<CountSamples> * gibbs_read_count_samples = &(path_cluster_estimates->gibbs_read_count_samples);
-            gibbs_read_count_samples->emplace_back(CountSamples());
+                // All reads are explained equally well by the same paths,
+                // which gives uniform EM abundances over these paths.
+                path_cluster_estimates.at(i)->initEstimates(path_cluster_estimates.at(i)->paths.size(), 0, true);
 
-            gibbs_read_count_samples->back().path_ids = vector<uint32_t>(path_cluster_estimates->abundances.cols());
-            iota(gibbs_read_count_samples->back().path_ids.begin(), gibbs_read_count_samples->back().path_ids.end(), 0);
+                for (auto & path_id: trivial_path_ids) {
 
-            gibbs_read_count_samples->back().samples = vector<vector<double> >(path_cluster_estimates->abundances.cols(), vector<double>());
+                    path_cluster_estimates.at(i)->abundances(0, path_id) = trivial_read_count / trivial_path_ids.size();
+                }
 
-            gibbsReadCountSampler(path_cluster_estimates, read_path_probs, read_counts, total_read_count, abundance_gibbs_gamma, mt_rng);
+                continue;
+            }
         }
 
-        path_cluster_estimates->abundances *= total_read_count;
+        uint32_t num_rows = 0;
 
-    } else {
+        for (auto & cluster_prob: *(cluster_probs.at(i))) {
 
-        path_cluster_estimates->initEstimates(path_cluster_estimates->paths.size(), 0, true);
+            if (!Utils::doubleCompare(cluster_prob.noiseProb(), 1)) {
+
+                ++num_rows;
+            }
+        }
+
+        if (num_rows == 0) {
+
+            path_cluster_estimates.at(i)->initEstimates(path_cluster_estimates.at(i)->paths.size(), 0, true);
+            continue;
+        }
+
+        path_cluster_estimates.at(i)->initEstimates(path_cluster_estimates.at(i)->paths.size(), 0, false);
+
+        em_path_cluster_estimates.emplace_back(path_cluster_estimates.at(i));
+        em_cluster_indices.emplace_back(i);
+
+        batch_row_offsets.emplace_back(batch_row_offsets.back() + num_rows);
+        max_em_cols = max(max_em_cols, static_cast<uint32_t>(path_cluster_estimates.at(i)->paths.size()));
     }
-}
 
-void PathAbundanceEstimator::EMAbundanceEstimator(PathClusterEstimates * path_cluster_estimates, const Utils::ColMatrixXd & read_path_probs, const Utils::RowVectorXd & read_counts, const double total_read_count) const {
+    if (em_path_cluster_estimates.empty()) {
 
-    Utils::RowVectorXd prev_abundances = path_cluster_estimates->abundances;
-    uint32_t em_conv_its = 0;
+        return;
+    }
 
-    for (uint32_t i = 0; i < max_em_its; ++i) {
+    // Construct the probability matrix of all clusters directly by stacking
+    // their rows, which gives a block diagonal matrix with the (zero)
+    // off-diagonal blocks removed. Reads that are noise are left out.
+    Utils::ColMatrixXd batch_read_path_probs = Utils::ColMatrixXd::Zero(batch_row_offsets.back(), max_em_cols);
+    Utils::RowVectorXd batch_read_counts(batch_row_offsets.back());
 
-        Utils::ColMatrixXd read_posteriors = read_path_probs.array().rowwise() * path_cluster_estimates->abundances.array();
-        read_posteriors = read_posteriors.array().colwise() / read_posteriors.rowwise().sum().array();
+    vector<double> total_read_counts;
+    total_read_counts.reserve(em_path_cluster_estimates.size());
 
-        path_cluster_estimates->abundances = read_counts * read_posteriors;
-        path_cluster_estimates->abundances /= total_read_count;
+    for (size_t i = 0; i < em_path_cluster_estimates.size(); ++i) {
 
-        bool has_converged = true;
+        uint32_t row_idx = batch_row_offsets.at(i);
 
-        for (size_t i = 0; i < path_cluster_estimates->abundances.cols(); ++i) {
+        for (auto & cluster_prob: *(cluster_probs.at(em_cluster_indices.at(i)))) {
 
-            if (path_cluster_estimates->abundances(0, i) >= min_em_abundance) {
+            if (Utils::doubleCompare(cluster_prob.noiseProb(), 1)) {
 
-                auto rel_abundance_diff = fabs(path_cluster_estimates->abundances(0, i) - prev_abundances(0, i)) / path_cluster_estimates->abundances(0, i);
+                continue;
+            }
 
-                if (rel_abundance_diff > max_rel_em_conv) {
+            for (auto & path_probs: cluster_prob.pathProbs()) {
 
-                    has_converged = false;
-                    break;
+                for (auto & path: path_probs.second) {
+
+                    assert(path < em_path_cluster_estimates.at(i)->paths.size());
+                    batch_read_path_probs(row_idx, path) = path_probs.first;
                 }
             }
+
+            batch_read_counts(0, row_idx) = cluster_prob.readCount() - cluster_prob.readCount() * cluster_prob.noiseProb();
+            ++row_idx;
         }
 
-        if (has_converged) {
+        assert(row_idx == batch_row_offsets.at(i + 1));
+        total_read_counts.emplace_back(batch_read_counts.segment(batch_row_offsets.at(i), row_idx - batch_row_offsets.at(i)).sum());
+
+        assert(total_read_counts.back() > 0);
+    }
+
+    batch_read_path_probs = batch_read_path_probs.array().colwise() / batch_read_path_probs.rowwise().sum().array();
+
+    EMAbundanceEstimatorBatch(em_path_cluster_estimates, batch_read_path_probs, batch_read_counts, batch_row_offsets, total_read_counts);
+
+    for (size_t i = 0; i < em_path_cluster_estimates.size(); ++i) {
+
+        PathClusterEstimates * cur_path_cluster_estimates = em_path_cluster_estimates.at(i);
+
+        if (num_gibbs_samples > 0) {
+
+            vector<CountSamples> * gibbs_read_count_samples = &(cur_path_cluster_estimates->gibbs_read_count_samples);
+            gibbs_read_count_samples->emplace_back(CountSamples());
+
+            gibbs_read_count_samples->back().path_ids = vector<uint32_t>(cur_path_cluster_estimates->abundances.cols());
+            iota(gibbs_read_count_samples->back().path_ids.begin(), gibbs_read_count_samples->back().path_ids.end(), 0);
+
+            gibbs_read_count_samples->back().samples = vector<vector<double> >(cur_path_cluster_estimates->abundances.cols(), vector<double>());
+
+            // The batch EM leaves the stacked matrices unchanged, such that the
+            // sampler can read the block of the cluster directly.
+            const uint32_t num_rows = batch_row_offsets.at(i + 1) - batch_row_offsets.at(i);
+            gibbsReadCountSampler(cur_path_cluster_estimates, batch_read_path_probs.block(batch_row_offsets.at(i), 0, num_rows, cur_path_cluster_estimates->abundances.cols()), batch_read_counts.segment(batch_row_offsets.at(i), num_rows), total_read_counts.at(i), abundance_gibbs_gamma, mt_rngs.at(em_cluster_indices.at(i)));
+        }
+
+        cur_path_cluster_estimates->abundances *= total_read_counts.at(i);
+    }
+}
+
+void PathAbundanceEstimator::EMAbundanceEstimator(PathClusterEstimates * path_cluster_estimates, const ProbabilityMatrixView & read_path_probs, const double total_read_count, ProbabilityMatrixBuffer * read_path_probs_buffer) const {
+
+    assert(path_cluster_estimates->abundances.cols() == read_path_probs.cols());
+
+    // Gather the reads of the view, which are iterated many times, into
+    // the top left corner of the reused buffer.
+    read_path_probs.gather(read_path_probs_buffer);
+
+    const auto em_read_path_probs = read_path_probs_buffer->read_path_probs.topLeftCorner(read_path_probs.rows(), read_path_probs.cols());
+    const auto em_read_counts = read_path_probs_buffer->read_counts.head(read_path_probs.rows());
+
+    // Read counts divided by the read probabilities given the abundances.
+    auto read_weights = read_path_probs_buffer->read_weights.head(read_path_probs.rows());
+
+    Utils::RowVectorXd * abundances = &(path_cluster_estimates->abundances);
+
+    Utils::RowVectorXd prev_abundances = *abundances;
+    uint32_t em_conv_its = 0;
+
+    for (uint32_t i = 0; i < max_em_its; ++i) {
+
+        read_weights.noalias() = em_read_path_probs * abundances->transpose();
+        read_weights = (read_weights.array() > 0).select(em_read_counts.transpose().array() / read_weights.array(), 0);
+
+        *abundances = abundances->array() * (read_weights.transpose() * em_read_path_probs).array() / total_read_count;
+
+        if (hasEMConverged(*abundances, prev_abundances)) {
 
             em_conv_its++;
 
@@ -100,89 +202,221 @@ void PathAbundanceEstimator::EMAbundanceEstimator(PathClusterEstimates * path_cl
 
                 break;
             }
-        
+
         } else {
 
             em_conv_its = 0;
-        } 
+        }
+
+        prev_abundances = *abundances;
+    }
+
+    removeLowEMAbundances(abundances);
+}
+
+void PathAbundanceEstimator::EMAbundanceEstimatorBatch(const vector<PathClusterEstimates *> & path_cluster_estimates, const Utils::ColMatrixXd & read_path_probs, const Utils::RowVectorXd & read_counts, const vector<uint32_t> & row_offsets, const vector<double> & total_read_counts) const {
+
+    assert(row_offsets.size() == path_cluster_estimates.size() + 1);
+    assert(total_read_counts.size() == path_cluster_estimates.size());
 
-        prev_abundances = path_cluster_estimates->abundances;
+    assert(row_offsets.back() == read_path_probs.rows());
+    assert(row_offsets.back() == read_counts.cols());
+
+    uint32_t max_cluster_num_rows = 0;
+
+    vector<Utils::RowVectorXd> prev_abundances;
+    prev_abundances.reserve(path_cluster_estimates.size());
+
+    for (size_t i = 0; i < path_cluster_estimates.size(); ++i) {
+
+        max_cluster_num_rows = max(max_cluster_num_rows, row_offsets.at(i + 1) - row_offsets.at(i));
+        prev_abundances.emplace_back(path_cluster_estimates.at(i)->abundances);
+    }
+
+    // Read posteriors of a single cluster, which are reused between the
+    // clusters and iterations.
+    Utils::ColMatrixXd read_posteriors(max_cluster_num_rows, read_path_probs.cols());
+
+    vector<uint32_t> em_conv_its(path_cluster_estimates.size(), 0);
+
+    // Clusters that have not yet converged. Only the blocks of these are
+    // updated in each iteration.
+    vector<uint32_t> active_cluster_indices(path_cluster_estimates.size());
+    iota(active_cluster_indices.begin(), active_cluster_indices.end(), 0);
+
+    for (uint32_t i = 0; i < max_em_its; ++i) {
+
+        uint32_t num_active_clusters = 0;
+
+        for (size_t j = 0; j < active_cluster_indices.size(); ++j) {
+
+            const uint32_t cluster_idx = active_cluster_indices.at(j);
+            Utils::RowVectorXd * abundances = &(path_cluster_estimates.at(cluster_idx)->abundances);
+
+            const uint32_t row_offset = row_offsets.at(cluster_idx);
+            const uint32_t cluster_num_rows = row_offsets.at(cluster_idx + 1) - row_offset;
+
+            auto cluster_read_posteriors = read_posteriors.topLeftCorner(cluster_num_rows, abundances->cols());
+
+            cluster_read_posteriors = read_path_probs.block(row_offset, 0, cluster_num_rows, abundances->cols()).array().rowwise() * abundances->array();
+            cluster_read_posteriors = cluster_read_posteriors.array().colwise() / cluster_read_posteriors.rowwise().sum().array();
+
+            *abundances = read_counts.segment(row_offset, cluster_num_rows) * cluster_read_posteriors;
+            *abundances /= total_read_counts.at(cluster_idx);
+
+            if (hasEMConverged(*abundances, prev_abundances.at(cluster_idx))) {
+
+                em_conv_its.at(cluster_idx)++;
+
+                if (em_conv_its.at(cluster_idx) == min_em_conv_its) {
+
+                    continue;
+                }
+
+            } else {
+
+                em_conv_its.at(cluster_idx) = 0;
+            }
+
+            prev_abundances.at(cluster_idx) = *abundances;
+
+            active_cluster_indices.at(num_active_clusters) = cluster_idx;
+            ++num_active_clusters;
+        }
+
+        active_cluster_indices.resize(num_active_clusters);
+
+        if (active_cluster_indices.empty()) {
+
+            break;
+        }
+    }
+
+    for (auto & cur_path_cluster_estimates: path_cluster_estimates) {
+
+        removeLowEMAbundances(&(cur_path_cluster_estimates->abundances));
+    }
+}
+
+bool PathAbundanceEstimator::hasEMConverged(const Utils::RowVectorXd & abundances, const Utils::RowVectorXd & prev_abundances) const {
+
+    assert(abundances.cols() == prev_abundances.cols());
+
+    for (size_t i = 0; i < abundances.cols(); ++i) {
+
+        if (abundances(0, i) >= min_em_abundance) {
+
+            auto rel_abundance_diff = fabs(abundances(0, i) - prev_abundances(0, i)) / abundances(0, i);
+
+            if (rel_abundance_diff > max_rel_em_conv) {
+
+                return false;
+            }
+        }
     }
 
+    return true;
+}
+
+void PathAbundanceEstimator::removeLowEMAbundances(Utils::RowVectorXd * abundances) const {
+
     double abundances_sum = 0;
 
-    for (size_t i = 0; i < path_cluster_estimates->abundances.cols(); ++i) {
+    for (size_t i = 0; i < abundances->cols(); ++i) {
 
-        if (path_cluster_estimates->abundances(0, i) < min_em_abundance) {
+        if ((*abundances)(0, i) < min_em_abundance) {
 
-            path_cluster_estimates->abundances(0, i) = 0;                    
+            (*abundances)(0, i) = 0;                    
         } 
 
-        abundances_sum += path_cluster_estimates->abundances(0, i);
+        abundances_sum += (*abundances)(0, i);
     }
 
     if (abundances_sum > 0) {
 
-        path_cluster_estimates->abundances = path_cluster_estimates->abundances / abundances_sum;
+        *abundances = *abundances / abundances_sum;
     }
 }
 
-void PathAbundanceEstimator::gibbsReadCountSampler(PathClusterEstimates * path_cluster_estimates, const Utils::ColMatrixXd & read_path_probs, const Utils::RowVectorXd & read_counts, const double total_read_count, const double gamma, mt19937 * mt_rng) const {
+void PathAbundanceEstimator::gibbsReadCountSampler(PathClusterEstimates * path_cluster_estimates, const Eigen::Ref<const Utils::ColMatrixXd> & read_path_probs, const Eigen::Ref<const Utils::RowVectorXd> & read_counts, const double total_read_count, const double gamma, mt19937 * mt_rng) const {
 
     assert(!path_cluster_estimates->gibbs_read_count_samples.empty());
     assert(path_cluster_estimates->gibbs_read_count_samples.back().path_ids.size() == path_cluster_estimates->abundances.cols());
     assert(path_cluster_estimates->gibbs_read_count_samples.back().samples.size() == path_cluster_estimates->abundances.cols());
 
     assert(Utils::doubleCompare(path_cluster_estimates->abundances.sum(), 1));
-    Utils::RowVectorXd gibbs_abundances = path_cluster_estimates->abundances;
 
-    const uint32_t num_gibbs_its = num_gibbs_samples * gibbs_thin_its;
+    auto * gibbs_read_count_samples = &(path_cluster_estimates->gibbs_read_count_samples.back().samples);
+    const uint32_t num_chains = min(num_gibbs_chains, num_gibbs_samples);
 
-    for (uint32_t gibbs_it = 1; gibbs_it <= num_gibbs_its; ++gibbs_it) {
+    const uint64_t chains_seed = Utils::deriveStreamSeed(mt_rng);
 
-        Utils::ColMatrixXd read_posteriors = read_path_probs.array().rowwise() * gibbs_abundances.array();
-        read_posteriors = read_posteriors.array().colwise() / read_posteriors.rowwise().sum().array();
+    if (num_chains <= 1) {
 
-        vector<uint32_t> gibbs_path_read_counts(gibbs_abundances.cols(), 0);
+        Xoshiro256StarStar chain_rng(Utils::streamSeed(chains_seed, 0));
+        gibbsReadCountChain(gibbs_read_count_samples, path_cluster_estimates->abundances, read_path_probs, read_counts, total_read_count, gamma, num_gibbs_samples, &chain_rng);
 
-        for (size_t i = 0; i < read_posteriors.rows(); ++i) {
+        return;
+    }
 
-            uint32_t row_reads_counts = read_counts(0, i);
-            double row_sum_probs = 1;
+    vector<vector<vector<double> > > chains_read_count_samples(num_chains, vector<vector<double> >(gibbs_read_count_samples->size()));
 
-            for (size_t j = 0; j < read_posteriors.cols(); ++j) {
+    for (uint32_t chain_idx = 0; chain_idx < num_chains; ++chain_idx) {
 
-                auto cur_prob = read_posteriors(i, j);
+        #pragma omp task default(shared) firstprivate(chain_idx)
+        {
+            Xoshiro256StarStar chain_rng(Utils::streamSeed(chains_seed, chain_idx));
 
-                if (cur_prob > 0) {
+            const uint32_t num_chain_samples = num_gibbs_samples / num_chains + (chain_idx < num_gibbs_samples % num_chains ? 1 : 0);
+            gibbsReadCountChain(&(chains_read_count_samples.at(chain_idx)), path_cluster_estimates->abundances, read_path_probs, read_counts, total_read_count, gamma, num_chain_samples, &chain_rng);
+        }
+    }
 
-                    assert(row_sum_probs > 0);
+    #pragma omp taskwait
 
-                    binomial_distribution<uint32_t> path_read_count_sampler(row_reads_counts, min(1.0, cur_prob / row_sum_probs));
-                    auto path_read_count = path_read_count_sampler(*mt_rng);
+    // Interleave samples in a fixed order (sample k is from chain k % num_chains).
+    for (size_t i = 0; i < gibbs_read_count_samples->size(); ++i) {
 
-                    gibbs_path_read_counts.at(j) += path_read_count;
-                    row_reads_counts -= path_read_count;
+        gibbs_read_count_samples->at(i).reserve(gibbs_read_count_samples->at(i).size() + num_gibbs_samples);
 
-                    if (row_reads_counts == 0) {
+        for (uint32_t j = 0; j < num_gibbs_samples; ++j) {
 
-                        break;
-                    }
-                }
+            gibbs_read_count_samples->at(i).emplace_back(chains_read_count_samples.at(j % num_chains).at(i).at(j / num_chains));
+        }
+    }
+}
 
-                row_sum_probs -= cur_prob;
-            }
+void PathAbundanceEstimator::gibbsReadCountChain(vector<vector<double> > * chain_read_count_samples, const Utils::RowVectorXd & init_abundances, const Eigen::Ref<const Utils::ColMatrixXd> & read_path_probs, const Eigen::Ref<const Utils::RowVectorXd> & read_counts, const double total_read_count, const double gamma, const uint32_t num_chain_samples, Xoshiro256StarStar * rng) const {
+
+    assert(chain_read_count_samples->size() == init_abundances.cols());
+    Utils::RowVectorXd gibbs_abundances = init_abundances;
+
+    const uint32_t num_gibbs_its = num_chain_samples * gibbs_thin_its;
+
+    MultinomialSampler multinomial_sampler;
+    gamma_distribution<double> gamma_count_sampler;
+
+    // Row-major to enable contiguous multinomial sampling of each read.
+    Utils::RowMatrixXd read_posteriors;
+    vector<uint32_t> gibbs_path_read_counts(gibbs_abundances.cols(), 0);
+
+    for (uint32_t gibbs_it = 1; gibbs_it <= num_gibbs_its; ++gibbs_it) {
+
+        read_posteriors = read_path_probs.array().rowwise() * gibbs_abundances.array();
+        read_posteriors = read_posteriors.array().colwise() / read_posteriors.rowwise().sum().array();
+
+        fill(gibbs_path_read_counts.begin(), gibbs_path_read_counts.end(), 0);
 
-            assert(row_reads_counts == 0);
+        for (size_t i = 0; i < read_posteriors.rows(); ++i) {
+
+            multinomial_sampler.sample(&(gibbs_path_read_counts.front()), read_posteriors.row(i).data(), read_posteriors.cols(), read_counts(0, i), rng);
         }
 
         double gibbs_abundances_sum = 0;
 
         for (size_t i = 0; i < gibbs_abundances.cols(); ++i) {
 
-            gamma_distribution<double> gamma_count_dist(gibbs_path_read_counts.at(i) + gamma, 1);
-
-            gibbs_abundances(0, i) = gamma_count_dist(*mt_rng);
+            gibbs_abundances(0, i) = gamma_count_sampler(*rng, gamma_distribution<double>::param_type(gibbs_path_read_counts.at(i) + gamma, 1));
             gibbs_abundances_sum += gibbs_abundances(0, i);
         }
 
@@ -192,7 +426,7 @@ void PathAbundanceEstimator::gibbsReadCountSampler(PathClusterEstimates * path_c
 
             for (size_t i = 0; i < gibbs_abundances.cols(); ++i) {
 
-                path_cluster_estimates->gibbs_read_count_samples.back().samples.at(i).emplace_back(gibbs_abundances(0, i) * total_read_count);
+                chain_read_count_samples->at(i).emplace_back(gibbs_abundances(0, i) * total_read_count);
             }
         }
     }
@@ -215,7 +449,7 @@ void PathAbundanceEstimator::updateEstimates(PathClusterEstimates * path_cluster
 }
 
 
-MinimumPathAbundanceEstimator::MinimumPathAbundanceEstimator(const uint32_t max_em_its, const double max_rel_em_conv, const uint32_t num_gibbs_samples, const uint32_t gibbs_thin_its, const double prob_precision) : PathAbundanceEstimator(max_em_its, max_rel_em_conv, num_gibbs_samples, gibbs_thin_its, prob_precision) {}
+MinimumPathAbundanceEstimator::MinimumPathAbundanceEstimator(const uint32_t max_em_its, const double max_rel_em_conv, const uint32_t num_gibbs_samples, const uint32_t gibbs_thin_its, const uint32_t num_gibbs_chains, const double prob_precision) : PathAbundanceEstimator(max_em_its, max_rel_em_conv, num_gibbs_samples, gibbs_thin_its, num_gibbs_chains, prob_precision) {}
 
 void MinimumPathAbundanceEstimator::estimate(PathClusterEstimates * path_cluster_estimates, const vector<ReadPathProbabilities> & cluster_probs, mt19937 * mt_rng) {
 
@@ -230,11 +464,14 @@ void MinimumPathAbundanceEstimator::estimate(PathClusterEstimates * path_cluster
         Utils::ColMatrixXb read_path_cover = Utils::ColMatrixXb::Zero(read_path_probs.rows(), read_path_probs.cols());
         Utils::RowVectorXd path_weights = Utils::RowVectorXd::Zero(read_path_probs.cols());
 
+        // Reads that are noise do not need to be covered.
+        Utils::RowVectorXd cover_read_counts = read_counts;
+
         for (size_t i = 0; i < read_path_probs.rows(); ++i) {
 
             if (Utils::doubleCompare(noise_probs(i), 1)) {
 
-                read_counts(i) = 0;
+                cover_read_counts(i) = 0;
             }
 
             for (auto & path_probs: cluster_probs.at(i).pathProbs()) {
@@ -244,55 +481,58 @@ void MinimumPathAbundanceEstimator::estimate(PathClusterEstimates * path_cluster
                     assert(path_probs.first > 0);
 
                     read_path_cover(i, path) = true;
-                    path_weights(path) += log(path_probs.first) * read_counts(i);  
-                }               
+                    path_weights(path) += log(path_probs.first) * cover_read_counts(i);
+                }
             }
         }
 
         path_weights *= -1;
-        vector<uint32_t> min_path_cover = weightedMinimumPathCover(read_path_cover, read_counts, path_weights);
+        vector<uint32_t> min_path_cover = weightedMinimumPathCover(read_path_cover, cover_read_counts, path_weights);
 
         if (!min_path_cover.empty()) {
 
-            Utils::ColMatrixXd min_path_read_path_probs;
-            Utils::ColVectorXd min_path_noise_probs;
-            Utils::RowVectorXd min_path_read_counts;
+            detractNoiseAndNormalizeProbabilityMatrix(&read_path_probs, &noise_probs, &read_counts);
 
-            constructPartialProbabilityMatrix(&min_path_read_path_probs, &min_path_noise_probs, &min_path_read_counts, cluster_probs, min_path_cover, path_cluster_estimates->paths.size(), true);
-            detractNoiseAndNormalizeProbabilityMatrix(&min_path_read_path_probs, &min_path_noise_probs, &min_path_read_counts);
+            if (read_path_probs.rows() == 0) {
 
-            if (min_path_read_path_probs.rows() == 0) {
+                path_cluster_estimates->initEstimates(path_cluster_estimates->paths.size(), 0, true);
+                return;
+            }
+
+            readCollapseProbabilityMatrix(&read_path_probs, &read_counts);
 
-                assert(min_path_noise_probs.rows() == 0);
-                assert(min_path_read_counts.cols() == 0);
+            const ProbabilityMatrixView min_path_read_path_probs(read_path_probs, read_counts, min_path_cover);
+
+            if (min_path_read_path_probs.rows() == 0) {
 
                 path_cluster_estimates->initEstimates(path_cluster_estimates->paths.size(), 0, true);
                 return;
             }
 
-            assert(min_path_read_path_probs.cols() >= 1);
-            readCollapseProbabilityMatrix(&min_path_read_path_probs, &min_path_read_counts);
-
-            const double total_min_path_read_counts = min_path_read_counts.sum();
+            const double total_min_path_read_counts = min_path_read_path_probs.totalReadCount();
             assert(total_min_path_read_counts > 0);
 
             PathClusterEstimates min_path_cluster_estimates;
             min_path_cluster_estimates.initEstimates(min_path_read_path_probs.cols(), 0, false);
 
-            EMAbundanceEstimator(&min_path_cluster_estimates, min_path_read_path_probs, min_path_read_counts, total_min_path_read_counts);
+            ProbabilityMatrixBuffer min_path_read_path_probs_buffer;
+            EMAbundanceEstimator(&min_path_cluster_estimates, min_path_read_path_probs, total_min_path_read_counts, &min_path_read_path_probs_buffer);
             assert(min_path_cluster_estimates.abundances.cols() == min_path_cover.size());            
 
             path_cluster_estimates->initEstimates(path_cluster_estimates->paths.size(), 0, true);
 
             if (num_gibbs_samples > 0) {
 
+                // Merges the identical reads that EM gathered into the buffer.
+                const uint32_t num_gibbs_reads = constructCollapsedProbabilityMatrix(&min_path_read_path_probs_buffer, min_path_read_path_probs);
+
                 vector<CountSamples> * gibbs_read_count_samples = &(min_path_cluster_estimates.gibbs_read_count_samples);
                 gibbs_read_count_samples->emplace_back(CountSamples());
 
                 gibbs_read_count_samples->back().path_ids = min_path_cover;                
                 gibbs_read_count_samples->back().samples = vector<vector<double> >(min_path_cluster_estimates.abundances.cols(), vector<double>());
 
-                gibbsReadCountSampler(&min_path_cluster_estimates, min_path_read_path_probs, min_path_read_counts, total_min_path_read_counts, abundance_gibbs_gamma, mt_rng);
+                gibbsReadCountSampler(&min_path_cluster_estimates, min_path_read_path_probs_buffer.read_path_probs.topLeftCorner(num_gibbs_reads, min_path_read_path_probs.cols()), min_path_read_path_probs_buffer.read_counts.head(num_gibbs_reads), total_min_path_read_counts, abundance_gibbs_gamma, mt_rng);
             }
 
             min_path_cluster_estimates.abundances *= total_min_path_read_counts;
@@ -309,6 +549,11 @@ void MinimumPathAbundanceEstimator::estimate(PathClusterEstimates * path_cluster
     }
 }
 
+void MinimumPathAbundanceEstimator::estimateBatch(const vector<PathClusterEstimates *> & path_cluster_estimates, const vector<const vector<ReadPathProbabilities> *> & cluster_probs, const vector<mt19937 *> & mt_rngs) {
+
+    PathEstimator::estimateBatch(path_cluster_estimates, cluster_probs, mt_rngs);
+}
+
 vector<uint32_t> MinimumPathAbundanceEstimator::weightedMinimumPathCover(const Utils::ColMatrixXb & read_path_cover, const Utils::RowVectorXd & read_counts, const Utils::RowVectorXd & path_weights) const {
 
     assert(read_path_cover.rows() == read_counts.cols());
@@ -355,7 +600,7 @@ vector<uint32_t> MinimumPathAbundanceEstimator::weightedMinimumPathCover(const U
 }
 
 
-NestedPathAbundanceEstimator::NestedPathAbundanceEstimator(const uint32_t group_size_in, const uint32_t num_subset_samples_in, const bool infer_collapsed_in, const bool use_group_post_gibbs_in, const uint32_t max_em_its, const double max_rel_em_conv, const uint32_t num_gibbs_samples, const uint32_t gibbs_thin_its, const double prob_precision) : group_size(group_size_in), num_subset_samples(num_subset_samples_in), infer_collapsed(infer_collapsed_in), use_group_post_gibbs(use_group_post_gibbs_in), PathAbundanceEstimator(max_em_its, max_rel_em_conv, num_gibbs_samples, gibbs_thin_its, prob_precision) {}
+NestedPathAbundanceEstimator::NestedPathAbundanceEstimator(const uint32_t group_size_in, const uint32_t num_subset_samples_in, const bool infer_collapsed_in, const bool use_group_post_gibbs_in, const uint32_t max_em_its, const double max_rel_em_conv, const uint32_t num_gibbs_samples, const uint32_t gibbs_thin_its, const uint32_t num_gibbs_chains, const double prob_precision) : group_size(group_size_in), num_subset_samples(num_subset_samples_in), infer_collapsed(infer_collapsed_in), use_group_post_gibbs(use_group_post_gibbs_in), PathAbundanceEstimator(max_em_its, max_rel_em_conv, num_gibbs_samples, gibbs_thin_its, num_gibbs_chains, prob_precision) {}
 
 void NestedPathAbundanceEstimator::estimate(PathClusterEstimates * path_cluster_estimates, const vector<ReadPathProbabilities> & cluster_probs, mt19937 * mt_rng) {
 
@@ -369,6 +614,11 @@ void NestedPathAbundanceEstimator::estimate(PathClusterEstimates * path_cluster_
     }
 }
 
+void NestedPathAbundanceEstimator::estimateBatch(const vector<PathClusterEstimates *> & path_cluster_estimates, const vector<const vector<ReadPathProbabilities> *> & cluster_probs, const vector<mt19937 *> & mt_rngs) {
+
+    PathEstimator::estimateBatch(path_cluster_estimates, cluster_probs, mt_rngs);
+}
+
 void NestedPathAbundanceEstimator::inferAbundancesIndependentGroups(PathClusterEstimates * path_cluster_estimates, const vector<ReadPathProbabilities> & cluster_probs, mt19937 * mt_rng) const {
 
     if (!cluster_probs.empty()) {
@@ -412,7 +662,7 @@ void NestedPathAbundanceEstimator::inferAbundancesIndependentGroups(PathClusterE
 
             } else {
 
-                if (group_size == 2) {
+                if (group_size > 1) {
 
                     const double min_rel_likelihood = 1 / static_cast<double>(min_rel_likelihood_scaling * num_subset_samples); 
                     calculatePathGroupPosteriorsBounded(&group_path_cluster_estimates, group_read_path_probs, group_noise_probs, group_read_counts, group_path_counts, group_size, min_rel_likelihood);
@@ -470,7 +720,7 @@ void NestedPathAbundanceEstimator::inferAbundancesCollapsedGroups(PathClusterEst
 
         } else {
 
-            if (group_size == 2) {
+            if (group_size > 1) {
 
                 const double min_rel_likelihood = 1 / static_cast<double>(min_rel_likelihood_scaling * num_subset_samples); 
                 calculatePathGroupPosteriorsBounded(&group_path_cluster_estimates, group_read_path_probs, group_noise_probs, group_read_counts, path_source_groups.second, group_size, min_rel_likelihood);
@@ -631,15 +881,59 @@ void NestedPathAbundanceEstimator::inferPathSubsetAbundance(PathClusterEstimates
 
     path_cluster_estimates->initEstimates(path_cluster_estimates->paths.size(), 0, true);
 
-    spp::sparse_hash_map<vector<uint32_t>, uint32_t> subset_path_group_samples;    
+    // Path subsets with the same unique paths (collapsed subset) share the
+    // probability matrix and EM estimate. Sorting the collapsed subsets makes
+    // consecutive subsets similar and the processing order deterministic.
+    vector<pair<vector<uint32_t>, const pair<const vector<uint32_t>, uint32_t> *> > collapsed_path_subset_samples;
+    collapsed_path_subset_samples.reserve(path_subset_samples.size());
 
     for (auto & path_subset: path_subset_samples) {
 
         assert(!path_subset.first.empty());
         assert(path_subset.second > 0);
 
+        vector<uint32_t> collapsed_path_subset;
+        collapsed_path_subset.reserve(path_subset.first.size());
+
+        collapsed_path_subset.emplace_back(path_subset.first.front());
+
+        for (size_t i = 1; i < path_subset.first.size(); ++i) {
+
+            if (path_subset.first.at(i) != collapsed_path_subset.back()) {
+
+                collapsed_path_subset.emplace_back(path_subset.first.at(i));
+            }
+        }
+
+        collapsed_path_subset_samples.emplace_back(move(collapsed_path_subset), &path_subset);
+    }
+
+    sort(collapsed_path_subset_samples.begin(), collapsed_path_subset_samples.end(), [](const pair<vector<uint32_t>, const pair<const vector<uint32_t>, uint32_t> *> & lhs, const pair<vector<uint32_t>, const pair<const vector<uint32_t>, uint32_t> *> & rhs) {
+
+        if (lhs.first != rhs.first) {
+
+            return (lhs.first < rhs.first);
+        }
+
+        return (lhs.second->first < rhs.second->first);
+    });
+
+    spp::sparse_hash_map<vector<uint32_t>, uint32_t> subset_path_group_samples;
+
+    // Offsets of the first subset of each collapsed subset.
+    vector<uint32_t> collapsed_path_subset_offsets;
+
+    for (size_t i = 0; i < collapsed_path_subset_samples.size(); ++i) {
+
+        if (i == 0 || collapsed_path_subset_samples.at(i).first != collapsed_path_subset_samples.at(i - 1).first) {
+
+            collapsed_path_subset_offsets.emplace_back(i);
+        }
+
+        const pair<const vector<uint32_t>, uint32_t> & path_subset = *(collapsed_path_subset_samples.at(i).second);
+
         spp::sparse_hash_map<uint32_t, vector<uint32_t> > subset_path_group;
-        
+
         for (auto & path: path_subset.first) {
 
             auto subset_path_group_it = subset_path_group.emplace(path_cluster_estimates->paths.at(path).group_id, vector<uint32_t>());
@@ -651,64 +945,145 @@ void NestedPathAbundanceEstimator::inferPathSubsetAbundance(PathClusterEstimates
             auto subset_path_group_samples_it = subset_path_group_samples.emplace(path_group.second, 0);
             subset_path_group_samples_it.first->second += path_subset.second;
         }
+    }
 
-        vector<uint32_t> collapsed_path_subset;
-        collapsed_path_subset.reserve(path_subset.first.size());
+    const uint32_t num_collapsed_path_subsets = collapsed_path_subset_offsets.size();
+    collapsed_path_subset_offsets.emplace_back(collapsed_path_subset_samples.size());
 
-        collapsed_path_subset.emplace_back(path_subset.first.front());
+    // Probability matrix of all paths, which the subsets are views of. Reads
+    // that are identical for all paths are identical for any subset.
+    Utils::ColMatrixXd read_path_probs;
+    Utils::ColVectorXd noise_probs;
+    Utils::RowVectorXd read_counts;
 
-        for (size_t i = 1; i < path_subset.first.size(); ++i) {
+    constructProbabilityMatrix(&read_path_probs, &noise_probs, &read_counts, cluster_probs, path_cluster_estimates->paths.size());
+    detractNoiseAndNormalizeProbabilityMatrix(&read_path_probs, &noise_probs, &read_counts);
 
-            if (path_subset.first.at(i) != collapsed_path_subset.back()) {
+    if (read_path_probs.rows() == 0) {
 
-                collapsed_path_subset.emplace_back(path_subset.first.at(i));
+        path_cluster_estimates->initEstimates(path_cluster_estimates->paths.size(), 0, true);
+        return;
+    }
+
+    readCollapseProbabilityMatrix(&read_path_probs, &read_counts);
+
+    const uint64_t subsets_seed = Utils::deriveStreamSeed(mt_rng);
+
+    // Estimates of each subset. Subsets without any reads on their paths
+    // have no abundances.
+    vector<PathClusterEstimates> subset_path_cluster_estimates(collapsed_path_subset_samples.size());
+
+    // EM estimates of each collapsed subset.
+    vector<Utils::RowVectorXd> collapsed_path_subset_abundances(num_collapsed_path_subsets);
+
+    // The collapsed subsets are evaluated in two passes. The first pass
+    // evaluates every em_warm_start_subset_spacing-th subset from a uniform
+    // start and the second pass warm starts EM of the remaining subsets from
+    // the nearest subset of the first pass. The estimates therefore do not
+    // depend on how the subsets are divided into tasks.
+    for (uint32_t pass = 0; pass < 2; ++pass) {
+
+        vector<uint32_t> pass_collapsed_path_subset_indices;
+
+        vector<vector<uint32_t> > em_path_subsets;
+        vector<Utils::RowVectorXd> em_path_subset_abundances;
+
+        for (uint32_t i = 0; i < num_collapsed_path_subsets; ++i) {
+
+            if ((i % em_warm_start_subset_spacing == 0) == (pass == 0)) {
+
+                pass_collapsed_path_subset_indices.emplace_back(i);
+
+            } else if (pass == 1 && collapsed_path_subset_abundances.at(i).cols() > 0) {
+
+                em_path_subsets.emplace_back(collapsed_path_subset_samples.at(collapsed_path_subset_offsets.at(i)).first);
+                em_path_subset_abundances.emplace_back(collapsed_path_subset_abundances.at(i));
             }
         }
 
-        Utils::ColMatrixXd subset_read_path_probs;
-        Utils::ColVectorXd subset_noise_probs;
-        Utils::RowVectorXd subset_read_counts;
+        for (uint32_t i = 0; i < pass_collapsed_path_subset_indices.size(); i += path_subset_task_size) {
 
-        constructPartialProbabilityMatrix(&subset_read_path_probs, &subset_noise_probs, &subset_read_counts, cluster_probs, collapsed_path_subset, path_cluster_estimates->paths.size(), true);
-        detractNoiseAndNormalizeProbabilityMatrix(&subset_read_path_probs, &subset_noise_probs, &subset_read_counts);
+            #pragma omp task default(shared) firstprivate(i)
+            {
+                // Reused by all subsets of the task.
+                ProbabilityMatrixBuffer subset_read_path_probs_buffer;
 
-        if (subset_read_path_probs.rows() == 0) {
+                for (uint32_t j = i; j < min(i + path_subset_task_size, static_cast<uint32_t>(pass_collapsed_path_subset_indices.size())); ++j) {
 
-            assert(subset_noise_probs.rows() == 0);
-            assert(subset_read_counts.cols() == 0);
+                    const uint32_t collapsed_path_subset_idx = pass_collapsed_path_subset_indices.at(j);
+                    const vector<uint32_t> & collapsed_path_subset = collapsed_path_subset_samples.at(collapsed_path_subset_offsets.at(collapsed_path_subset_idx)).first;
 
-            path_cluster_estimates->initEstimates(path_cluster_estimates->paths.size(), 0, true);
-            return;
-        }
+                    const ProbabilityMatrixView subset_read_path_probs(read_path_probs, read_counts, collapsed_path_subset);
 
-        assert(subset_read_path_probs.cols() >= 1);
-        readCollapseProbabilityMatrix(&subset_read_path_probs, &subset_read_counts);
+                    if (subset_read_path_probs.rows() == 0) {
 
-        const double total_subset_read_counts = subset_read_counts.sum();
-        assert(total_subset_read_counts > 0);
+                        continue;
+                    }
 
-        PathClusterEstimates subset_path_cluster_estimates;
-        subset_path_cluster_estimates.initEstimates(subset_read_path_probs.cols(), 0, false);
+                    const double total_subset_read_counts = subset_read_path_probs.totalReadCount();
+                    assert(total_subset_read_counts > 0);
 
-        EMAbundanceEstimator(&subset_path_cluster_estimates, subset_read_path_probs, subset_read_counts, total_subset_read_counts);
-        assert(subset_path_cluster_estimates.abundances.cols() == collapsed_path_subset.size());            
+                    PathClusterEstimates em_path_cluster_estimates;
+                    initNearestSubsetEMAbundances(&(em_path_cluster_estimates.abundances), subset_read_path_probs, collapsed_path_subset, em_path_subsets, em_path_subset_abundances);
 
-        if (num_gibbs_samples > 0) {
+                    EMAbundanceEstimator(&em_path_cluster_estimates, subset_read_path_probs, total_subset_read_counts, &subset_read_path_probs_buffer);
+                    assert(em_path_cluster_estimates.abundances.cols() == collapsed_path_subset.size());
 
-            vector<CountSamples> * gibbs_read_count_samples = &(subset_path_cluster_estimates.gibbs_read_count_samples);
-            gibbs_read_count_samples->emplace_back(CountSamples());
+                    collapsed_path_subset_abundances.at(collapsed_path_subset_idx) = em_path_cluster_estimates.abundances;
+
+                    // The Gibbs sampler evaluates all reads in each iteration and
+                    // therefore merges the identical reads that EM gathered
+                    // into the buffer.
+                    uint32_t num_gibbs_reads = 0;
+
+                    if (num_gibbs_samples > 0) {
+
+                        num_gibbs_reads = constructCollapsedProbabilityMatrix(&subset_read_path_probs_buffer, subset_read_path_probs);
+                    }
+
+                    for (uint32_t k = collapsed_path_subset_offsets.at(collapsed_path_subset_idx); k < collapsed_path_subset_offsets.at(collapsed_path_subset_idx + 1); ++k) {
+
+                        PathClusterEstimates * cur_path_cluster_estimates = &(subset_path_cluster_estimates.at(k));
+                        cur_path_cluster_estimates->abundances = em_path_cluster_estimates.abundances;
 
-            gibbs_read_count_samples->back().path_ids = collapsed_path_subset;            
-            gibbs_read_count_samples->back().samples = vector<vector<double> >(subset_path_cluster_estimates.abundances.cols(), vector<double>());
+                        if (num_gibbs_samples > 0) {
 
-            for (uint32_t i = 0; i < path_subset.second; ++i) {
+                            mt19937 subset_mt_rng = Utils::streamMersenneTwister(subsets_seed, k);
 
-                gibbsReadCountSampler(&subset_path_cluster_estimates, subset_read_path_probs, subset_read_counts, total_subset_read_counts, abundance_gibbs_gamma, mt_rng);
+                            vector<CountSamples> * gibbs_read_count_samples = &(cur_path_cluster_estimates->gibbs_read_count_samples);
+                            gibbs_read_count_samples->emplace_back(CountSamples());
+
+                            gibbs_read_count_samples->back().path_ids = collapsed_path_subset;
+                            gibbs_read_count_samples->back().samples = vector<vector<double> >(cur_path_cluster_estimates->abundances.cols(), vector<double>());
+
+                            for (uint32_t l = 0; l < collapsed_path_subset_samples.at(k).second->second; ++l) {
+
+                                gibbsReadCountSampler(cur_path_cluster_estimates, subset_read_path_probs_buffer.read_path_probs.topLeftCorner(num_gibbs_reads, subset_read_path_probs.cols()), subset_read_path_probs_buffer.read_counts.head(num_gibbs_reads), total_subset_read_counts, abundance_gibbs_gamma, &subset_mt_rng);
+                            }
+                        }
+
+                        cur_path_cluster_estimates->abundances *= total_subset_read_counts;
+                    }
+                }
             }
         }
 
-        subset_path_cluster_estimates.abundances *= total_subset_read_counts;
-        updateEstimates(path_cluster_estimates, subset_path_cluster_estimates, collapsed_path_subset, path_subset.second);
+        #pragma omp taskwait
+    }
+
+    for (auto & cur_path_cluster_estimates: subset_path_cluster_estimates) {
+
+        if (cur_path_cluster_estimates.abundances.cols() == 0) {
+
+            path_cluster_estimates->initEstimates(path_cluster_estimates->paths.size(), 0, true);
+            return;
+        }
+    }
+
+    // Add the subset estimates in a fixed order.
+    for (size_t i = 0; i < subset_path_cluster_estimates.size(); ++i) {
+
+        updateEstimates(path_cluster_estimates, subset_path_cluster_estimates.at(i), collapsed_path_subset_samples.at(i).first, collapsed_path_subset_samples.at(i).second->second);
     }
 
     assert(path_cluster_estimates->posteriors.empty());
@@ -731,3 +1106,148 @@ void NestedPathAbundanceEstimator::inferPathSubsetAbundance(PathClusterEstimates
     }
 }
 
+void NestedPathAbundanceEstimator::initNearestSubsetEMAbundances(Utils::RowVectorXd * abundances, const ProbabilityMatrixView & read_path_probs, const vector<uint32_t> & path_subset, const vector<vector<uint32_t> > & prev_path_subsets, const vector<Utils::RowVectorXd> & prev_abundances) const {
+
+    assert(!path_subset.empty());
+    assert(read_path_probs.cols() == path_subset.size());
+    assert(prev_path_subsets.size() == prev_abundances.size());
+
+    *abundances = Utils::RowVectorXd::Constant(1, path_subset.size(), 1 / static_cast<double>(path_subset.size()));
+
+    // Find the previous subset with the fewest differing paths.
+    int32_t nearest_subset_idx = -1;
+    uint32_t nearest_subset_dist = numeric_limits<uint32_t>::max();
+
+    for (size_t i = 0; i < prev_path_subsets.size(); ++i) {
+
+        auto & prev_path_subset = prev_path_subsets.at(i);
+
+        uint32_t num_shared_paths = 0;
+
+        auto path_subset_it = path_subset.begin();
+        auto prev_path_subset_it = prev_path_subset.begin();
+
+        while (path_subset_it != path_subset.end() && prev_path_subset_it != prev_path_subset.end()) {
+
+            if (*path_subset_it < *prev_path_subset_it) {
+
+                ++path_subset_it;
+
+            } else if (*prev_path_subset_it < *path_subset_it) {
+
+                ++prev_path_subset_it;
+
+            } else {
+
+                ++num_shared_paths;
+
+                ++path_subset_it;
+                ++prev_path_subset_it;
+            }
+        }
+
+        const uint32_t subset_dist = path_subset.size() + prev_path_subset.size() - 2 * num_shared_paths;
+
+        if (num_shared_paths > 0 && subset_dist < nearest_subset_dist) {
+
+            nearest_subset_idx = i;
+            nearest_subset_dist = subset_dist;
+
+            if (nearest_subset_dist <= 1) {
+
+                break;
+            }
+        }
+    }
+
+    if (nearest_subset_idx < 0) {
+
+        return;
+    }
+
+    auto & nearest_path_subset = prev_path_subsets.at(nearest_subset_idx);
+    auto & nearest_abundances = prev_abundances.at(nearest_subset_idx);
+
+    assert(nearest_abundances.cols() == nearest_path_subset.size());
+
+    const double nearest_abundances_sum = nearest_abundances.sum();
+
+    if (nearest_abundances_sum <= 0) {
+
+        return;
+    }
+
+    // Paths not in the nearest subset keep the uniform start. Paths with a
+    // low abundance are raised to a minimum, since zero abundances remain
+    // zero during EM.
+    const double min_warm_abundance = em_warm_start_min_rel_abundance / path_subset.size();
+
+    uint32_t nearest_idx = 0;
+
+    for (size_t i = 0; i < path_subset.size(); ++i) {
+
+        while (nearest_idx < nearest_path_subset.size() && nearest_path_subset.at(nearest_idx) < path_subset.at(i)) {
+
+            ++nearest_idx;
+        }
+
+        if (nearest_idx < nearest_path_subset.size() && nearest_path_subset.at(nearest_idx) == path_subset.at(i)) {
+
+            (*abundances)(0, i) = max(nearest_abundances(0, nearest_idx) / nearest_abundances_sum, min_warm_abundance);
+        }
+    }
+
+    // EM keeps the ratio between the abundances of paths with identical read
+    // probabilities. These are therefore given their mean abundance, which
+    // splits them evenly as the uniform start does.
+    vector<uint32_t> path_indices(path_subset.size());
+    iota(path_indices.begin(), path_indices.end(), 0);
+
+    sort(path_indices.begin(), path_indices.end(), [&](const uint32_t lhs, const uint32_t rhs) {
+
+        for (uint32_t i = 0; i < read_path_probs.rows(); ++i) {
+
+            if (read_path_probs(i, lhs) != read_path_probs(i, rhs)) {
+
+                return (read_path_probs(i, lhs) < read_path_probs(i, rhs));
+            }
+        }
+
+        return (lhs < rhs);
+    });
+
+    uint32_t identical_start_idx = 0;
+
+    for (size_t i = 1; i <= path_indices.size(); ++i) {
+
+        bool is_identical = (i < path_indices.size());
+
+        for (uint32_t j = 0; j < read_path_probs.rows() && is_identical; ++j) {
+
+            is_identical = (read_path_probs(j, path_indices.at(i)) == read_path_probs(j, path_indices.at(identical_start_idx)));
+        }
+
+        if (!is_identical) {
+
+            if (i - identical_start_idx > 1) {
+
+                double identical_abundance_sum = 0;
+
+                for (size_t j = identical_start_idx; j < i; ++j) {
+
+                    identical_abundance_sum += (*abundances)(0, path_indices.at(j));
+                }
+
+                for (size_t j = identical_start_idx; j < i; ++j) {
+
+                    (*abundances)(0, path_indices.at(j)) = identical_abundance_sum / (i - identical_start_idx);
+                }
+            }
+
+            identical_start_idx = i;
+        }
+    }
+
+    *abundances /= abundances->sum();
+}
+
@@ -9,7 +9,9 @@
 
 #include "path_estimator.hpp"
 #include "path_cluster_estimates.hpp"
+#include "probability_matrix_view.hpp"
 #include "read_path_probabilities.hpp"
+#include "multinomial_sampler.hpp"
 #include "utils.hpp"
 
 using namespace std;
@@ -19,10 +21,11 @@ class PathAbundanceEstimator : public PathEstimator {
 
     public:
 
-        PathAbundanceEstimator(const uint32_t max_em_its_in, const double max_rel_em_conv_in, const uint32_t num_gibbs_samples_in, const uint32_t gibbs_thin_its_in, const double prob_precision);
+        PathAbundanceEstimator(const uint32_t max_em_its_in, const double max_rel_em_conv_in, const uint32_t num_gibbs_samples_in, const uint32_t gibbs_thin_its_in, const uint32_t num_gibbs_chains_in, const double prob_precision);
         virtual ~PathAbundanceEstimator() {};
 
         void estimate(PathClusterEstimates * path_cluster_estimates, const vector<ReadPathProbabilities> & cluster_probs, mt19937 * mt_rng);
+        void estimateBatch(const vector<PathClusterEstimates *> & path_cluster_estimates, const vector<const vector<ReadPathProbabilities> *> & cluster_probs, const vector<mt19937 *> & mt_rngs);
 
     protected: 
 
@@ -31,9 +34,16 @@ class PathAbundanceEstimator : public PathEstimator {
 
         const uint32_t num_gibbs_samples;
         const uint32_t gibbs_thin_its;
+        const uint32_t num_gibbs_chains;
 
-        void EMAbundanceEstimator(PathClusterEstimates * path_cluster_estimates, const Utils::ColMatrixXd & read_path_probs, const Utils::RowVectorXd & read_counts, const double total_read_count) const;
-        void gibbsReadCountSampler(PathClusterEstimates * path_cluster_estimates, const Utils::ColMatrixXd & read_path_probs, const Utils::RowVectorXd & read_counts, const double total_read_count, const double gamma, mt19937 * mt_rng) const;
+        void EMAbundanceEstimator(PathClusterEstimates * path_cluster_estimates, const ProbabilityMatrixView & read_path_probs, const double total_read_count, ProbabilityMatrixBuffer * read_path_probs_buffer) const;
+        void EMAbundanceEstimatorBatch(const vector<PathClusterEstimates *> & path_cluster_estimates, const Utils::ColMatrixXd & read_path_probs, const Utils::RowVectorXd & read_counts, const vector<uint32_t> & row_offsets, const vector<double> & total_read_counts) const;
+
+        bool hasEMConverged(const Utils::RowVectorXd & abundances, const Utils::RowVectorXd & prev_abundances) const;
+        void removeLowEMAbundances(Utils::RowVectorXd * abundances) const;
+
+        void gibbsReadCountSampler(PathClusterEstimates * path_cluster_estimates, const Eigen::Ref<const Utils::ColMatrixXd> & read_path_probs, const Eigen::Ref<const Utils::RowVectorXd> & read_counts, const double total_read_count, const double gamma, mt19937 * mt_rng) const;
+        void gibbsReadCountChain(vector<vector<double> > * chain_read_count_samples, const Utils::RowVectorXd & init_abundances, const Eigen::Ref<const Utils::ColMatrixXd> & read_path_probs, const Eigen::Ref<const Utils::RowVectorXd> & read_counts, const double total_read_count, const double gamma, const uint32_t num_chain_samples, Xoshiro256StarStar * rng) const;
         void updateEstimates(PathClusterEstimates * path_cluster_estimates, const PathClusterEstimates & new_path_cluster_estimates, const vector<uint32_t> & path_indices, const uint32_t sample_count) const;
 };
 
@@ -41,10 +51,11 @@ class MinimumPathAbundanceEstimator : public PathAbundanceEstimator {
 
     public:
 
-        MinimumPathAbundanceEstimator(const uint32_t max_em_its, const double max_rel_em_conv, const uint32_t num_gibbs_samples, const uint32_t gibbs_thin_its, const double prob_precision);
+        MinimumPathAbundanceEstimator(const uint32_t max_em_its, const double max_rel_em_conv, const uint32_t num_gibbs_samples, const uint32_t gibbs_thin_its, const uint32_t num_gibbs_chains, const double prob_precision);
         ~MinimumPathAbundanceEstimator() {};
 
         void estimate(PathClusterEstimates * path_cluster_estimates, const vector<ReadPathProbabilities> & cluster_probs, mt19937 * mt_rng);
+        void estimateBatch(const vector<PathClusterEstimates *> & path_cluster_estimates, const vector<const vector<ReadPathProbabilities> *> & cluster_probs, const vector<mt19937 *> & mt_rngs);
 
         vector<uint32_t> weightedMinimumPathCover(const Utils::ColMatrixXb & read_path_cover, const Utils::RowVectorXd & read_counts, const Utils::RowVectorXd & path_weights) const;
 };
@@ -53,10 +64,11 @@ class NestedPathAbundanceEstimator : public PathAbundanceEstimator {
 
     public:
 
-        NestedPathAbundanceEstimator(const uint32_t group_size_in, const uint32_t num_subset_samples_in, const bool infer_collapsed_in, const bool use_group_post_gibbs_in, const uint32_t max_em_its, const double max_rel_em_conv, const uint32_t num_gibbs_samples, const uint32_t gibbs_thin_its, const double prob_precision);
+        NestedPathAbundanceEstimator(const uint32_t group_size_in, const uint32_t num_subset_samples_in, const bool infer_collapsed_in, const bool use_group_post_gibbs_in, const uint32_t max_em_its, const double max_rel_em_conv, const uint32_t num_gibbs_samples, const uint32_t gibbs_thin_its, const uint32_t num_gibbs_chains, const double prob_precision);
         ~NestedPathAbundanceEstimator() {};
 
         void estimate(PathClusterEstimates * path_cluster_estimates, const vector<ReadPathProbabilities> & cluster_probs, mt19937 * mt_rng);
+        void estimateBatch(const vector<PathClusterEstimates *> & path_cluster_estimates, const vector<const vector<ReadPathProbabilities> *> & cluster_probs, const vector<mt19937 *> & mt_rngs);
 
     private:
 
@@ -76,6 +88,10 @@ class NestedPathAbundanceEstimator : public PathAbundanceEstimator {
         void samplePathSubsetIndices(spp::sparse_hash_map<vector<uint32_t>, uint32_t> * path_subset_samples, const PathClusterEstimates & group_path_cluster_estimates, const vector<vector<uint32_t> > & path_groups, mt19937 * mt_rng) const;
 
         void inferPathSubsetAbundance(PathClusterEstimates * path_cluster_estimates, const vector<ReadPathProbabilities> & cluster_probs, mt19937 * mt_rng, const spp::sparse_hash_map<vector<uint32_t>, uint32_t> & path_subset_samples) const;
+
+    protected:
+
+        void initNearestSubsetEMAbundances(Utils::RowVectorXd * abundances, const ProbabilityMatrixView & read_path_probs, const vector<uint32_t> & path_subset, const vector<vector<uint32_t> > & prev_path_subsets, const vector<Utils::RowVectorXd> & prev_abundances) const;
 };
 
  
@@ -30,6 +30,42 @@ struct PathInfo {
         length = 0;
         effective_length = 0;
     }
+
+    void serialize(ostream * out_stream) const {
+
+        Utils::writeBinaryString(out_stream, name);
+        Utils::writeBinary<uint32_t>(out_stream, group_id);
+        Utils::writeBinary<uint32_t>(out_stream, source_count);
+        Utils::writeBinary<uint32_t>(out_stream, source_ids.size());
+
+        for (auto & source_id: source_ids) {
+
+            Utils::writeBinary<uint32_t>(out_stream, source_id);
+        }
+
+        Utils::writeBinary<uint32_t>(out_stream, length);
+        Utils::writeBinary<double>(out_stream, effective_length);
+    }
+
+    void deserialize(istream * in_stream) {
+
+        name = Utils::readBinaryString(in_stream);
+        group_id = Utils::readBinary<uint32_t>(in_stream);
+        source_count = Utils::readBinary<uint32_t>(in_stream);
+
+        const uint32_t num_source_ids = Utils::readBinary<uint32_t>(in_stream);
+
+        source_ids.clear();
+        source_ids.reserve(num_source_ids);
+
+        for (uint32_t i = 0; i < num_source_ids; ++i) {
+
+            source_ids.emplace(Utils::readBinary<uint32_t>(in_stream));
+        }
+
+        length = Utils::readBinary<uint32_t>(in_stream);
+        effective_length = Utils::readBinary<double>(in_stream);
+    }
 };
 
 struct CountSamples {
@@ -101,6 +137,61 @@ struct PathClusterEstimates {
             abundances = Eigen::RowVectorXd::Constant(1, num_components, 1 / static_cast<float>(num_components));
         }
     }
+
+    // Only stores the path information used by the estimates writers 
+    // (name and lengths). Gibbs samples are not stored.
+    void serializeEstimates(ostream * out_stream) const {
+
+        assert(posteriors.size() == path_group_sets.size());
+        Utils::writeBinary<uint32_t>(out_stream, paths.size());
+
+        for (auto & path: paths) {
+
+            Utils::writeBinaryString(out_stream, path.name);
+            Utils::writeBinary<uint32_t>(out_stream, path.length);
+            Utils::writeBinary<double>(out_stream, path.effective_length);
+        }
+
+        Utils::writeBinary<uint32_t>(out_stream, posteriors.size());
+        out_stream->write(reinterpret_cast<const char *>(posteriors.data()), posteriors.size() * sizeof(double));
+
+        for (auto & path_group_set: path_group_sets) {
+
+            Utils::writeBinary<uint32_t>(out_stream, path_group_set.size());
+            out_stream->write(reinterpret_cast<const char *>(path_group_set.data()), path_group_set.size() * sizeof(uint32_t));
+        }
+
+        Utils::writeBinary<uint32_t>(out_stream, abundances.cols());
+        out_stream->write(reinterpret_cast<const char *>(abundances.data()), abundances.cols() * sizeof(double));
+    }
+
+    void deserializeEstimates(istream * in_stream) {
+
+        paths = vector<PathInfo>(Utils::readBinary<uint32_t>(in_stream), PathInfo(""));
+
+        for (auto & path: paths) {
+
+            path.name = Utils::readBinaryString(in_stream);
+            path.length = Utils::readBinary<uint32_t>(in_stream);
+            path.effective_length = Utils::readBinary<double>(in_stream);
+        }
+
+        posteriors = vector<double>(Utils::readBinary<uint32_t>(in_stream));
+        in_stream->read(reinterpret_cast<char *>(posteriors.data()), posteriors.size() * sizeof(double));
+
+        path_group_sets = vector<vector<uint32_t> >(posteriors.size());
+
+        for (auto & path_group_set: path_group_sets) {
+
+            path_group_set = vector<uint32_t>(Utils::readBinary<uint32_t>(in_stream));
+            in_stream->read(reinterpret_cast<char *>(path_group_set.data()), path_group_set.size() * sizeof(uint32_t));
+        }
+
+        abundances = Eigen::RowVectorXd(1, Utils::readBinary<uint32_t>(in_stream));
+        in_stream->read(reinterpret_cast<char *>(abundances.data()), abundances.cols() * sizeof(double));
+
+        gibbs_read_count_samples.clear();
+    }
 };
 
 
@@ -1,6 +1,12 @@
 
 #include "path_estimator.hpp"
 
+#include <queue>
+
+#include "multinomial_sampler.hpp"
+#include "path_group_likelihood_kernel.hpp"
+#include "sharded_cache.hpp"
+
 static const uint32_t min_gibbs_chains = 10;
 static const double gibbs_chain_scaling = 0.01;
 
@@ -10,6 +16,14 @@ static const double burn_it_scaling = 0.025;
 static const uint32_t min_gibbs_it = 100; 
 static const double gibbs_it_scaling = 0.05; 
 
+static const uint32_t path_group_chunk_size = 4096;
+static const uint32_t path_group_task_size = 256;
+
+static const uint32_t gibbs_cache_num_shards = 16;
+static const uint32_t gibbs_cache_max_probs = 4194304;
+
+static const uint32_t path_group_bound_it = 2;
+
 bool probabilityCountRowSorter(const pair<Utils::RowVectorXd, double> & lhs, const pair<Utils::RowVectorXd, double> & rhs) { 
 
     assert(lhs.first.cols() == rhs.first.cols());
@@ -50,8 +64,46 @@ bool probabilityCountColSorter(const pair<Utils::ColVectorXd, uint32_t> & lhs, c
     return false;
 }
 
+// Advances to the next path group (multiset of path indices sorted in
+// non-decreasing order) in lexicographic order. Returns false if the
+// group is the last one.
+bool nextPathGroup(vector<uint32_t> * path_group, const uint32_t num_paths) {
+
+    int32_t idx = path_group->size() - 1;
+
+    while (idx >= 0 && path_group->at(idx) + 1 == num_paths) {
+
+        --idx;
+    }
+
+    if (idx < 0) {
+
+        return false;
+    }
+
+    path_group->at(idx)++;
+
+    for (size_t i = idx + 1; i < path_group->size(); ++i) {
+
+        path_group->at(i) = path_group->at(idx);
+    }
+
+    return true;
+}
+
 PathEstimator::PathEstimator(const double prob_precision_in) : prob_precision(prob_precision_in) {}
 
+void PathEstimator::estimateBatch(const vector<PathClusterEstimates *> & path_cluster_estimates, const vector<const vector<ReadPathProbabilities> *> & cluster_probs, const vector<mt19937 *> & mt_rngs) {
+
+    assert(path_cluster_estimates.size() == cluster_probs.size());
+    assert(path_cluster_estimates.size() == mt_rngs.size());
+
+    for (size_t i = 0; i < path_cluster_estimates.size(); ++i) {
+
+        estimate(path_cluster_estimates.at(i), *(cluster_probs.at(i)), mt_rngs.at(i));
+    }
+}
+
 void PathEstimator::constructProbabilityMatrix(Utils::ColMatrixXd * read_path_probs, Utils::ColVectorXd * noise_probs, Utils::RowVectorXd * read_counts, const vector<ReadPathProbabilities> & cluster_probs, const uint32_t num_paths) const {
 
     assert(!cluster_probs.empty());
@@ -131,6 +183,21 @@ void PathEstimator::constructPartialProbabilityMatrix(Utils::ColMatrixXd * read_
     }
 }
 
+// Normalizes the probabilities of each read and merges identical reads of
+// a view that has already been gathered into the buffer. The reads are
+// collapsed in place and the number of remaining reads is returned.
+uint32_t PathEstimator::constructCollapsedProbabilityMatrix(ProbabilityMatrixBuffer * read_path_probs_buffer, const ProbabilityMatrixView & read_path_probs_view) const {
+
+    assert(read_path_probs_view.rows() > 0);
+
+    auto read_path_probs = read_path_probs_buffer->read_path_probs.topLeftCorner(read_path_probs_view.rows(), read_path_probs_view.cols());
+    auto read_counts = read_path_probs_buffer->read_counts.head(read_path_probs_view.rows());
+
+    read_path_probs = read_path_probs.array().colwise() / read_path_probs.rowwise().sum().array();
+
+    return readCollapseProbabilityBlock(read_path_probs, read_counts);
+}
+
 void PathEstimator::constructGroupedProbabilityMatrix(Utils::ColMatrixXd * read_path_probs, Utils::ColVectorXd * noise_probs, Utils::RowVectorXd * read_counts, const vector<ReadPathProbabilities> & cluster_probs, const vector<vector<uint32_t> > & path_groups, const uint32_t num_paths) const {
 
     assert(!cluster_probs.empty());
@@ -172,6 +239,60 @@ void PathEstimator::constructGroupedProbabilityMatrix(Utils::ColMatrixXd * read_
     }
 }
 
+// Returns true if all reads, excluding reads that are noise, have the same
+// non-zero probability for all paths in a single set of paths and a zero
+// probability for the remaining paths. The set of paths and the read count
+// without noise are returned.
+bool PathEstimator::isTrivialCluster(vector<uint32_t> * path_ids, double * read_count, const vector<ReadPathProbabilities> & cluster_probs) const {
+
+    path_ids->clear();
+    *read_count = 0;
+
+    bool has_path_ids = false;
+
+    for (auto & cluster_prob: cluster_probs) {
+
+        if (Utils::doubleCompare(cluster_prob.noiseProb(), 1)) {
+
+            continue;
+        }
+
+        const vector<uint32_t> * read_path_ids = nullptr;
+
+        for (auto & path_probs: cluster_prob.pathProbs()) {
+
+            if (path_probs.first > 0) {
+
+                if (read_path_ids) {
+
+                    return false;
+                }
+
+                read_path_ids = &(path_probs.second);
+            }
+        }
+
+        if (!read_path_ids) {
+
+            return false;
+        }
+
+        if (!has_path_ids) {
+
+            *path_ids = *read_path_ids;
+            has_path_ids = true;
+
+        } else if (*path_ids != *read_path_ids) {
+
+            return false;
+        }
+
+        *read_count += cluster_prob.readCount() * (1 - cluster_prob.noiseProb());
+    }
+
+    return has_path_ids;
+}
+
 void PathEstimator::addNoiseAndNormalizeProbabilityMatrix(Utils::ColMatrixXd * read_path_probs, const Utils::ColVectorXd & noise_probs) const {
 
     assert(read_path_probs->rows() == noise_probs.rows());
@@ -213,44 +334,54 @@ void PathEstimator::detractNoiseAndNormalizeProbabilityMatrix(Utils::ColMatrixXd
     }
 }
 
-void PathEstimator::rowSortProbabilityMatrix(Utils::ColMatrixXd * read_path_probs, Utils::RowVectorXd * read_counts) const {
+void PathEstimator::rowSortProbabilityMatrix(Eigen::Ref<Utils::ColMatrixXd> read_path_probs, Eigen::Ref<Utils::RowVectorXd> read_counts) const {
 
-    assert(read_path_probs->rows() > 0);
-    assert(read_path_probs->rows() == read_counts->cols());
+    assert(read_path_probs.rows() > 0);
+    assert(read_path_probs.rows() == read_counts.cols());
 
     vector<pair<Utils::RowVectorXd, double> > read_path_prob_rows;
-    read_path_prob_rows.reserve(read_path_probs->rows());
+    read_path_prob_rows.reserve(read_path_probs.rows());
 
-    for (size_t i = 0; i < read_path_probs->rows(); ++i) {
+    for (size_t i = 0; i < read_path_probs.rows(); ++i) {
 
-        read_path_prob_rows.emplace_back(read_path_probs->row(i), (*read_counts)(0, i));
+        read_path_prob_rows.emplace_back(read_path_probs.row(i), read_counts(0, i));
     }
 
     sort(read_path_prob_rows.begin(), read_path_prob_rows.end(), probabilityCountRowSorter);
 
-    for (size_t i = 0; i < read_path_probs->rows(); ++i) {
+    for (size_t i = 0; i < read_path_probs.rows(); ++i) {
     
-        read_path_probs->row(i) = read_path_prob_rows.at(i).first;
-        (*read_counts)(0, i) = read_path_prob_rows.at(i).second;
+        read_path_probs.row(i) = read_path_prob_rows.at(i).first;
+        read_counts(0, i) = read_path_prob_rows.at(i).second;
     }    
 }
 
 void PathEstimator::readCollapseProbabilityMatrix(Utils::ColMatrixXd * read_path_probs, Utils::RowVectorXd * read_counts) const {
 
-    assert(read_path_probs->rows() > 0);
-    assert(read_path_probs->rows() == read_counts->cols());
+    const uint32_t num_unique_rows = readCollapseProbabilityBlock(*read_path_probs, *read_counts);
+
+    read_path_probs->conservativeResize(num_unique_rows, read_path_probs->cols());
+    read_counts->conservativeResize(read_counts->rows(), num_unique_rows);
+}
+
+// Merges identical reads into the leading rows of the block and returns the
+// number of unique reads.
+uint32_t PathEstimator::readCollapseProbabilityBlock(Eigen::Ref<Utils::ColMatrixXd> read_path_probs, Eigen::Ref<Utils::RowVectorXd> read_counts) const {
+
+    assert(read_path_probs.rows() > 0);
+    assert(read_path_probs.rows() == read_counts.cols());
 
     rowSortProbabilityMatrix(read_path_probs, read_counts);
 
     uint32_t prev_unique_probs_row = 0;
 
-    for (size_t i = 1; i < read_path_probs->rows(); ++i) {
+    for (size_t i = 1; i < read_path_probs.rows(); ++i) {
 
         bool is_identical = true;
 
-        for (size_t j = 0; j < read_path_probs->cols(); ++j) {
+        for (size_t j = 0; j < read_path_probs.cols(); ++j) {
 
-            if (abs((*read_path_probs)(prev_unique_probs_row, j) - (*read_path_probs)(i, j)) >= prob_precision) {
+            if (abs(read_path_probs(prev_unique_probs_row, j) - read_path_probs(i, j)) >= prob_precision) {
 
                 is_identical = false;
                 break;
@@ -259,22 +390,21 @@ void PathEstimator::readCollapseProbabilityMatrix(Utils::ColMatrixXd * read_path
 
         if (is_identical) {
 
-            read_counts->col(prev_unique_probs_row) += read_counts->col(i);
+            read_counts.col(prev_unique_probs_row) += read_counts.col(i);
 
         } else {
 
             if (prev_unique_probs_row + 1 < i) {
 
-                read_path_probs->row(prev_unique_probs_row + 1) = read_path_probs->row(i);
-                read_counts->col(prev_unique_probs_row + 1) = read_counts->col(i);
+                read_path_probs.row(prev_unique_probs_row + 1) = read_path_probs.row(i);
+                read_counts.col(prev_unique_probs_row + 1) = read_counts.col(i);
             }
 
             prev_unique_probs_row++;
         }
     }
 
-    read_path_probs->conservativeResize(prev_unique_probs_row + 1, read_path_probs->cols());
-    read_counts->conservativeResize(read_counts->rows(), prev_unique_probs_row + 1);
+    return prev_unique_probs_row + 1;
 }
 
 void PathEstimator::colSortProbabilityMatrix(Utils::ColMatrixXd * read_path_probs) const {
@@ -359,40 +489,108 @@ void PathEstimator::calculatePathGroupPosteriorsFull(PathClusterEstimates * path
     auto path_log_freqs = calcPathLogFrequences(path_counts);
     assert(path_log_freqs.size() == path_counts.size());
 
-    path_cluster_estimates->initEstimates(read_path_probs.cols(), group_size, true);
+    path_cluster_estimates->initEstimates(0, 0, true);
 
-    assert(path_cluster_estimates->posteriors.size() > 0);
+    assert(path_cluster_estimates->posteriors.size() == 0);
     assert(path_cluster_estimates->posteriors.size() == path_cluster_estimates->path_group_sets.size());
 
-    double sum_log_posterior = numeric_limits<double>::lowest();
+    // Posteriors of single paths are indexed by path and are therefore
+    // all kept. For larger groups only groups with a posterior of at least
+    // prob_precision are kept.
+    const bool keep_all_groups = (group_size == 1);
+    const double min_log_posterior_diff = log(prob_precision);
+
+    const PathGroupLikelihoodKernel likelihood_kernel(read_path_probs, noise_probs, read_counts, group_size);
+
+    vector<uint32_t> cur_path_group(group_size, 0);
+    bool has_path_group = true;
+
+    vector<uint32_t> chunk_path_groups;
+    chunk_path_groups.reserve(path_group_chunk_size * group_size);
+
+    vector<double> chunk_log_likelihoods;
+    chunk_log_likelihoods.reserve(path_group_chunk_size);
+
+    vector<double> log_likelihoods;
 
-    for (uint32_t i = 0; i < path_cluster_estimates->path_group_sets.size(); ++i) {
+    double sum_log_posterior = numeric_limits<double>::lowest();
+    double max_log_likelihood = numeric_limits<double>::lowest();
 
-        assert(path_cluster_estimates->path_group_sets.at(i).size() == group_size);
+    while (has_path_group) {
 
-        Utils::ColVectorXd group_read_probs = noise_probs;
+        chunk_path_groups.clear();
 
-        for (auto & path_idx: path_cluster_estimates->path_group_sets.at(i)) {
+        while (has_path_group && chunk_path_groups.size() < path_group_chunk_size * group_size) {
 
-            group_read_probs += (read_path_probs.col(path_idx) / static_cast<double>(group_size));
+            chunk_path_groups.insert(chunk_path_groups.end(), cur_path_group.begin(), cur_path_group.end());
+            has_path_group = nextPathGroup(&cur_path_group, read_path_probs.cols());
         }
 
-        path_cluster_estimates->posteriors.at(i) = read_counts * group_read_probs.array().log().matrix();
+        const uint32_t num_chunk_path_groups = chunk_path_groups.size() / group_size;
+        chunk_log_likelihoods.resize(num_chunk_path_groups);
+
+        for (uint32_t i = 0; i < num_chunk_path_groups; i += path_group_task_size) {
+
+            #pragma omp task default(shared) firstprivate(i)
+            {
+                // Groups are enumerated in order and consecutive groups
+                // therefore mostly share all but the last path.
+                PathGroupPrefixCache prefix_cache;
+
+                for (uint32_t j = i; j < min(i + path_group_task_size, num_chunk_path_groups); ++j) {
+
+                    const vector<uint32_t> path_group(chunk_path_groups.begin() + j * group_size, chunk_path_groups.begin() + (j + 1) * group_size);
+                    chunk_log_likelihoods.at(j) = likelihood_kernel.logLikelihood(path_group, &prefix_cache);
+
+                    for (auto & path_idx: path_group) {
+                        
+                        chunk_log_likelihoods.at(j) += path_log_freqs.at(path_idx);
+                    }
 
-        for (auto & path_idx: path_cluster_estimates->path_group_sets.at(i)) {
-            
-            path_cluster_estimates->posteriors.at(i) += path_log_freqs.at(path_idx);
+                    chunk_log_likelihoods.at(j) += log(Utils::numPermutations(path_group));
+                }
+            }
         }
 
-        path_cluster_estimates->posteriors.at(i) += log(Utils::numPermutations(path_cluster_estimates->path_group_sets.at(i)));
+        #pragma omp taskwait
+
+        // Reduce in enumeration order to keep the result independent of
+        // the number of threads.
+        for (uint32_t i = 0; i < num_chunk_path_groups; ++i) {
 
-        sum_log_posterior = Utils::add_log(sum_log_posterior, path_cluster_estimates->posteriors.at(i));
+            sum_log_posterior = Utils::add_log(sum_log_posterior, chunk_log_likelihoods.at(i));
+            max_log_likelihood = max(max_log_likelihood, chunk_log_likelihoods.at(i));
+
+            if (keep_all_groups || chunk_log_likelihoods.at(i) - max_log_likelihood >= min_log_posterior_diff) {
+
+                path_cluster_estimates->path_group_sets.emplace_back(chunk_path_groups.begin() + i * group_size, chunk_path_groups.begin() + (i + 1) * group_size);
+                log_likelihoods.emplace_back(chunk_log_likelihoods.at(i));
+            }
+        }
     }
 
-    for (size_t i = 0; i < path_cluster_estimates->posteriors.size(); ++i) {
+    assert(path_cluster_estimates->path_group_sets.size() == log_likelihoods.size());
+
+    uint32_t num_kept_path_groups = 0;
+
+    for (size_t i = 0; i < log_likelihoods.size(); ++i) {
+
+        const double posterior = exp(log_likelihoods.at(i) - sum_log_posterior);
+
+        if (keep_all_groups || posterior >= prob_precision) {
+
+            if (num_kept_path_groups < i) {
 
-        path_cluster_estimates->posteriors.at(i) = exp(path_cluster_estimates->posteriors.at(i) - sum_log_posterior);
+                path_cluster_estimates->path_group_sets.at(num_kept_path_groups) = move(path_cluster_estimates->path_group_sets.at(i));
+            }
+
+            path_cluster_estimates->posteriors.emplace_back(posterior);
+            ++num_kept_path_groups;
+        }
     }
+
+    path_cluster_estimates->path_group_sets.resize(num_kept_path_groups);
+    assert(path_cluster_estimates->posteriors.size() == path_cluster_estimates->path_group_sets.size());
 }
 
 void PathEstimator::calculatePathGroupPosteriorsBounded(PathClusterEstimates * path_cluster_estimates, const Utils::ColMatrixXd & read_path_probs, const Utils::ColVectorXd & noise_probs, const Utils::RowVectorXd & read_counts, const vector<uint32_t> & path_counts, const uint32_t group_size, const double min_rel_likelihood) const {
@@ -401,7 +599,7 @@ void PathEstimator::calculatePathGroupPosteriorsBounded(PathClusterEstimates * p
     assert(read_path_probs.rows() == noise_probs.rows());
     assert(read_path_probs.rows() == read_counts.cols());
     assert(read_path_probs.cols() == path_counts.size());
-    assert(group_size == 2);
+    assert(group_size > 0);
 
     const double min_log_likelihood_diff = log(min_rel_likelihood);
 
@@ -413,11 +611,12 @@ void PathEstimator::calculatePathGroupPosteriorsBounded(PathClusterEstimates * p
     assert(path_cluster_estimates->posteriors.size() == 0);
     assert(path_cluster_estimates->posteriors.size() == path_cluster_estimates->path_group_sets.size());
 
+    // Order paths by decreasing marginal posterior, which makes high
+    // likelihood groups be found early and tightens the bounds below.
     PathClusterEstimates marginal_path_cluster_estimates;
     calculatePathGroupPosteriorsFull(&marginal_path_cluster_estimates, read_path_probs, noise_probs, read_counts, path_counts, 1);
 
     assert(marginal_path_cluster_estimates.posteriors.size() == read_path_probs.cols());
-    assert(marginal_path_cluster_estimates.posteriors.size() == marginal_path_cluster_estimates.path_group_sets.size());
 
     vector<pair<double, uint32_t> > marginal_posteriors;
     marginal_posteriors.reserve(marginal_path_cluster_estimates.posteriors.size());
@@ -430,62 +629,214 @@ void PathEstimator::calculatePathGroupPosteriorsBounded(PathClusterEstimates * p
 
     sort(marginal_posteriors.rbegin(), marginal_posteriors.rend());
 
-    const Utils::ColVectorXd max_read_probs = (read_path_probs.rowwise().maxCoeff() / static_cast<double>(group_size));
+    // Upper bounds on the read probabilities contributed by a path at or
+    // after each position in the marginal order (groups are extended with
+    // paths in non-decreasing order) and on the number of permutations.
+    Utils::ColMatrixXd max_read_probs(read_path_probs.rows(), read_path_probs.cols());
+    max_read_probs.col(read_path_probs.cols() - 1) = read_path_probs.col(marginal_posteriors.back().second) / static_cast<double>(group_size);
 
-    vector<double> log_likelihoods;
+    for (int32_t i = read_path_probs.cols() - 2; i >= 0; --i) {
+
+        max_read_probs.col(i) = max_read_probs.col(i + 1).cwiseMax(read_path_probs.col(marginal_posteriors.at(i).second) / static_cast<double>(group_size));
+    }
 
-    double max_log_likelihood = numeric_limits<double>::lowest(); 
+    const double max_log_permutations = lgamma(group_size + 1);
 
-    for (uint32_t i = 0; i < marginal_posteriors.size(); ++i) {
+    // Partial groups (marginal order positions in non-decreasing order)
+    // ordered by an upper bound on the log-likelihood of the groups
+    // extending them.
+    priority_queue<pair<double, vector<uint32_t> > > partial_path_groups;
+    partial_path_groups.emplace(numeric_limits<double>::max(), vector<uint32_t>());
 
-        const uint32_t first_path_idx = marginal_posteriors.at(i).second;
+    vector<pair<vector<uint32_t>, double> > path_group_log_likelihoods;
 
-        Utils::ColVectorXd group_read_probs_base = noise_probs;
-        group_read_probs_base += (read_path_probs.col(first_path_idx) / static_cast<double>(group_size));
+    const PathGroupLikelihoodKernel likelihood_kernel(read_path_probs, noise_probs, read_counts, group_size);
+    PathGroupPrefixCache prefix_cache;
 
-        double optimal_log_likelihood = read_counts * (group_read_probs_base + max_read_probs).array().log().matrix();
-        optimal_log_likelihood += path_log_freqs.at(first_path_idx) + log(2);
+    Utils::ColVectorXd partial_group_read_probs;
+    Utils::ColVectorXd group_read_probs;
 
-        if (optimal_log_likelihood - max_log_likelihood < min_log_likelihood_diff) {
+    vector<uint32_t> path_group;
 
-            continue;
+    // Use the log-likelihood of a greedily constructed group as the initial
+    // lower bound on the maximum, which allows pruning from the start.
+    partial_group_read_probs = noise_probs;
+    double greedy_group_log_freq = 0;
+
+    for (uint32_t i = 0; i < group_size; ++i) {
+
+        double max_greedy_log_likelihood = numeric_limits<double>::lowest();
+        uint32_t max_greedy_path_idx = 0;
+
+        for (uint32_t j = 0; j < read_path_probs.cols(); ++j) {
+
+            group_read_probs = partial_group_read_probs + (read_path_probs.col(j) / static_cast<double>(group_size));
+            const double greedy_log_likelihood = read_counts * group_read_probs.array().log().matrix() + path_log_freqs.at(j);
+
+            if (greedy_log_likelihood > max_greedy_log_likelihood) {
+
+                max_greedy_log_likelihood = greedy_log_likelihood;
+                max_greedy_path_idx = j;
+            }
+        }
+
+        partial_group_read_probs += (read_path_probs.col(max_greedy_path_idx) / static_cast<double>(group_size));
+        greedy_group_log_freq += path_log_freqs.at(max_greedy_path_idx);
+
+        path_group.emplace_back(max_greedy_path_idx);
+    }
+
+    sort(path_group.begin(), path_group.end());
+
+    double max_log_likelihood = max(numeric_limits<double>::lowest(), read_counts * partial_group_read_probs.array().log().matrix() + greedy_group_log_freq + log(Utils::numPermutations(path_group)));
+
+    while (!partial_path_groups.empty()) {
+
+        // Remaining partial groups can not contain groups within the threshold.
+        if (partial_path_groups.top().first - max_log_likelihood < min_log_likelihood_diff) {
+
+            break;
+        }
+
+        vector<uint32_t> path_group_positions = partial_path_groups.top().second;
+        partial_path_groups.pop();
+
+        partial_group_read_probs = noise_probs;
+        double partial_group_log_freq = 0;
+
+        for (auto & position: path_group_positions) {
+
+            const uint32_t path_idx = marginal_posteriors.at(position).second;
+
+            partial_group_read_probs += (read_path_probs.col(path_idx) / static_cast<double>(group_size));
+            partial_group_log_freq += path_log_freqs.at(path_idx);
         }
 
-        for (uint32_t j = i; j < marginal_posteriors.size(); ++j) {
+        const uint32_t first_position = (path_group_positions.empty() ? 0 : path_group_positions.back());
 
-            const uint32_t second_path_idx = marginal_posteriors.at(j).second;
+        if (path_group_positions.size() + 1 < group_size) {
 
-            log_likelihoods.emplace_back(read_counts * (group_read_probs_base + (read_path_probs.col(second_path_idx) / static_cast<double>(group_size))).array().log().matrix());
-            log_likelihoods.back() += path_log_freqs.at(first_path_idx) + path_log_freqs.at(second_path_idx) + log(Utils::numPermutations(vector<uint32_t>({first_path_idx, second_path_idx})));
+            // Tighten the bound using the continuous relaxation, where the
+            // remaining paths are replaced by any mixture of the paths that
+            // can extend the group. The log-likelihood is concave in the
+            // mixture, so the Frank-Wolfe duality gap gives an upper bound
+            // on its maximum at every iteration.
+            const double remaining_frac = (group_size - path_group_positions.size()) / static_cast<double>(group_size);
+            const uint32_t num_extend_paths = read_path_probs.cols() - first_position;
 
-            if (log_likelihoods.back() - max_log_likelihood < min_log_likelihood_diff) {
+            Utils::ColVectorXd mixture_weights = Utils::ColVectorXd::Constant(num_extend_paths, remaining_frac / num_extend_paths);
+            double relaxed_log_likelihood_bound = numeric_limits<double>::max();
+
+            for (uint32_t i = 0; i < path_group_bound_it; ++i) {
+
+                group_read_probs = partial_group_read_probs;
+
+                for (uint32_t j = 0; j < num_extend_paths; ++j) {
+
+                    group_read_probs += read_path_probs.col(marginal_posteriors.at(first_position + j).second) * mixture_weights(j);
+                }
+
+                if (group_read_probs.minCoeff() <= 0) {
+
+                    break;
+                }
+
+                const double relaxed_log_likelihood = read_counts * group_read_probs.array().log().matrix();
+                const Utils::ColVectorXd read_weights = read_counts.transpose().cwiseQuotient(group_read_probs);
+
+                Utils::ColVectorXd mixture_gradient(num_extend_paths);
+
+                for (uint32_t j = 0; j < num_extend_paths; ++j) {
+
+                    mixture_gradient(j) = read_path_probs.col(marginal_posteriors.at(first_position + j).second).dot(read_weights);
+                }
+
+                uint32_t max_gradient_idx = 0;
+                const double max_gradient = mixture_gradient.maxCoeff(&max_gradient_idx);
+
+                relaxed_log_likelihood_bound = min(relaxed_log_likelihood_bound, relaxed_log_likelihood + max_gradient * remaining_frac - mixture_gradient.dot(mixture_weights));
+
+                const double step_size = 2 / static_cast<double>(i + 2);
+
+                mixture_weights *= (1 - step_size);
+                mixture_weights(max_gradient_idx) += step_size * remaining_frac;
+            }
+
+            if (partial_group_log_freq + relaxed_log_likelihood_bound + max_log_permutations - max_log_likelihood < min_log_likelihood_diff) {
 
-                log_likelihoods.pop_back();
                 continue;
             }
+        }
+
+        path_group_positions.emplace_back(0);
+
+        const bool is_complete = (path_group_positions.size() == group_size);
+
+        for (uint32_t i = first_position; i < read_path_probs.cols(); ++i) {
+
+            const uint32_t path_idx = marginal_posteriors.at(i).second;
+
+            path_group_positions.back() = i;
+
+            double log_likelihood = partial_group_log_freq + path_log_freqs.at(path_idx);
 
-            max_log_likelihood = max(max_log_likelihood, log_likelihoods.back());
-            path_cluster_estimates->path_group_sets.emplace_back(vector<uint32_t>({first_path_idx, second_path_idx}));
+            if (is_complete) {
+
+                path_group.clear();
+
+                for (auto & position: path_group_positions) {
+
+                    path_group.emplace_back(marginal_posteriors.at(position).second);
+                }
+
+                // The groups completing a partial group share their prefix.
+                log_likelihood += likelihood_kernel.logLikelihood(path_group, &prefix_cache);
+
+                sort(path_group.begin(), path_group.end());
+                log_likelihood += log(Utils::numPermutations(path_group));
+
+                if (log_likelihood - max_log_likelihood >= min_log_likelihood_diff) {
+
+                    max_log_likelihood = max(max_log_likelihood, log_likelihood);
+                    path_group_log_likelihoods.emplace_back(path_group, log_likelihood);
+                }
+
+            } else {
+
+                group_read_probs = partial_group_read_probs + (read_path_probs.col(path_idx) / static_cast<double>(group_size));
+
+                log_likelihood += read_counts * (group_read_probs + max_read_probs.col(i) * static_cast<double>(group_size - path_group_positions.size())).array().log().matrix();
+                log_likelihood += max_log_permutations;
+
+                if (log_likelihood - max_log_likelihood >= min_log_likelihood_diff) {
+
+                    partial_path_groups.emplace(log_likelihood, path_group_positions);
+                }
+            }
         }
     }
 
+    sort(path_group_log_likelihoods.begin(), path_group_log_likelihoods.end());
+
     double sum_log_posterior = numeric_limits<double>::lowest();
 
-    for (size_t i = 0; i < log_likelihoods.size(); ++i) {
+    for (auto & path_group_log_likelihood: path_group_log_likelihoods) {
 
-        if (log_likelihoods.at(i) - max_log_likelihood < min_log_likelihood_diff) {
+        if (path_group_log_likelihood.second - max_log_likelihood >= min_log_likelihood_diff) {
 
-            log_likelihoods.at(i) = numeric_limits<double>::lowest();
+            sum_log_posterior = Utils::add_log(sum_log_posterior, path_group_log_likelihood.second);
         }
-
-        sum_log_posterior = Utils::add_log(sum_log_posterior, log_likelihoods.at(i));        
     }
 
     assert(path_cluster_estimates->posteriors.empty());
 
-    for (auto & ll: log_likelihoods) {
+    for (auto & path_group_log_likelihood: path_group_log_likelihoods) {
+
+        if (path_group_log_likelihood.second - max_log_likelihood >= min_log_likelihood_diff) {
 
-        path_cluster_estimates->posteriors.emplace_back(exp(ll - sum_log_posterior));
+            path_cluster_estimates->path_group_sets.emplace_back(path_group_log_likelihood.first);
+            path_cluster_estimates->posteriors.emplace_back(exp(path_group_log_likelihood.second - sum_log_posterior));
+        }
     }
 
     assert(path_cluster_estimates->posteriors.size() == path_cluster_estimates->path_group_sets.size());
@@ -507,92 +858,131 @@ void PathEstimator::estimatePathGroupPosteriorsGibbs(PathClusterEstimates * path
     assert(path_cluster_estimates->posteriors.size() == 0);
     assert(path_cluster_estimates->posteriors.size() == path_cluster_estimates->path_group_sets.size());
 
-    uniform_int_distribution<uint32_t> init_path_sampler(0, path_log_freqs.size() - 1);
-
-    vector<uint32_t> cur_sampled_group_paths;
-    cur_sampled_group_paths.reserve(group_size);
-
-    spp::sparse_hash_map<vector<uint32_t>, discrete_distribution<uint32_t> > group_path_sampler_cache;
-    spp::sparse_hash_map<vector<uint32_t>, uint32_t> path_group_sets_indices;
-
-    vector<uint32_t> path_group_sample_counts;
+    const PathGroupLikelihoodKernel likelihood_kernel(read_path_probs, noise_probs, read_counts, group_size);
 
     const uint32_t num_gibbs_chains = min_gibbs_chains + round(gibbs_chain_scaling * group_size * path_log_freqs.size());
     const uint32_t num_burn_its = min_burn_it + round(burn_it_scaling * group_size * path_log_freqs.size());
     const uint32_t num_gibbs_its = min_gibbs_it + round(gibbs_it_scaling * group_size * path_log_freqs.size());
 
+    // Cumulative sampling probabilities of the path added to a group with
+    // one path removed (marked by the number of paths), shared between
+    // the chains.
+    ShardedCache<vector<uint32_t>, vector<double> > group_path_sampler_cache(gibbs_cache_num_shards, max(static_cast<uint32_t>(1), gibbs_cache_max_probs / static_cast<uint32_t>(read_path_probs.cols())));
+
+    const uint64_t chains_seed = Utils::deriveStreamSeed(mt_rng);
+
+    vector<vector<uint32_t> > chains_path_group_samples(num_gibbs_chains);
+
     for (uint32_t c = 0; c < num_gibbs_chains; ++c) {
 
-        cur_sampled_group_paths.clear();
+        #pragma omp task default(shared) firstprivate(c)
+        {
+            Xoshiro256StarStar chain_rng(Utils::streamSeed(chains_seed, c));
 
-        for (uint32_t i = 0; i < group_size; ++i) {
+            vector<uint32_t> * path_group_samples = &(chains_path_group_samples.at(c));
+            path_group_samples->reserve(num_gibbs_its * group_size);
 
-            cur_sampled_group_paths.emplace_back(init_path_sampler(*mt_rng));
-        }
+            vector<uint32_t> cur_sampled_group_paths;
+            cur_sampled_group_paths.reserve(group_size);
 
-        for (uint32_t i = 0; i < num_burn_its + num_gibbs_its; ++i) {
+            vector<uint32_t> new_cur_sampled_group_paths;
+            new_cur_sampled_group_paths.reserve(group_size);
 
-            for (uint32_t j = 0; j < group_size; ++j) {
+            PathGroupPrefixCache prefix_cache;
 
-                vector<uint32_t> new_cur_sampled_group_paths = cur_sampled_group_paths;
+            for (uint32_t i = 0; i < group_size; ++i) {
 
-                new_cur_sampled_group_paths.at(j) = read_path_probs.cols();
-                sort(new_cur_sampled_group_paths.begin(), new_cur_sampled_group_paths.end());
+                cur_sampled_group_paths.emplace_back(chain_rng() % read_path_probs.cols());
+            }
 
-                auto group_path_sampler_cache_it = group_path_sampler_cache.emplace(new_cur_sampled_group_paths, discrete_distribution<uint32_t>());
+            for (uint32_t i = 0; i < num_burn_its + num_gibbs_its; ++i) {
 
-                if (group_path_sampler_cache_it.second) {
+                for (uint32_t j = 0; j < group_size; ++j) {
 
-                    Utils::ColVectorXd group_read_probs = noise_probs;
+                    new_cur_sampled_group_paths = cur_sampled_group_paths;
 
-                    for (uint32_t k = 0; k < group_size; ++k) {
+                    new_cur_sampled_group_paths.at(j) = read_path_probs.cols();
+                    sort(new_cur_sampled_group_paths.begin(), new_cur_sampled_group_paths.end());
 
-                        if (j != k) {
+                    auto group_path_sampler = group_path_sampler_cache.find(new_cur_sampled_group_paths);
 
-                            group_read_probs += (read_path_probs.col(cur_sampled_group_paths.at(k)) / static_cast<double>(group_size));
-                        }
-                    }
+                    if (!group_path_sampler) {
 
-                    vector<double> group_probs;
-                    group_probs.reserve(read_path_probs.cols());
+                        // The remaining paths are sorted before the removed
+                        // path marker, which is replaced by each candidate
+                        // path. The remaining paths therefore form a shared
+                        // prefix, whose read probabilities are calculated from
+                        // scratch. This makes the sampling probabilities
+                        // independent of which chain adds them to the cache.
+                        assert(new_cur_sampled_group_paths.back() == read_path_probs.cols());
 
-                    double sum_log_group_probs = numeric_limits<double>::lowest();
+                        vector<double> group_probs;
+                        group_probs.reserve(read_path_probs.cols());
 
-                    for (uint32_t k = 0; k < read_path_probs.cols(); ++k) {
+                        double sum_log_group_probs = numeric_limits<double>::lowest();
 
-                        group_probs.emplace_back(read_counts * (group_read_probs + (read_path_probs.col(k) / static_cast<double>(group_size))).array().log().matrix());
-                        group_probs.back() += path_log_freqs.at(k);
+                        for (uint32_t k = 0; k < read_path_probs.cols(); ++k) {
 
-                        sum_log_group_probs = Utils::add_log(sum_log_group_probs, group_probs.back());
-                    }
+                            new_cur_sampled_group_paths.back() = k;
+
+                            group_probs.emplace_back(likelihood_kernel.logLikelihood(new_cur_sampled_group_paths, &prefix_cache));
+                            group_probs.back() += path_log_freqs.at(k);
+
+                            sum_log_group_probs = Utils::add_log(sum_log_group_probs, group_probs.back());
+                        }
+
+                        new_cur_sampled_group_paths.back() = read_path_probs.cols();
+
+                        double cumulative_prob = 0;
 
-                    for (auto & prob: group_probs) {
+                        for (auto & prob: group_probs) {
 
-                        prob = exp(prob - sum_log_group_probs);
+                            cumulative_prob += exp(prob - sum_log_group_probs);
+                            prob = cumulative_prob;
+                        }
+
+                        group_path_sampler = group_path_sampler_cache.insert(new_cur_sampled_group_paths, make_shared<const vector<double> >(move(group_probs)));
                     }
 
-                    group_path_sampler_cache_it.first->second = discrete_distribution<uint32_t>(group_probs.begin(), group_probs.end());
+                    assert(group_path_sampler->size() == read_path_probs.cols());
+
+                    const double sampled_prob = chain_rng.uniform() * group_path_sampler->back();
+                    cur_sampled_group_paths.at(j) = min(static_cast<uint32_t>(upper_bound(group_path_sampler->begin(), group_path_sampler->end(), sampled_prob) - group_path_sampler->begin()), static_cast<uint32_t>(read_path_probs.cols() - 1));
                 }
 
-                cur_sampled_group_paths.at(j) = group_path_sampler_cache_it.first->second(*mt_rng);
+                if (i >= num_burn_its) {
+
+                    path_group_samples->insert(path_group_samples->end(), cur_sampled_group_paths.begin(), cur_sampled_group_paths.end());
+                    sort(path_group_samples->end() - group_size, path_group_samples->end());
+                }
             }
+        }
+    }
 
-            if (i >= num_burn_its) {
+    #pragma omp taskwait
 
-                vector<uint32_t> cur_sampled_group_paths_sort = cur_sampled_group_paths;
-                sort(cur_sampled_group_paths_sort.begin(), cur_sampled_group_paths_sort.end());
+    spp::sparse_hash_map<vector<uint32_t>, uint32_t> path_group_sets_indices;
+    vector<uint32_t> path_group_sample_counts;
 
-                auto path_group_sets_indices_it = path_group_sets_indices.emplace(cur_sampled_group_paths_sort, path_cluster_estimates->path_group_sets.size());
+    // Count samples in chain order to keep the order of the groups
+    // independent of the number of threads.
+    for (auto & path_group_samples: chains_path_group_samples) {
 
-                if (path_group_sets_indices_it.second) {
+        assert(path_group_samples.size() == num_gibbs_its * group_size);
 
-                    path_cluster_estimates->path_group_sets.emplace_back(cur_sampled_group_paths_sort);
-                    path_group_sample_counts.emplace_back(1);
+        for (uint32_t i = 0; i < path_group_samples.size(); i += group_size) {
 
-                } else {
+            const vector<uint32_t> path_group(path_group_samples.begin() + i, path_group_samples.begin() + i + group_size);
+            auto path_group_sets_indices_it = path_group_sets_indices.emplace(path_group, path_cluster_estimates->path_group_sets.size());
 
-                    path_group_sample_counts.at(path_group_sets_indices_it.first->second)++;
-                }
+            if (path_group_sets_indices_it.second) {
+
+                path_cluster_estimates->path_group_sets.emplace_back(path_group);
+                path_group_sample_counts.emplace_back(1);
+
+            } else {
+
+                path_group_sample_counts.at(path_group_sets_indices_it.first->second)++;
             }
         }
     }
@@ -7,6 +7,7 @@
 #include <Eigen/Dense>
 
 #include "path_cluster_estimates.hpp"
+#include "probability_matrix_view.hpp"
 #include "read_path_probabilities.hpp"
 #include "utils.hpp"
 
@@ -22,14 +23,21 @@ class PathEstimator {
 
         virtual void estimate(PathClusterEstimates * path_cluster_estimates, const vector<ReadPathProbabilities> & cluster_probs, mt19937 * mt_rng) = 0;
 
+        // Estimates a batch of (small) clusters. Estimates each cluster
+        // independently unless overridden by a batched implementation.
+        virtual void estimateBatch(const vector<PathClusterEstimates *> & path_cluster_estimates, const vector<const vector<ReadPathProbabilities> *> & cluster_probs, const vector<mt19937 *> & mt_rngs);
+
     protected:
        
         const double prob_precision;
 
         void constructProbabilityMatrix(Utils::ColMatrixXd * read_path_probs, Utils::ColVectorXd * noise_probs, Utils::RowVectorXd * read_counts, const vector<ReadPathProbabilities> & cluster_probs, const uint32_t num_paths) const; 
         void constructPartialProbabilityMatrix(Utils::ColMatrixXd * read_path_probs, Utils::ColVectorXd * noise_probs, Utils::RowVectorXd * read_counts, const vector<ReadPathProbabilities> & cluster_probs, const vector<uint32_t> & path_ids, const uint32_t num_paths, const bool remove_zero_row) const;
+        uint32_t constructCollapsedProbabilityMatrix(ProbabilityMatrixBuffer * read_path_probs_buffer, const ProbabilityMatrixView & read_path_probs_view) const;
         void constructGroupedProbabilityMatrix(Utils::ColMatrixXd * read_path_probs, Utils::ColVectorXd * noise_probs, Utils::RowVectorXd * read_counts, const vector<ReadPathProbabilities> & cluster_probs, const vector<vector<uint32_t> > & path_groups, const uint32_t num_paths) const;
 
+        bool isTrivialCluster(vector<uint32_t> * path_ids, double * read_count, const vector<ReadPathProbabilities> & cluster_probs) const;
+
         void addNoiseAndNormalizeProbabilityMatrix(Utils::ColMatrixXd * read_path_probs, const Utils::ColVectorXd & noise_probs) const;
         void detractNoiseAndNormalizeProbabilityMatrix(Utils::ColMatrixXd * read_path_probs, Utils::ColVectorXd * noise_probs, Utils::RowVectorXd * read_counts) const;
 
@@ -42,7 +50,8 @@ class PathEstimator {
 
     private:
 
-        void rowSortProbabilityMatrix(Utils::ColMatrixXd * read_path_probs, Utils::RowVectorXd * read_counts) const;
+        uint32_t readCollapseProbabilityBlock(Eigen::Ref<Utils::ColMatrixXd> read_path_probs, Eigen::Ref<Utils::RowVectorXd> read_counts) const;
+        void rowSortProbabilityMatrix(Eigen::Ref<Utils::ColMatrixXd> read_path_probs, Eigen::Ref<Utils::RowVectorXd> read_counts) const;
         void colSortProbabilityMatrix(Utils::ColMatrixXd * read_path_probs) const;
 
         vector<double> calcPathLogFrequences(const vector<uint32_t> & path_counts) const;
@@ -0,0 +1,140 @@
+
+#include "path_group_likelihood_kernel.hpp"
+
+
+PathGroupLikelihoodKernel::PathGroupLikelihoodKernel(const Utils::ColMatrixXd & read_path_probs_in, const Utils::ColVectorXd & noise_probs_in, const Utils::RowVectorXd & read_counts_in, const uint32_t group_size_in) : read_path_probs(read_path_probs_in), noise_probs(noise_probs_in), read_counts(read_counts_in), group_size(group_size_in) {
+
+    assert(read_path_probs.rows() == noise_probs.rows());
+    assert(read_path_probs.rows() == read_counts.cols());
+    assert(group_size > 0);
+
+    path_read_indices = vector<vector<uint32_t> >(read_path_probs.cols());
+    path_read_probs = vector<Utils::ColVectorXd>(read_path_probs.cols());
+    path_read_counts = vector<Utils::RowVectorXd>(read_path_probs.cols());
+
+    for (uint32_t i = 0; i < read_path_probs.cols(); ++i) {
+
+        for (uint32_t j = 0; j < read_path_probs.rows(); ++j) {
+
+            if (read_path_probs(j, i) > 0) {
+
+                path_read_indices.at(i).emplace_back(j);
+            }
+        }
+
+        path_read_probs.at(i) = Utils::ColVectorXd(path_read_indices.at(i).size());
+        path_read_counts.at(i) = Utils::RowVectorXd(path_read_indices.at(i).size());
+
+        for (uint32_t j = 0; j < path_read_indices.at(i).size(); ++j) {
+
+            path_read_probs.at(i)(j) = read_path_probs(path_read_indices.at(i).at(j), i) / static_cast<double>(group_size);
+            path_read_counts.at(i)(j) = read_counts(0, path_read_indices.at(i).at(j));
+        }
+    }
+}
+
+uint32_t PathGroupLikelihoodKernel::numPaths() const {
+
+    return read_path_probs.cols();
+}
+
+uint32_t PathGroupLikelihoodKernel::groupSize() const {
+
+    return group_size;
+}
+
+const vector<vector<uint32_t> > & PathGroupLikelihoodKernel::pathReadIndices() const {
+
+    return path_read_indices;
+}
+
+const vector<Utils::ColVectorXd> & PathGroupLikelihoodKernel::pathReadProbs() const {
+
+    return path_read_probs;
+}
+
+const vector<Utils::RowVectorXd> & PathGroupLikelihoodKernel::pathReadCounts() const {
+
+    return path_read_counts;
+}
+
+double PathGroupLikelihoodKernel::logLikelihood(const vector<uint32_t> & path_group, PathGroupPrefixCache * prefix_cache) const {
+
+    return logLikelihood(path_group.cbegin(), path_group.cend(), prefix_cache);
+}
+
+double PathGroupLikelihoodKernel::logLikelihood(vector<uint32_t>::const_iterator path_group_begin, vector<uint32_t>::const_iterator path_group_end, PathGroupPrefixCache * prefix_cache) const {
+
+    assert(path_group_end - path_group_begin == group_size);
+
+    if (prefix_cache->prefix_read_probs.size() != group_size) {
+
+        prefix_cache->path_group = vector<uint32_t>(group_size, 0);
+        prefix_cache->num_valid_prefixes = 0;
+        prefix_cache->prefix_read_probs = vector<Utils::ColVectorXd>(group_size);
+    }
+
+    // Find the longest prefix shared with the previous group.
+    uint32_t num_shared_paths = 0;
+
+    while (num_shared_paths + 1 < group_size && num_shared_paths + 1 < prefix_cache->num_valid_prefixes && prefix_cache->path_group.at(num_shared_paths) == *(path_group_begin + num_shared_paths)) {
+
+        ++num_shared_paths;
+    }
+
+    const bool is_new_prefix = (num_shared_paths + 1 < group_size || prefix_cache->num_valid_prefixes < group_size);
+
+    if (prefix_cache->num_valid_prefixes == 0) {
+
+        prefix_cache->prefix_read_probs.front() = noise_probs;
+    }
+
+    for (uint32_t i = num_shared_paths; i + 1 < group_size; ++i) {
+
+        const uint32_t path_idx = *(path_group_begin + i);
+
+        prefix_cache->path_group.at(i) = path_idx;
+        prefix_cache->prefix_read_probs.at(i + 1) = prefix_cache->prefix_read_probs.at(i);
+
+        const vector<uint32_t> & cur_path_read_indices = path_read_indices.at(path_idx);
+
+        for (uint32_t j = 0; j < cur_path_read_indices.size(); ++j) {
+
+            prefix_cache->prefix_read_probs.at(i + 1)(cur_path_read_indices.at(j)) += path_read_probs.at(path_idx)(j);
+        }
+    }
+
+    prefix_cache->num_valid_prefixes = group_size;
+
+    const Utils::ColVectorXd & prefix_read_probs = prefix_cache->prefix_read_probs.back();
+
+    if (is_new_prefix) {
+
+        prefix_cache->is_prefix_positive = (prefix_read_probs.minCoeff() > 0);
+
+        if (prefix_cache->is_prefix_positive) {
+
+            prefix_cache->prefix_log_read_probs = prefix_read_probs.array().log();
+            prefix_cache->prefix_log_likelihood = read_counts * prefix_cache->prefix_log_read_probs;
+        }
+    }
+
+    const uint32_t last_path_idx = *(path_group_end - 1);
+
+    if (!prefix_cache->is_prefix_positive) {
+
+        return read_counts * (prefix_read_probs + read_path_probs.col(last_path_idx) / static_cast<double>(group_size)).array().log().matrix();
+    }
+
+    // Only the log probabilities of the reads on the last path change.
+    const vector<uint32_t> & last_path_read_indices = path_read_indices.at(last_path_idx);
+    double log_likelihood = prefix_cache->prefix_log_likelihood;
+
+    for (uint32_t i = 0; i < last_path_read_indices.size(); ++i) {
+
+        const uint32_t read_idx = last_path_read_indices.at(i);
+        log_likelihood += path_read_counts.at(last_path_idx)(i) * (log(prefix_read_probs(read_idx) + path_read_probs.at(last_path_idx)(i)) - prefix_cache->prefix_log_read_probs(read_idx));
+    }
+
+    return log_likelihood;
+}
@@ -0,0 +1,78 @@
+
+#ifndef RPVG_SRC_PATHGROUPLIKELIHOODKERNEL_HPP
+#define RPVG_SRC_PATHGROUPLIKELIHOODKERNEL_HPP
+
+#include <vector>
+
+#include <Eigen/Dense>
+
+#include "utils.hpp"
+
+using namespace std;
+
+
+// Read probabilities of the paths in a group prefix (a group without its
+// last path), which are reused between groups sharing the prefix. Not
+// thread-safe; each thread should use its own cache.
+class PathGroupPrefixCache {
+
+    public:
+
+        PathGroupPrefixCache() : num_valid_prefixes(0), is_prefix_positive(false), prefix_log_likelihood(0) {}
+
+    private:
+
+        vector<uint32_t> path_group;
+        uint32_t num_valid_prefixes;
+
+        // Read probabilities (mixture of noise and prefix paths) of each prefix length.
+        vector<Utils::ColVectorXd> prefix_read_probs;
+
+        // Log read probabilities and log-likelihood of the longest prefix.
+        bool is_prefix_positive;
+        Utils::ColVectorXd prefix_log_read_probs;
+        double prefix_log_likelihood;
+
+        friend class PathGroupLikelihoodKernel;
+};
+
+// Calculates the log-likelihood of the reads given that they are generated
+// by a group of paths with equal abundances (and noise). Only the reads with
+// a non-zero probability on the last path of the group are evaluated for
+// groups that share a prefix with the previously evaluated group.
+class PathGroupLikelihoodKernel {
+
+    public:
+
+        PathGroupLikelihoodKernel(const Utils::ColMatrixXd & read_path_probs_in, const Utils::ColVectorXd & noise_probs_in, const Utils::RowVectorXd & read_counts_in, const uint32_t group_size_in);
+
+        uint32_t numPaths() const;
+        uint32_t groupSize() const;
+
+        // Indices, probabilities (scaled by the group size) and counts of
+        // the reads with a non-zero probability on each path.
+        const vector<vector<uint32_t> > & pathReadIndices() const;
+        const vector<Utils::ColVectorXd> & pathReadProbs() const;
+        const vector<Utils::RowVectorXd> & pathReadCounts() const;
+
+        // Log-likelihood of a group (excluding path frequencies and the
+        // number of permutations). Evaluation is fastest when consecutive
+        // groups share long prefixes, e.g. when enumerated in order.
+        double logLikelihood(const vector<uint32_t> & path_group, PathGroupPrefixCache * prefix_cache) const;
+        double logLikelihood(vector<uint32_t>::const_iterator path_group_begin, vector<uint32_t>::const_iterator path_group_end, PathGroupPrefixCache * prefix_cache) const;
+
+    private:
+
+        const Utils::ColMatrixXd & read_path_probs;
+        const Utils::ColVectorXd & noise_probs;
+        const Utils::RowVectorXd & read_counts;
+
+        const uint32_t group_size;
+
+        vector<vector<uint32_t> > path_read_indices;
+        vector<Utils::ColVectorXd> path_read_probs;
+        vector<Utils::RowVectorXd> path_read_counts;
+};
+
+
+#endif
@@ -8,7 +8,15 @@ PathPosteriorEstimator::PathPosteriorEstimator(const double prob_precision) : Pa
 
 void PathPosteriorEstimator::estimate(PathClusterEstimates * path_cluster_estimates, const vector<ReadPathProbabilities> & cluster_probs, mt19937 * mt_rng) {
 
-    if (!cluster_probs.empty()) {
+    if (!cluster_probs.empty() && path_cluster_estimates->paths.size() == 1) {
+
+        // A single path (group) has a posterior of one.
+        path_cluster_estimates->initEstimates(0, 0, true);
+
+        path_cluster_estimates->path_group_sets.emplace_back(vector<uint32_t>(1, 0));
+        path_cluster_estimates->posteriors.emplace_back(1);
+
+    } else if (!cluster_probs.empty()) {
 
         Utils::ColMatrixXd read_path_probs;
         Utils::ColVectorXd noise_probs;
@@ -40,7 +48,15 @@ PathGroupPosteriorEstimator::PathGroupPosteriorEstimator(const uint32_t group_si
 
 void PathGroupPosteriorEstimator::estimate(PathClusterEstimates * path_cluster_estimates, const vector<ReadPathProbabilities> & cluster_probs, mt19937 * mt_rng) {
 
-    if (!cluster_probs.empty()) {
+    if (!cluster_probs.empty() && path_cluster_estimates->paths.size() == 1) {
+
+        // A single path (group) has a posterior of one.
+        path_cluster_estimates->initEstimates(0, 0, true);
+
+        path_cluster_estimates->path_group_sets.emplace_back(vector<uint32_t>(group_size, 0));
+        path_cluster_estimates->posteriors.emplace_back(1);
+
+    } else if (!cluster_probs.empty()) {
 
         Utils::ColMatrixXd read_path_probs;
         Utils::ColVectorXd noise_probs;
@@ -62,7 +78,7 @@ void PathGroupPosteriorEstimator::estimate(PathClusterEstimates * path_cluster_e
 
         } else {
 
-            if (group_size == 2) {
+            if (group_size > 1) {
 
                 calculatePathGroupPosteriorsBounded(path_cluster_estimates, read_path_probs, noise_probs, read_counts, path_counts, group_size, min_rel_likelihood);
             
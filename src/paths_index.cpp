@@ -2,12 +2,35 @@
 #include "paths_index.hpp"
 
 #include <sstream>
+#include <algorithm>
 #include <math.h>
 
 #include "utils.hpp"
 
 
-PathsIndex::PathsIndex(const gbwt::GBWT & gbwt_index_in, const gbwt::FastLocate & r_index_in, const vg::Graph & graph) : gbwt_index(gbwt_index_in), r_index(r_index_in) {
+// Number of nodes in each page of the successors cache.
+static const uint32_t successors_cache_page_size = 4096;
+
+void GBWTRecordBatch::clear() {
+
+    gbwt_nodes.clear();
+    gbwt_records.clear();
+}
+
+const gbwt::CompressedRecord * GBWTRecordBatch::find(const gbwt::node_type gbwt_node) const {
+
+    auto gbwt_nodes_it = lower_bound(gbwt_nodes.begin(), gbwt_nodes.end(), gbwt_node);
+
+    if (gbwt_nodes_it == gbwt_nodes.end() || *gbwt_nodes_it != gbwt_node) {
+
+        return nullptr;
+    }
+
+    return &(gbwt_records.at(gbwt_nodes_it - gbwt_nodes.begin()));
+}
+
+
+PathsIndex::PathsIndex(const gbwt::GBWT & gbwt_index_in, const gbwt::FastLocate & r_index_in, const vg::Graph & graph) : gbwt_index(gbwt_index_in), r_index(r_index_in), successors_cache_pages(gbwt_index_in.effective() / successors_cache_page_size + 1) {
 
     node_lengths = vector<int32_t>(graph.node_size() + 1, -1);
     uint32_t max_node_id = 0;
@@ -28,9 +51,11 @@ PathsIndex::PathsIndex(const gbwt::GBWT & gbwt_index_in, const gbwt::FastLocate
 
     assert(node_lengths.size() > max_node_id);
     node_lengths.resize(max_node_id + 1);
+
+    findCyclicNodes();
 }
 
-PathsIndex::PathsIndex(const gbwt::GBWT & gbwt_index_in, const gbwt::FastLocate & r_index_in,  const handlegraph::HandleGraph & graph) : gbwt_index(gbwt_index_in), r_index(r_index_in) {
+PathsIndex::PathsIndex(const gbwt::GBWT & gbwt_index_in, const gbwt::FastLocate & r_index_in,  const handlegraph::HandleGraph & graph) : gbwt_index(gbwt_index_in), r_index(r_index_in), successors_cache_pages(gbwt_index_in.effective() / successors_cache_page_size + 1) {
 
     node_lengths = vector<int32_t>(graph.get_node_count() + 1, -1);
     uint32_t max_node_id = 0;
@@ -51,8 +76,55 @@ PathsIndex::PathsIndex(const gbwt::GBWT & gbwt_index_in, const gbwt::FastLocate
 
     assert(node_lengths.size() > max_node_id);
     node_lengths.resize(max_node_id + 1);
+
+    findCyclicNodes();
 } 
 
+void PathsIndex::findCyclicNodes() {
+
+    cyclic_nodes = vector<bool>(gbwt_index.sigma(), false);
+
+    // Paths in a bidirectional index are stored in both orientations.
+    const uint32_t sequence_step = bidirectional() ? 2 : 1;
+
+    for (size_t i = 0; i < gbwt_index.sequences(); i += sequence_step) {
+
+        auto path = gbwt_index.extract(i);
+        sort(path.begin(), path.end());
+
+        for (size_t j = 1; j < path.size(); ++j) {
+
+            if (path.at(j - 1) == path.at(j)) {
+
+                cyclic_nodes.at(path.at(j)) = true;
+
+                if (bidirectional()) {
+
+                    cyclic_nodes.at(gbwt::Node::reverse(path.at(j))) = true;
+                }
+            }
+        }
+    }
+}
+
+PathsIndex::~PathsIndex() {
+
+    for (auto & successors_cache_page: successors_cache_pages) {
+
+        auto * cache_page = successors_cache_page.load();
+
+        if (cache_page) {
+
+            for (uint32_t i = 0; i < successors_cache_page_size; ++i) {
+
+                delete cache_page[i].load();
+            }
+
+            delete[] cache_page;
+        }
+    }
+}
+
 uint32_t PathsIndex::numberOfNodes() const {
 
     return node_lengths.size();
@@ -79,6 +151,85 @@ vector<gbwt::edge_type> PathsIndex::edges(const gbwt::node_type gbwt_node) const
     return gbwt_index.edges(gbwt_node);
 }
 
+const vector<gbwt::node_type> & PathsIndex::successors(const gbwt::node_type gbwt_node) const {
+
+    static const vector<gbwt::node_type> empty_successors;
+
+    if (!gbwt_index.contains(gbwt_node)) {
+
+        return empty_successors;
+    }
+
+    const gbwt::comp_type gbwt_comp = gbwt_index.toComp(gbwt_node);
+    assert(gbwt_comp < gbwt_index.effective());
+
+    auto & successors_cache_page = successors_cache_pages.at(gbwt_comp / successors_cache_page_size);
+    auto * cache_page = successors_cache_page.load(memory_order_acquire);
+
+    if (!cache_page) {
+
+        auto * new_cache_page = new atomic<vector<gbwt::node_type> *>[successors_cache_page_size];
+
+        for (uint32_t i = 0; i < successors_cache_page_size; ++i) {
+
+            new_cache_page[i].store(nullptr, memory_order_relaxed);
+        }
+
+        // Keep the page of another thread if it allocated the page first.
+        if (successors_cache_page.compare_exchange_strong(cache_page, new_cache_page, memory_order_acq_rel, memory_order_acquire)) {
+
+            cache_page = new_cache_page;
+
+        } else {
+
+            delete[] new_cache_page;
+        }
+    }
+
+    auto & cached_successors = cache_page[gbwt_comp % successors_cache_page_size];
+
+    vector<gbwt::node_type> * successors = cached_successors.load(memory_order_acquire);
+
+    if (successors) {
+
+        return *successors;
+    }
+
+    auto new_successors = new vector<gbwt::node_type>();
+    auto out_edges = gbwt_index.edges(gbwt_node);
+
+    new_successors->reserve(out_edges.size());
+
+    for (auto & out_edge: out_edges) {
+
+        if (out_edge.first != gbwt::ENDMARKER) {
+
+            new_successors->emplace_back(out_edge.first);
+        }
+    }
+
+    // Keep the successors of another thread if it filled the cache first.
+    if (cached_successors.compare_exchange_strong(successors, new_successors, memory_order_acq_rel, memory_order_acquire)) {
+
+        return *new_successors;
+
+    } else {
+
+        delete new_successors;
+        return *successors;
+    }
+}
+
+bool PathsIndex::isCyclicNode(const gbwt::node_type gbwt_node) const {
+
+    if (gbwt_node >= cyclic_nodes.size()) {
+
+        return false;
+    }
+
+    return cyclic_nodes.at(gbwt_node);
+}
+
 bool PathsIndex::bidirectional() const {
 
     return gbwt_index.bidirectional();
@@ -121,6 +272,58 @@ void PathsIndex::extend(pair<gbwt::SearchState, gbwt::size_type> * gbwt_search,
     }
 }
 
+bool PathsIndex::decodesRecords() const {
+
+    return r_index.empty();
+}
+
+void PathsIndex::decodeRecords(GBWTRecordBatch * gbwt_records, vector<gbwt::node_type> * gbwt_nodes) const {
+
+    gbwt_records->clear();
+
+    if (!decodesRecords()) {
+
+        return;
+    }
+
+    sort(gbwt_nodes->begin(), gbwt_nodes->end());
+    gbwt_nodes->erase(unique(gbwt_nodes->begin(), gbwt_nodes->end()), gbwt_nodes->end());
+
+    gbwt_records->gbwt_nodes.reserve(gbwt_nodes->size());
+    gbwt_records->gbwt_records.reserve(gbwt_nodes->size());
+
+    for (auto & gbwt_node: *gbwt_nodes) {
+
+        if (gbwt_node != gbwt::ENDMARKER && gbwt_index.contains(gbwt_node)) {
+
+            gbwt_records->gbwt_nodes.emplace_back(gbwt_node);
+            gbwt_records->gbwt_records.emplace_back(gbwt_index.record(gbwt_node));
+        }
+    }
+}
+
+void PathsIndex::extend(pair<gbwt::SearchState, gbwt::size_type> * gbwt_search, const gbwt::node_type gbwt_node, const GBWTRecordBatch & gbwt_records) const {
+
+    const gbwt::CompressedRecord * gbwt_record = gbwt_records.find(gbwt_search->first.node);
+
+    if (!gbwt_record) {
+
+        extend(gbwt_search, gbwt_node);
+        return;
+    }
+
+    // Same as gbwt::GBWT::extend().
+    if (gbwt_search->first.empty() || !gbwt_index.contains(gbwt_node)) {
+
+        gbwt_search->first = gbwt::SearchState();
+
+    } else {
+
+        gbwt_search->first.range = gbwt_record->LF(gbwt_search->first.range, gbwt_node);
+        gbwt_search->first.node = gbwt_node;
+    }
+}
+
 vector<gbwt::size_type> PathsIndex::locatePathIds(const pair<gbwt::SearchState, gbwt::size_type> & gbwt_search) const {
 
     vector<gbwt::size_type> path_ids;
@@ -4,6 +4,7 @@
 
 #include <vector>
 #include <string>
+#include <atomic>
 
 #include "gbwt/gbwt.h"
 #include "gbwt/fast_locate.h"
@@ -14,12 +15,35 @@
 using namespace std;
 
 
+// Decoded GBWT records of a batch of nodes, sorted by node. Searches
+// extended from a node in the batch share its decoded record.
+class GBWTRecordBatch {
+
+    public:
+
+        void clear();
+
+        // Returns nullptr if the record of the node is not in the batch.
+        const gbwt::CompressedRecord * find(const gbwt::node_type gbwt_node) const;
+
+    private:
+
+        vector<gbwt::node_type> gbwt_nodes;
+        vector<gbwt::CompressedRecord> gbwt_records;
+
+    friend class PathsIndex;
+};
+
 class PathsIndex {
 
     public: 
     	
         PathsIndex(const gbwt::GBWT & gbwt_index_in, const gbwt::FastLocate & r_index_in, const vg::Graph & graph);
         PathsIndex(const gbwt::GBWT & gbwt_index_in, const gbwt::FastLocate & r_index_in, const handlegraph::HandleGraph & graph);
+        ~PathsIndex();
+
+        PathsIndex(const PathsIndex &) = delete;
+        PathsIndex & operator=(const PathsIndex &) = delete;
 
         uint32_t numberOfNodes() const;
         bool hasNodeId(const uint32_t node_id) const;
@@ -27,11 +51,34 @@ class PathsIndex {
 
         vector<gbwt::edge_type> edges(const gbwt::node_type gbwt_node) const;
 
+        // Successor nodes (excluding the endmarker) of a node in the 
+        // GBWT. The successors are cached on first access and the cache 
+        // is safe to fill from multiple threads.
+        const vector<gbwt::node_type> & successors(const gbwt::node_type gbwt_node) const;
+
+        // True if the node is visited more than once by at least one path.
+        bool isCyclicNode(const gbwt::node_type gbwt_node) const;
+
         bool bidirectional() const;
         uint32_t numberOfPaths() const;
 
         void find(pair<gbwt::SearchState, gbwt::size_type> * gbwt_search, const gbwt::node_type gbwt_node) const;
         void extend(pair<gbwt::SearchState, gbwt::size_type> * gbwt_search, const gbwt::node_type gbwt_node) const;
+
+        // True if decodeRecords() decodes records, which is not the case
+        // when using an r-index, because its extension also tracks sampled
+        // positions.
+        bool decodesRecords() const;
+
+        // Groups the nodes (sorts and removes duplicates) and decodes the 
+        // record of each node once. Records are not decoded when using 
+        // an r-index, because its extension also tracks sampled positions.
+        void decodeRecords(GBWTRecordBatch * gbwt_records, vector<gbwt::node_type> * gbwt_nodes) const;
+
+        // Same as extend() above, but uses the decoded record of the 
+        // current search node if it is in the batch.
+        void extend(pair<gbwt::SearchState, gbwt::size_type> * gbwt_search, const gbwt::node_type gbwt_node, const GBWTRecordBatch & gbwt_records) const;
+
         vector<gbwt::size_type> locatePathIds(const pair<gbwt::SearchState, gbwt::size_type> & gbwt_search) const;
 
         string pathName(const uint32_t path_id) const;
@@ -45,6 +92,14 @@ class PathsIndex {
 
         vector<int32_t> node_lengths;
 
+        // Successors of each node in the effective node range. The cache is
+        // divided into pages that are allocated on first access, such that
+        // its size scales with the part of the graph that is searched.
+        mutable vector<atomic<atomic<vector<gbwt::node_type> *> *> > successors_cache_pages;
+        vector<bool> cyclic_nodes;
+
+        void findCyclicNodes();
+
         double calculateLowerPhi(const double value) const;
         double calculateUpperPhi(const double value) const;
 };
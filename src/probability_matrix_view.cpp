@@ -0,0 +1,91 @@
+
+#include "probability_matrix_view.hpp"
+
+#include <algorithm>
+#include <numeric>
+
+
+ProbabilityMatrixView::ProbabilityMatrixView(const Utils::ColMatrixXd & read_path_probs_in, const Utils::RowVectorXd & read_counts_in) : read_path_probs(read_path_probs_in), read_counts(read_counts_in) {
+
+    col_indices = vector<uint32_t>(read_path_probs.cols());
+    iota(col_indices.begin(), col_indices.end(), 0);
+
+    findNonZeroRows();
+}
+
+ProbabilityMatrixView::ProbabilityMatrixView(const Utils::ColMatrixXd & read_path_probs_in, const Utils::RowVectorXd & read_counts_in, const vector<uint32_t> & col_indices_in) : read_path_probs(read_path_probs_in), read_counts(read_counts_in), col_indices(col_indices_in) {
+
+    findNonZeroRows();
+}
+
+double ProbabilityMatrixView::totalReadCount() const {
+
+    double total_read_count = 0;
+
+    for (auto & row_idx: row_indices) {
+
+        total_read_count += read_counts(0, row_idx);
+    }
+
+    return total_read_count;
+}
+
+void ProbabilityMatrixView::gather(ProbabilityMatrixBuffer * buffer) const {
+
+    if (buffer->read_path_probs.rows() < rows() || buffer->read_path_probs.cols() < cols()) {
+
+        buffer->read_path_probs.resize(max(static_cast<uint32_t>(buffer->read_path_probs.rows()), rows()), max(static_cast<uint32_t>(buffer->read_path_probs.cols()), cols()));
+    }
+
+    if (buffer->read_counts.cols() < rows()) {
+
+        buffer->read_counts.resize(rows());
+        buffer->read_weights.resize(rows());
+    }
+
+    for (uint32_t i = 0; i < cols(); ++i) {
+
+        for (uint32_t j = 0; j < rows(); ++j) {
+
+            buffer->read_path_probs(j, i) = read_path_probs(row_indices[j], col_indices[i]);
+        }
+    }
+
+    for (uint32_t i = 0; i < rows(); ++i) {
+
+        buffer->read_counts(0, i) = read_counts(0, row_indices[i]);
+    }
+}
+
+void ProbabilityMatrixView::findNonZeroRows() {
+
+    assert(read_path_probs.rows() == read_counts.cols());
+
+    vector<bool> is_non_zero_row(read_path_probs.rows(), false);
+    uint32_t num_non_zero_rows = 0;
+
+    for (auto & col_idx: col_indices) {
+
+        assert(col_idx < read_path_probs.cols());
+
+        for (uint32_t i = 0; i < read_path_probs.rows(); ++i) {
+
+            if (!is_non_zero_row[i] && read_path_probs(i, col_idx) > 0) {
+
+                is_non_zero_row[i] = true;
+                ++num_non_zero_rows;
+            }
+        }
+    }
+
+    row_indices.clear();
+    row_indices.reserve(num_non_zero_rows);
+
+    for (uint32_t i = 0; i < read_path_probs.rows(); ++i) {
+
+        if (is_non_zero_row[i]) {
+
+            row_indices.emplace_back(i);
+        }
+    }
+}
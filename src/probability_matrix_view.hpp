@@ -0,0 +1,57 @@
+
+#ifndef RPVG_SRC_PROBABILITYMATRIXVIEW_HPP
+#define RPVG_SRC_PROBABILITYMATRIXVIEW_HPP
+
+#include <vector>
+
+#include <Eigen/Dense>
+
+#include "utils.hpp"
+
+using namespace std;
+
+
+// Reusable buffers that the reads of views are gathered into. The buffers
+// only grow, such that views of different sizes are gathered into the
+// top left corner without allocating a matrix for each view.
+struct ProbabilityMatrixBuffer {
+
+    Utils::ColMatrixXd read_path_probs;
+    Utils::RowVectorXd read_counts;
+    Utils::ColVectorXd read_weights;
+};
+
+// Non-owning view of a subset of the paths (columns) of a read path
+// probability matrix. Only the reads (rows) with a non-zero probability
+// for at least one of the paths are included. The probabilities of a read
+// are not renormalized over the subset, which does not change the read
+// posteriors used by EM and Gibbs sampling.
+class ProbabilityMatrixView {
+
+    public:
+
+        ProbabilityMatrixView(const Utils::ColMatrixXd & read_path_probs_in, const Utils::RowVectorXd & read_counts_in);
+        ProbabilityMatrixView(const Utils::ColMatrixXd & read_path_probs_in, const Utils::RowVectorXd & read_counts_in, const vector<uint32_t> & col_indices_in);
+
+        uint32_t rows() const { return row_indices.size(); }
+        uint32_t cols() const { return col_indices.size(); }
+
+        double operator()(const uint32_t row, const uint32_t col) const { return read_path_probs(row_indices[row], col_indices[col]); }
+        double readCount(const uint32_t row) const { return read_counts(0, row_indices[row]); }
+
+        double totalReadCount() const;
+        void gather(ProbabilityMatrixBuffer * buffer) const;
+
+    private:
+
+        const Utils::ColMatrixXd & read_path_probs;
+        const Utils::RowVectorXd & read_counts;
+
+        vector<uint32_t> row_indices;
+        vector<uint32_t> col_indices;
+
+        void findNonZeroRows();
+};
+
+
+#endif
@@ -185,6 +185,39 @@ bool ReadPathProbabilities::quickMergeIdentical(const ReadPathProbabilities & pr
     return false;
 }
 
+void ReadPathProbabilities::serialize(ostream * out_stream) const {
+
+    Utils::writeBinary<uint32_t>(out_stream, read_count);
+    Utils::writeBinary<double>(out_stream, noise_prob);
+    Utils::writeBinary<double>(out_stream, prob_precision);
+    Utils::writeBinary<uint32_t>(out_stream, path_probs.size());
+
+    for (auto & path_probs_group: path_probs) {
+
+        Utils::writeBinary<double>(out_stream, path_probs_group.first);
+        Utils::writeBinary<uint32_t>(out_stream, path_probs_group.second.size());
+
+        out_stream->write(reinterpret_cast<const char *>(path_probs_group.second.data()), path_probs_group.second.size() * sizeof(uint32_t));
+    }
+}
+
+void ReadPathProbabilities::deserialize(istream * in_stream) {
+
+    read_count = Utils::readBinary<uint32_t>(in_stream);
+    noise_prob = Utils::readBinary<double>(in_stream);
+    prob_precision = Utils::readBinary<double>(in_stream);
+
+    path_probs = vector<pair<double, vector<uint32_t> > >(Utils::readBinary<uint32_t>(in_stream));
+
+    for (auto & path_probs_group: path_probs) {
+
+        path_probs_group.first = Utils::readBinary<double>(in_stream);
+        path_probs_group.second = vector<uint32_t>(Utils::readBinary<uint32_t>(in_stream));
+
+        in_stream->read(reinterpret_cast<char *>(path_probs_group.second.data()), path_probs_group.second.size() * sizeof(uint32_t));
+    }
+}
+
 bool operator==(const ReadPathProbabilities & lhs, const ReadPathProbabilities & rhs) { 
 
     if (lhs.readCount() == rhs.readCount() && Utils::doubleCompare(lhs.noiseProb(), rhs.noiseProb())) {
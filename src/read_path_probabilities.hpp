@@ -32,6 +32,9 @@ class ReadPathProbabilities {
 
         bool quickMergeIdentical(const ReadPathProbabilities & probs_2);
 
+        void serialize(ostream * out_stream) const;
+        void deserialize(istream * in_stream);
+
     private:
 
         uint32_t read_count;
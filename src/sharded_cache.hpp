@@ -0,0 +1,102 @@
+
+#ifndef RPVG_SRC_SHARDEDCACHE_HPP
+#define RPVG_SRC_SHARDEDCACHE_HPP
+
+#include <cassert>
+#include <vector>
+#include <deque>
+#include <mutex>
+#include <memory>
+#include <functional>
+
+#include "sparsepp/spp.h"
+
+using namespace std;
+
+
+// Thread-safe cache with a bounded number of values. Keys are distributed
+// over independently locked shards and the oldest value in a shard is
+// evicted when the shard is full. Values are shared pointers, which keeps
+// evicted values valid for the threads still using them.
+template<class Key, class Value>
+class ShardedCache {
+
+    public:
+
+        ShardedCache(const uint32_t num_shards, const uint32_t max_size) : shards(num_shards) {
+
+            assert(num_shards > 0);
+            max_shard_size = max(static_cast<uint32_t>(1), max_size / num_shards);
+        }
+
+        // Returns the cached value of the key or nullptr if it is not cached.
+        shared_ptr<const Value> find(const Key & key) {
+
+            Shard & shard = shards.at(shardIdx(key));
+            lock_guard<mutex> shard_lock(shard.shard_mutex);
+
+            auto values_it = shard.values.find(key);
+            return (values_it == shard.values.end() ? nullptr : values_it->second);
+        }
+
+        // Caches the value of the key and returns the cached value, which is
+        // the existing value if another thread has cached the key first.
+        shared_ptr<const Value> insert(const Key & key, shared_ptr<const Value> value) {
+
+            Shard & shard = shards.at(shardIdx(key));
+            lock_guard<mutex> shard_lock(shard.shard_mutex);
+
+            auto values_it = shard.values.emplace(key, value);
+
+            if (!values_it.second) {
+
+                return values_it.first->second;
+            }
+
+            shard.keys.emplace_back(key);
+
+            if (shard.keys.size() > max_shard_size) {
+
+                shard.values.erase(shard.keys.front());
+                shard.keys.pop_front();
+            }
+
+            return value;
+        }
+
+        uint32_t size() {
+
+            uint32_t num_values = 0;
+
+            for (auto & shard: shards) {
+
+                lock_guard<mutex> shard_lock(shard.shard_mutex);
+                num_values += shard.values.size();
+            }
+
+            return num_values;
+        }
+
+    private:
+
+        struct Shard {
+
+            mutex shard_mutex;
+
+            spp::sparse_hash_map<Key, shared_ptr<const Value> > values;
+            deque<Key> keys;
+        };
+
+        vector<Shard> shards;
+        uint32_t max_shard_size;
+
+        // Uses the high bits of the mixed hash, since the low bits are used
+        // for the buckets within the shards.
+        uint32_t shardIdx(const Key & key) const {
+
+            return ((static_cast<uint64_t>(hash<Key>()(key)) * 0x9E3779B97F4A7C15ULL) >> 32) % shards.size();
+        }
+};
+
+
+#endif
@@ -0,0 +1,157 @@
+
+#include "catch.hpp"
+
+#include "../alignment_decoder.hpp"
+#include "../utils.hpp"
+
+
+TEST_CASE("Alignment decoder decodes fields used to find alignment paths") {
+
+    const string alignment_str = R"(
+        {
+            "sequence": "ACGTA",
+            "quality": "EhITFBU=",
+            "name": "read",
+            "mapping_quality": 10,
+            "score": -3,
+            "path": {
+                "name": "path",
+                "mapping": [
+                    {
+                        "position": {"node_id": 2, "offset": 3, "is_reverse": true},
+                        "edit": [
+                            {"from_length": 1, "to_length": 1},
+                            {"from_length": 1, "to_length": 1, "sequence": "C"}
+                        ],
+                        "rank": 1
+                    },
+                    {
+                        "position": {"node_id": 4},
+                        "edit": [
+                            {"from_length": 2, "to_length": 2},
+                            {"to_length": 1, "sequence": "A"}
+                        ],
+                        "rank": 2
+                    }
+                ]
+            }
+        }
+    )";
+
+    vg::Alignment alignment;
+    Utils::json2pb(alignment, alignment_str);
+
+    string serialized_alignment;
+    alignment.SerializeToString(&serialized_alignment);
+
+    AlignmentDecoder alignment_decoder;
+
+    vg::Alignment decoded_alignment;
+    uint32_t sequence_length = 0;
+
+    alignment_decoder.decode(&decoded_alignment, &sequence_length, serialized_alignment);
+
+    REQUIRE(sequence_length == 5);
+    REQUIRE(decoded_alignment.sequence().empty());
+    REQUIRE(decoded_alignment.quality() == alignment.quality());
+    REQUIRE(decoded_alignment.mapping_quality() == 10);
+    REQUIRE(decoded_alignment.score() == -3);
+    REQUIRE(decoded_alignment.name().empty());
+
+    REQUIRE(decoded_alignment.path().name().empty());
+    REQUIRE(decoded_alignment.path().mapping_size() == 2);
+
+    for (size_t i = 0; i < 2; ++i) {
+
+        const vg::Mapping & mapping = alignment.path().mapping(i);
+        const vg::Mapping & decoded_mapping = decoded_alignment.path().mapping(i);
+
+        REQUIRE(decoded_mapping.position().node_id() == mapping.position().node_id());
+        REQUIRE(decoded_mapping.position().offset() == mapping.position().offset());
+        REQUIRE(decoded_mapping.position().is_reverse() == mapping.position().is_reverse());
+        REQUIRE(decoded_mapping.rank() == 0);
+
+        REQUIRE(decoded_mapping.edit_size() == 2);
+
+        for (size_t j = 0; j < 2; ++j) {
+
+            REQUIRE(decoded_mapping.edit(j).from_length() == mapping.edit(j).from_length());
+            REQUIRE(decoded_mapping.edit(j).to_length() == mapping.edit(j).to_length());
+            REQUIRE(decoded_mapping.edit(j).sequence().empty());
+        }
+    }
+
+    SECTION("Decoded alignment can be reused") {
+
+        alignment.clear_sequence();
+        alignment.clear_quality();
+        alignment.mutable_path()->mutable_mapping()->RemoveLast();
+
+        alignment.SerializeToString(&serialized_alignment);
+        alignment_decoder.decode(&decoded_alignment, &sequence_length, serialized_alignment);
+
+        REQUIRE(sequence_length == 0);
+        REQUIRE(decoded_alignment.quality().empty());
+        REQUIRE(decoded_alignment.path().mapping_size() == 1);
+        REQUIRE(decoded_alignment.path().mapping(0).edit_size() == 2);
+    }
+
+    SECTION("Malformed alignment throws error") {
+
+        serialized_alignment.pop_back();
+        REQUIRE_THROWS(alignment_decoder.decode(&decoded_alignment, &sequence_length, serialized_alignment));
+    }
+}
+
+TEST_CASE("Alignment decoder decodes multipath alignments") {
+
+    const string alignment_str = R"(
+        {
+            "sequence": "AAAA",
+            "name": "read",
+            "mapping_quality": 20,
+            "start": [0, 1],
+            "subpath": [
+                {
+                    "path": {"mapping": [{"position": {"node_id": 1}, "edit": [{"from_length": 2, "to_length": 2}]}]},
+                    "next": [2],
+                    "score": 2
+                },
+                {
+                    "path": {"mapping": [{"position": {"node_id": 3, "offset": 1}, "edit": [{"from_length": 2, "to_length": 2, "sequence": "AA"}]}]},
+                    "connection": [{"next": 2, "score": -4}],
+                    "score": -1
+                },
+                {
+                    "path": {"mapping": [{"position": {"node_id": 5, "is_reverse": true}, "edit": [{"from_length": 2, "to_length": 2}]}]},
+                    "score": 2
+                }
+            ],
+            "annotation": {"disconnected": true, "proper_pair": false, "secondary_score": 3}
+        }
+    )";
+
+    vg::MultipathAlignment alignment;
+    Utils::json2pb(alignment, alignment_str);
+
+    string serialized_alignment;
+    alignment.SerializeToString(&serialized_alignment);
+
+    vg::MultipathAlignment decoded_alignment;
+    uint32_t sequence_length = 0;
+
+    AlignmentDecoder alignment_decoder;
+    alignment_decoder.decode(&decoded_alignment, &sequence_length, serialized_alignment);
+
+    REQUIRE(sequence_length == 4);
+
+    alignment.clear_sequence();
+    alignment.clear_name();
+    alignment.mutable_subpath(1)->mutable_path()->mutable_mapping(0)->mutable_edit(0)->clear_sequence();
+
+    alignment.mutable_annotation()->mutable_fields()->erase("proper_pair");
+    alignment.mutable_annotation()->mutable_fields()->erase("secondary_score");
+
+    REQUIRE(decoded_alignment.annotation().fields().size() == 1);
+    REQUIRE(Utils::pb2json(decoded_alignment) == Utils::pb2json(alignment));
+}
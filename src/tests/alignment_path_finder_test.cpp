@@ -163,6 +163,33 @@ TEST_CASE("Alignment path(s) can be found from a single-end alignment") {
         REQUIRE(alignment_paths_alt.empty());
     }
 
+    SECTION("Batched single-end read alignments find the same alignment path(s)") {
+
+        gbwt::FastLocate empty_r_index;
+        PathsIndex paths_index_no_r(gbwt_index, empty_r_index, graph);
+
+        auto alignment_1_alt = alignment_1;
+        alignment_1_alt.mutable_path()->mutable_mapping(1)->mutable_position()->set_node_id(3);
+
+        const vector<vg::Alignment> alignments = {alignment_1, alignment_1_alt, alignment_1};
+        const vector<uint32_t> seq_lengths(alignments.size(), alignment_1.sequence().size());
+
+        for (auto & library_type: vector<string>({"unstranded", "fr", "rf"})) {
+
+            AlignmentPathFinder<vg::Alignment> alignment_path_finder_no_r(paths_index_no_r, library_type, 1000, 0, true, 20, 0);
+
+            vector<vector<AlignmentPath> > alignment_paths_batch;
+            alignment_path_finder_no_r.findAlignmentPaths(&alignment_paths_batch, alignments, seq_lengths);
+
+            REQUIRE(alignment_paths_batch.size() == alignments.size());
+
+            for (size_t i = 0; i < alignments.size(); ++i) {
+
+                REQUIRE(alignment_paths_batch.at(i) == alignment_path_finder_no_r.findAlignmentPaths(alignments.at(i)));
+            }
+        }
+    }
+
     SECTION("Single-end read alignment finds forward alignment path(s) in bidirectional index") {
 
         gbwt::GBWTBuilder gbwt_builder_bd(gbwt::bit_length(gbwt::Node::encode(4, true)));
@@ -1074,6 +1101,66 @@ TEST_CASE("Alignment path(s) can be found from a single-end multipath alignment"
         REQUIRE(alignment_paths_rc == alignment_paths);
     }
 
+    SECTION("Reverse multipath alignment view equals reverse-complemented alignment") {
+
+        alignment_1.set_quality(string({20, 21, 22, 23, 24, 25, 26, 27}));
+        auto alignment_1_rc = Utils::lazy_reverse_complement_alignment(alignment_1, node_frag_length_func);
+
+        AlignmentView<vg::MultipathAlignment> alignment_1_view(alignment_1, alignment_1.sequence().size(), true, paths_index);
+
+        REQUIRE(alignment_1_view.sequenceLength() == alignment_1_rc.sequence().size());
+        REQUIRE(alignment_1_view.mappingQuality() == alignment_1_rc.mapping_quality());
+
+        REQUIRE(alignment_1_view.quality().size() == alignment_1_rc.quality().size());
+
+        for (size_t i = 0; i < alignment_1_rc.quality().size(); ++i) {
+
+            REQUIRE(alignment_1_view.quality().at(i) == alignment_1_rc.quality().at(i));
+        }
+
+        REQUIRE(alignment_1_view.startSize() == alignment_1_rc.start_size());
+
+        for (size_t i = 0; i < alignment_1_rc.start_size(); ++i) {
+
+            REQUIRE(alignment_1_view.start(i) == alignment_1_rc.start(i));
+        }
+
+        REQUIRE(alignment_1_view.subpathSize() == alignment_1_rc.subpath_size());
+
+        for (size_t i = 0; i < alignment_1_rc.subpath_size(); ++i) {
+
+            const vg::Subpath & subpath_rc = alignment_1_rc.subpath(i);
+
+            REQUIRE(alignment_1_view.subpathScore(i) == subpath_rc.score());
+            REQUIRE(alignment_1_view.subpathConnectionSize(i) == subpath_rc.connection_size());
+            REQUIRE(alignment_1_view.subpathNextSize(i) == subpath_rc.next_size());
+
+            for (size_t j = 0; j < subpath_rc.next_size(); ++j) {
+
+                REQUIRE(alignment_1_view.subpathNext(i, j) == subpath_rc.next(j));
+            }
+
+            const PathView path_view = alignment_1_view.subpathPath(i);
+            REQUIRE(path_view.mappingSize() == subpath_rc.path().mapping_size());
+
+            for (size_t j = 0; j < subpath_rc.path().mapping_size(); ++j) {
+
+                const vg::Mapping & mapping_rc = subpath_rc.path().mapping(j);
+                const MappingView mapping_view = path_view.mapping(j);
+
+                REQUIRE(mapping_view.gbwtNode() == Utils::mapping_to_gbwt(mapping_rc));
+                REQUIRE(mapping_view.offset() == mapping_rc.position().offset());
+                REQUIRE(mapping_view.editSize() == mapping_rc.edit_size());
+
+                for (size_t k = 0; k < mapping_rc.edit_size(); ++k) {
+
+                    REQUIRE(mapping_view.edit(k).from_length() == mapping_rc.edit(k).from_length());
+                    REQUIRE(mapping_view.edit(k).to_length() == mapping_rc.edit(k).to_length());
+                }
+            }
+        }
+    }
+
     SECTION("Soft-clipped single-end multipath read alignment finds alignment path(s)") {
 
         alignment_1.mutable_subpath(3)->mutable_path()->mutable_mapping(0)->mutable_edit(0)->set_from_length(1);
@@ -1743,6 +1830,36 @@ TEST_CASE("Alignment path(s) can be found from a paired-end multipath alignment"
         REQUIRE(alignment_paths_bd.back() == alignment_paths.back());
     }
 
+    SECTION("Batched paired-end multipath read alignments find the same alignment path(s)") {
+
+        gbwt::FastLocate empty_r_index;
+        PathsIndex paths_index_no_r(gbwt_index, empty_r_index, graph);
+
+        auto alignment_2_rc = Utils::lazy_reverse_complement_alignment(alignment_2, node_frag_length_func);
+        alignment_2_rc.set_sequence("AAAAAAA");
+
+        const vector<vg::MultipathAlignment> alignments = {alignment_1, alignment_2, alignment_1, alignment_2_rc};
+        vector<uint32_t> seq_lengths;
+
+        for (auto & alignment: alignments) {
+
+            seq_lengths.emplace_back(alignment.sequence().size());
+        }
+
+        for (auto & library_type: vector<string>({"unstranded", "fr", "rf"})) {
+
+            AlignmentPathFinder<vg::MultipathAlignment> alignment_path_finder_no_r(paths_index_no_r, library_type, 1000, 0, true, 20, 0);
+
+            vector<vector<AlignmentPath> > alignment_paths_batch;
+            alignment_path_finder_no_r.findPairedAlignmentPaths(&alignment_paths_batch, alignments, seq_lengths);
+
+            REQUIRE(alignment_paths_batch.size() == 2);
+
+            REQUIRE(alignment_paths_batch.front() == alignment_path_finder_no_r.findPairedAlignmentPaths(alignment_1, alignment_2));
+            REQUIRE(alignment_paths_batch.back() == alignment_path_finder_no_r.findPairedAlignmentPaths(alignment_1, alignment_2_rc));
+        }
+    }
+
     SECTION("Strand-specific paired-end multipath read alignment finds unidirectional alignment path(s)") {
 
         AlignmentPathFinder<vg::MultipathAlignment> alignment_path_finder_fr(paths_index, "fr", 1000, 0, true, 20, 0);
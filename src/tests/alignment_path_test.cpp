@@ -78,4 +78,37 @@ TEST_CASE("AlignmentPath can be created from AlignmentSearchPath") {
 		REQUIRE(alignment_search_path.path.empty());    	
 		REQUIRE(alignment_search_path.gbwt_search.first.empty());    	
     }    
-}
\ No newline at end of file
+}
+
+
+TEST_CASE("AlignmentSearchPath prefix can be shared using SearchPathArena") {
+	
+	AlignmentSearchPath alignment_search_path;
+	alignment_search_path.path = {gbwt::Node::encode(1, false), gbwt::Node::encode(2, false), gbwt::Node::encode(4, true)};
+
+	const vector<gbwt::node_type> path = alignment_search_path.path;
+
+	SearchPathArena search_path_arena;
+	alignment_search_path.foldPathPrefix(&search_path_arena);
+
+	REQUIRE(alignment_search_path.path_prefix_length == 2);
+	REQUIRE(alignment_search_path.path == vector<gbwt::node_type>({gbwt::Node::encode(4, true)}));
+	REQUIRE(alignment_search_path.pathLength() == 3);
+
+	AlignmentSearchPath alignment_search_path_branch = alignment_search_path;
+	alignment_search_path_branch.path.emplace_back(gbwt::Node::encode(5, false));
+	alignment_search_path_branch.foldPathPrefix(&search_path_arena);
+
+	REQUIRE(alignment_search_path_branch.path_prefix_length == 3);
+	REQUIRE(alignment_search_path_branch.pathLength() == 4);
+
+	alignment_search_path.unfoldPathPrefix(search_path_arena);
+	alignment_search_path_branch.unfoldPathPrefix(search_path_arena);
+
+	REQUIRE(alignment_search_path.path == path);
+	REQUIRE(alignment_search_path.path_prefix_length == 0);
+
+	REQUIRE(alignment_search_path_branch.path.size() == 4);
+	REQUIRE(equal(path.begin(), path.end(), alignment_search_path_branch.path.begin()));
+	REQUIRE(alignment_search_path_branch.path.back() == gbwt::Node::encode(5, false));
+}
@@ -0,0 +1,110 @@
+
+#include "catch.hpp"
+
+#include <fstream>
+#include <cstdio>
+
+#include <google/protobuf/io/coded_stream.h>
+#include <google/protobuf/io/zero_copy_stream_impl.h>
+
+#include "../alignment_reader.hpp"
+
+
+static void writeMessageGroup(ofstream * alignments_ostream, const vector<string> & messages) {
+
+    google::protobuf::io::OstreamOutputStream zero_copy_ostream(alignments_ostream);
+    google::protobuf::io::CodedOutputStream coded_ostream(&zero_copy_ostream);
+
+    coded_ostream.WriteVarint64(messages.size());
+
+    for (auto & message: messages) {
+
+        coded_ostream.WriteVarint32(message.size());
+        coded_ostream.WriteString(message);
+    }
+}
+
+TEST_CASE("Alignment reader reads batches of serialized alignments") {
+
+    const string alignments_filename = "alignment_reader_test.gam";
+
+    ofstream alignments_ostream(alignments_filename, ios::binary);
+
+    writeMessageGroup(&alignments_ostream, {"GAM", "alignment_1", "alignment_2"});
+    writeMessageGroup(&alignments_ostream, {"GAM"});
+    writeMessageGroup(&alignments_ostream, {"alignment_3", ""});
+
+    alignments_ostream.close();
+
+    vector<string> serialized_alignments;
+
+    SECTION("Type tags are skipped and batches are filled") {
+
+        AlignmentReader alignment_reader(alignments_filename, 2, 2);
+
+        REQUIRE(alignment_reader.nextBatch(&serialized_alignments));
+        REQUIRE(serialized_alignments == vector<string>({"alignment_1", "alignment_2"}));
+
+        REQUIRE(alignment_reader.nextBatch(&serialized_alignments));
+        REQUIRE(serialized_alignments == vector<string>({"alignment_3", ""}));
+
+        REQUIRE(!alignment_reader.nextBatch(&serialized_alignments));
+        REQUIRE(serialized_alignments.empty());
+    }
+
+    SECTION("Last batch can be partial") {
+
+        AlignmentReader alignment_reader(alignments_filename, 3, 1);
+
+        REQUIRE(alignment_reader.nextBatch(&serialized_alignments));
+        REQUIRE(serialized_alignments.size() == 3);
+
+        REQUIRE(alignment_reader.nextBatch(&serialized_alignments));
+        REQUIRE(serialized_alignments == vector<string>({""}));
+
+        REQUIRE(!alignment_reader.nextBatch(&serialized_alignments));
+    }
+
+    SECTION("Buffered batches are returned first") {
+
+        AlignmentReader alignment_reader(alignments_filename, 2, 1);
+
+        auto buffered_batch = alignment_reader.bufferBatch();
+        REQUIRE(buffered_batch);
+        REQUIRE(buffered_batch->front() == "alignment_1");
+
+        REQUIRE(alignment_reader.bufferBatch());
+        REQUIRE(!alignment_reader.bufferBatch());
+
+        REQUIRE(alignment_reader.nextBatch(&serialized_alignments));
+        REQUIRE(serialized_alignments == vector<string>({"alignment_1", "alignment_2"}));
+
+        REQUIRE(alignment_reader.nextBatch(&serialized_alignments));
+        REQUIRE(serialized_alignments == vector<string>({"alignment_3", ""}));
+
+        REQUIRE(!alignment_reader.nextBatch(&serialized_alignments));
+    }
+
+    SECTION("Truncated file throws error") {
+
+        ofstream truncated_alignments_ostream(alignments_filename, ios::binary | ios::app);
+
+        // Group of two messages with only one message
+        truncated_alignments_ostream.write("\x02\x01x", 3);
+        truncated_alignments_ostream.close();
+
+        AlignmentReader alignment_reader(alignments_filename, 2, 1);
+
+        REQUIRE(alignment_reader.nextBatch(&serialized_alignments));
+        REQUIRE(alignment_reader.nextBatch(&serialized_alignments));
+        REQUIRE_THROWS(alignment_reader.nextBatch(&serialized_alignments));
+    }
+
+    SECTION("Reader can be destroyed before all batches are read") {
+
+        AlignmentReader alignment_reader(alignments_filename, 1, 1);
+        REQUIRE(alignment_reader.nextBatch(&serialized_alignments));
+    }
+
+    remove(alignments_filename.c_str());
+}
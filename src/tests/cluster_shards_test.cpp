@@ -0,0 +1,182 @@
+#include "catch.hpp"
+
+#include <fstream>
+#include <sstream>
+#include <cstdio>
+
+#include "../cluster_shards.hpp"
+#include "../threaded_output_writer.hpp"
+#include "../utils.hpp"
+
+
+static string readFile(const string & filename) {
+
+    ifstream file_istream(filename, ios::binary);
+
+    stringstream file_sstream;
+    file_sstream << file_istream.rdbuf();
+
+    return file_sstream.str();
+}
+
+TEST_CASE("Merged shard estimates equal unsharded estimates") {
+
+    const uint32_t num_clusters = 6;
+    const uint32_t num_shards = 2;
+
+    vector<pair<uint32_t, PathClusterEstimates> > path_cluster_estimates(num_clusters);
+    vector<vector<pair<uint32_t, PathClusterEstimates> > > shard_path_cluster_estimates(num_shards);
+
+    double total_transcript_count = 0;
+    vector<double> shard_total_transcript_count(num_shards, 0);
+
+    for (uint32_t i = 0; i < num_clusters; ++i) {
+
+        path_cluster_estimates.at(i).first = i;
+        path_cluster_estimates.at(i).second.paths = vector<PathInfo>(2, PathInfo(""));
+        path_cluster_estimates.at(i).second.abundances = Eigen::RowVectorXd(1, 2);
+
+        for (uint32_t j = 0; j < 2; ++j) {
+
+            PathInfo * path = &(path_cluster_estimates.at(i).second.paths.at(j));
+
+            path->name = "path" + to_string(i) + "_" + to_string(j);
+            path->length = 1000 + 7 * i + j;
+            path->effective_length = 813.1234567 + 7 * i + j / 3.0;
+
+            path_cluster_estimates.at(i).second.abundances(0, j) = (i + 1) * 10.123456789 / (j + 3);
+
+            total_transcript_count += path_cluster_estimates.at(i).second.abundances(0, j) / path->effective_length;
+            shard_total_transcript_count.at(i % num_shards) += path_cluster_estimates.at(i).second.abundances(0, j) / path->effective_length;
+        }
+
+        // Shards contain the clusters in a different order.
+        shard_path_cluster_estimates.at(i % num_shards).insert(shard_path_cluster_estimates.at(i % num_shards).begin(), path_cluster_estimates.at(i));
+    }
+
+    AbundanceEstimatesWriter unsharded_estimates_writer("cluster_shards_test_unsharded", 1, total_transcript_count);
+    unsharded_estimates_writer.addEstimates(path_cluster_estimates);
+    unsharded_estimates_writer.close();
+
+    vector<string> unsorted_shard_estimates_filenames;
+    vector<string> shard_estimates_filenames;
+
+    double merged_total_transcript_count = 0;
+
+    for (uint32_t i = 0; i < num_shards; ++i) {
+
+        unsorted_shard_estimates_filenames.emplace_back("cluster_shards_test_shard" + to_string(i + 1) + "_estimates.tmp");
+        shard_estimates_filenames.emplace_back("cluster_shards_test_shard" + to_string(i + 1) + "_estimates.bin");
+
+        ClusterEstimatesWriter shard_estimates_writer(unsorted_shard_estimates_filenames.back(), 1);
+
+        for (auto & cur_path_cluster_estimates: shard_path_cluster_estimates.at(i)) {
+
+            shard_estimates_writer.addEstimates(cur_path_cluster_estimates);
+        }
+
+        shard_estimates_writer.close();
+
+        REQUIRE(sortClusterEstimates(shard_estimates_filenames.back(), unsorted_shard_estimates_filenames.back(), 1));
+
+        const string transcript_count_filename = "cluster_shards_test_shard" + to_string(i + 1) + "_transcript_count.txt";
+        REQUIRE(writeShardTranscriptCount(transcript_count_filename, shard_total_transcript_count.at(i)));
+
+        double read_transcript_count = 0;
+        REQUIRE(readShardTranscriptCount(transcript_count_filename, &read_transcript_count));
+
+        REQUIRE(read_transcript_count == shard_total_transcript_count.at(i));
+        merged_total_transcript_count += read_transcript_count;
+
+        remove(transcript_count_filename.c_str());
+    }
+
+    REQUIRE(!mergeClusterEstimates("cluster_shards_test_estimates.tmp", unsorted_shard_estimates_filenames, 1));
+    REQUIRE(mergeClusterEstimates("cluster_shards_test_estimates.tmp", shard_estimates_filenames, 1));
+
+    vector<pair<uint32_t, PathClusterEstimates> > merged_path_cluster_estimates;
+
+    ClusterEstimatesReader * cluster_estimates_reader = new ClusterEstimatesReader("cluster_shards_test_estimates.tmp");
+    merged_path_cluster_estimates.emplace_back();
+
+    while (cluster_estimates_reader->readEstimates(&(merged_path_cluster_estimates.back()))) {
+
+        merged_path_cluster_estimates.emplace_back();
+    }
+
+    merged_path_cluster_estimates.pop_back();
+    delete cluster_estimates_reader;
+
+    REQUIRE(merged_path_cluster_estimates.size() == num_clusters);
+
+    for (uint32_t i = 0; i < num_clusters; ++i) {
+
+        REQUIRE(merged_path_cluster_estimates.at(i).first == i);
+        REQUIRE(merged_path_cluster_estimates.at(i).second.abundances == path_cluster_estimates.at(i).second.abundances);
+    }
+
+    AbundanceEstimatesWriter merged_estimates_writer("cluster_shards_test_merged", 1, merged_total_transcript_count);
+    merged_estimates_writer.addEstimates(merged_path_cluster_estimates);
+    merged_estimates_writer.close();
+
+    REQUIRE(!readFile("cluster_shards_test_unsharded.txt").empty());
+    REQUIRE(readFile("cluster_shards_test_merged.txt") == readFile("cluster_shards_test_unsharded.txt"));
+
+    SECTION("Missing shard transcript count file can not be read") {
+
+        double read_transcript_count = 0;
+        REQUIRE(!readShardTranscriptCount("cluster_shards_test_shard3_transcript_count.txt", &read_transcript_count));
+    }
+
+    for (uint32_t i = 0; i < num_shards; ++i) {
+
+        remove(unsorted_shard_estimates_filenames.at(i).c_str());
+        remove(shard_estimates_filenames.at(i).c_str());
+    }
+
+    remove("cluster_shards_test_estimates.tmp");
+    remove("cluster_shards_test_unsharded.txt");
+    remove("cluster_shards_test_merged.txt");
+}
+
+
+TEST_CASE("Truncated cluster estimates file can not be read") {
+
+    pair<uint32_t, PathClusterEstimates> path_cluster_estimates;
+
+    path_cluster_estimates.first = 3;
+    path_cluster_estimates.second.paths = vector<PathInfo>(2, PathInfo("path"));
+    path_cluster_estimates.second.abundances = Eigen::RowVectorXd::Constant(1, 2, 0.5);
+
+    ClusterEstimatesWriter cluster_estimates_writer("cluster_shards_test_estimates.bin", 1);
+
+    cluster_estimates_writer.addEstimates(path_cluster_estimates);
+    cluster_estimates_writer.addEstimates(path_cluster_estimates);
+    cluster_estimates_writer.close();
+
+    const string estimates = readFile("cluster_shards_test_estimates.bin");
+    REQUIRE(estimates.size() > 10);
+
+    ofstream truncated_estimates_ostream("cluster_shards_test_truncated_estimates.bin", ios::binary);
+    truncated_estimates_ostream << estimates.substr(0, estimates.size() - 10);
+    truncated_estimates_ostream.close();
+
+    ClusterEstimatesReader * cluster_estimates_reader = new ClusterEstimatesReader("cluster_shards_test_truncated_estimates.bin");
+
+    REQUIRE(cluster_estimates_reader->readEstimates(&path_cluster_estimates));
+    REQUIRE(path_cluster_estimates.first == 3);
+    REQUIRE(cluster_estimates_reader->isValid());
+
+    REQUIRE(!cluster_estimates_reader->readEstimates(&path_cluster_estimates));
+    REQUIRE(!cluster_estimates_reader->isValid());
+
+    delete cluster_estimates_reader;
+
+    REQUIRE(!sortClusterEstimates("cluster_shards_test_sorted_estimates.bin", "cluster_shards_test_truncated_estimates.bin", 1));
+    REQUIRE(!mergeClusterEstimates("cluster_shards_test_merged_estimates.bin", {"cluster_shards_test_estimates.bin", "cluster_shards_test_truncated_estimates.bin"}, 1));
+
+    remove("cluster_shards_test_estimates.bin");
+    remove("cluster_shards_test_truncated_estimates.bin");
+    remove("cluster_shards_test_sorted_estimates.bin");
+    remove("cluster_shards_test_merged_estimates.bin");
+}
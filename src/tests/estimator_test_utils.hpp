@@ -0,0 +1,54 @@
+
+#ifndef RPVG_SRC_TESTS_ESTIMATORTESTUTILS_HPP
+#define RPVG_SRC_TESTS_ESTIMATORTESTUTILS_HPP
+
+#include <vector>
+#include <random>
+#include <functional>
+
+#include "catch.hpp"
+
+#include "../path_cluster_estimates.hpp"
+
+using namespace std;
+
+
+// Runs an estimator on a single thread and on multiple threads (from within
+// a parallel region) with the same seed, requires that both give identical
+// estimates and returns them.
+inline PathClusterEstimates requireThreadIndependentEstimates(const function<void(PathClusterEstimates *, mt19937 *)> & estimate, const PathClusterEstimates & init_path_cluster_estimates, const uint32_t num_threads, const uint32_t seed) {
+
+    PathClusterEstimates path_cluster_estimates_1 = init_path_cluster_estimates;
+    mt19937 mt_rng_1(seed);
+
+    estimate(&path_cluster_estimates_1, &mt_rng_1);
+
+    PathClusterEstimates path_cluster_estimates_2 = init_path_cluster_estimates;
+    mt19937 mt_rng_2(seed);
+
+    #pragma omp parallel num_threads(num_threads)
+    {
+        #pragma omp single
+        {
+            estimate(&path_cluster_estimates_2, &mt_rng_2);
+        }
+    }
+
+    REQUIRE(path_cluster_estimates_1.abundances == path_cluster_estimates_2.abundances);
+
+    REQUIRE(path_cluster_estimates_1.path_group_sets == path_cluster_estimates_2.path_group_sets);
+    REQUIRE(path_cluster_estimates_1.posteriors == path_cluster_estimates_2.posteriors);
+
+    REQUIRE(path_cluster_estimates_1.gibbs_read_count_samples.size() == path_cluster_estimates_2.gibbs_read_count_samples.size());
+
+    for (size_t i = 0; i < path_cluster_estimates_1.gibbs_read_count_samples.size(); ++i) {
+
+        REQUIRE(path_cluster_estimates_1.gibbs_read_count_samples.at(i).path_ids == path_cluster_estimates_2.gibbs_read_count_samples.at(i).path_ids);
+        REQUIRE(path_cluster_estimates_1.gibbs_read_count_samples.at(i).samples == path_cluster_estimates_2.gibbs_read_count_samples.at(i).samples);
+    }
+
+    return path_cluster_estimates_1;
+}
+
+
+#endif
@@ -17,6 +17,23 @@ TEST_CASE("FragmentLengthDist is valid normal distribution") {
     REQUIRE(Utils::doubleCompare(fragment_length_dist.logProb(9), fragment_length_dist.logProb(11)));
     REQUIRE(Utils::doubleCompare(fragment_length_dist.logProb(10000), -12475014.11208571307361));
 
+    SECTION("Fragment lengths are quantized by log probability") {
+
+        REQUIRE(fragment_length_dist.quantizedLength(10) == 10);
+        REQUIRE(fragment_length_dist.quantizedLength(9) == 11);
+        REQUIRE(fragment_length_dist.quantizedLength(15) == 15);
+        REQUIRE(fragment_length_dist.quantizedLength(10000) == 10000);
+
+        for (uint32_t i = 0; i < 100; ++i) {
+
+            REQUIRE(abs(fragment_length_dist.logProb(fragment_length_dist.quantizedLength(i)) - fragment_length_dist.logProb(i)) < 0.01);
+        }
+
+        FragmentLengthDist wide_fragment_length_dist(300, 50);
+
+        REQUIRE(wide_fragment_length_dist.quantizedLength(301) == 300);
+        REQUIRE(wide_fragment_length_dist.quantizedLength(299) == 300);
+    }
 }
 
 TEST_CASE("Fragment length distribution parameters can be parsed from vg::Alignment") {
@@ -0,0 +1,150 @@
+
+#include "catch.hpp"
+
+#include "../multinomial_sampler.hpp"
+#include "../utils.hpp"
+
+
+const uint32_t num_test_samples = 100000;
+
+double binomialProb(const uint32_t num_trials, const double prob, const uint32_t value) {
+
+	return exp(lgamma(num_trials + 1) - lgamma(value + 1) - lgamma(num_trials - value + 1) + value * log(prob) + (num_trials - value) * log(1 - prob));
+}
+
+TEST_CASE("Xoshiro256StarStar random generator is reproducible") {
+    
+	Xoshiro256StarStar rng_1(10);
+	Xoshiro256StarStar rng_2(10);
+	Xoshiro256StarStar rng_3(11);
+
+	bool is_different = false;
+
+	for (size_t i = 0; i < 100; ++i) {
+
+		auto value_1 = rng_1();
+
+		REQUIRE(value_1 == rng_2());
+		is_different = (is_different || value_1 != rng_3());
+	}
+
+	REQUIRE(is_different);
+
+	for (size_t i = 0; i < 100; ++i) {
+
+		auto value = rng_1.uniform();
+
+		REQUIRE(value >= 0);
+		REQUIRE(value < 1);
+	}
+}
+
+TEST_CASE("Binomial samples follow binomial distribution") {
+
+	MultinomialSampler multinomial_sampler;
+	Xoshiro256StarStar rng(1);
+
+	REQUIRE(multinomial_sampler.sampleBinomial(0, 0.5, &rng) == 0);
+	REQUIRE(multinomial_sampler.sampleBinomial(10, 0, &rng) == 0);
+	REQUIRE(multinomial_sampler.sampleBinomial(10, 1, &rng) == 10);
+
+	// Covers inversion (small mean), BTRD (large mean) and the symmetric 
+	// case (probability above 0.5).
+	vector<pair<uint32_t, double> > parameters = {{20, 0.2}, {100, 0.4}, {50, 0.85}, {5000, 0.01}};
+
+	for (auto & parameter: parameters) {
+
+		vector<uint32_t> value_counts(parameter.first + 1, 0);
+
+		double values_sum = 0;
+		double values_sq_sum = 0;
+
+		for (size_t i = 0; i < num_test_samples; ++i) {
+
+			auto value = multinomial_sampler.sampleBinomial(parameter.first, parameter.second, &rng);
+			REQUIRE(value <= parameter.first);
+
+			value_counts.at(value)++;
+
+			values_sum += value;
+			values_sq_sum += value * static_cast<double>(value);
+		}
+
+		const double mean = parameter.first * parameter.second;
+		const double var = mean * (1 - parameter.second);
+
+		const double sample_mean = values_sum / num_test_samples;
+		const double sample_var = values_sq_sum / num_test_samples - sample_mean * sample_mean;
+
+		REQUIRE(fabs(sample_mean - mean) < 5 * sqrt(var / num_test_samples));
+		REQUIRE(fabs(sample_var - var) < 0.05 * var);
+
+		for (size_t i = 0; i < value_counts.size(); ++i) {
+
+			const double prob = binomialProb(parameter.first, parameter.second, i);
+			REQUIRE(fabs(value_counts.at(i) / static_cast<double>(num_test_samples) - prob) < 5 * sqrt(prob * (1 - prob) / num_test_samples) + 1e-4);
+		}
+	}
+}
+
+TEST_CASE("Multinomial samples follow multinomial distribution") {
+
+	MultinomialSampler multinomial_sampler;
+	Xoshiro256StarStar rng(2);
+
+	const vector<double> probs = {0.1, 0, 0.45, 0.05, 0.4};
+
+	SECTION("Single trial samples follow categorical distribution") {
+
+		vector<uint32_t> counts(probs.size(), 0);
+
+		for (size_t i = 0; i < num_test_samples; ++i) {
+
+			multinomial_sampler.sample(&(counts.front()), &(probs.front()), probs.size(), 1, &rng);
+		}
+
+		REQUIRE(accumulate(counts.begin(), counts.end(), 0) == num_test_samples);
+		REQUIRE(counts.at(1) == 0);
+
+		for (size_t i = 0; i < probs.size(); ++i) {
+
+			REQUIRE(fabs(counts.at(i) / static_cast<double>(num_test_samples) - probs.at(i)) < 5 * sqrt(probs.at(i) * (1 - probs.at(i)) / num_test_samples) + 1e-4);
+		}
+	}
+
+	SECTION("Multiple trial samples follow multinomial distribution") {
+
+		const uint32_t num_trials = 40;
+		const uint32_t num_multi_test_samples = num_test_samples / 10;
+
+		vector<double> counts_sum(probs.size(), 0);
+		vector<double> counts_sq_sum(probs.size(), 0);
+
+		for (size_t i = 0; i < num_multi_test_samples; ++i) {
+
+			vector<uint32_t> counts(probs.size(), 0);
+			multinomial_sampler.sample(&(counts.front()), &(probs.front()), probs.size(), num_trials, &rng);
+
+			REQUIRE(accumulate(counts.begin(), counts.end(), 0) == num_trials);
+			REQUIRE(counts.at(1) == 0);
+
+			for (size_t j = 0; j < probs.size(); ++j) {
+
+				counts_sum.at(j) += counts.at(j);
+				counts_sq_sum.at(j) += counts.at(j) * counts.at(j);
+			}
+		}
+
+		for (size_t i = 0; i < probs.size(); ++i) {
+
+			const double mean = num_trials * probs.at(i);
+			const double var = mean * (1 - probs.at(i));
+
+			const double sample_mean = counts_sum.at(i) / num_multi_test_samples;
+			const double sample_var = counts_sq_sum.at(i) / num_multi_test_samples - sample_mean * sample_mean;
+
+			REQUIRE(fabs(sample_mean - mean) < 5 * sqrt(var / num_multi_test_samples) + 1e-4);
+			REQUIRE(fabs(sample_var - var) < 0.1 * var + 1e-4);
+		}
+	}
+}
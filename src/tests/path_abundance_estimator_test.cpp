@@ -1,13 +1,17 @@
 
 #include "catch.hpp"
 
+#include <random>
+#include <sstream>
+
 #include "../path_abundance_estimator.hpp"
 #include "../utils.hpp"
+#include "estimator_test_utils.hpp"
 
 
 TEST_CASE("Weighted minimum path cover can be found") {
     
-    auto path_abundance_estimator = MinimumPathAbundanceEstimator(1, 1, 1, 1, 1);
+    auto path_abundance_estimator = MinimumPathAbundanceEstimator(1, 1, 1, 1, 1, 1);
 
     Utils::ColMatrixXb read_path_cover(4, 3);
 	read_path_cover << 1, 0, 1, 0, 1, 0, 1, 0, 0, 0, 1, 1;
@@ -27,3 +31,338 @@ TEST_CASE("Weighted minimum path cover can be found") {
 	}
 }
 
+static ReadPathProbabilities createReadPathProbabilities(const uint32_t read_count, const double noise_prob, const vector<pair<double, vector<uint32_t> > > & path_probs) {
+
+    stringstream read_path_probs_sstream;
+
+    Utils::writeBinary<uint32_t>(&read_path_probs_sstream, read_count);
+    Utils::writeBinary<double>(&read_path_probs_sstream, noise_prob);
+    Utils::writeBinary<double>(&read_path_probs_sstream, pow(10, -8));
+    Utils::writeBinary<uint32_t>(&read_path_probs_sstream, path_probs.size());
+
+    for (auto & path_probs_group: path_probs) {
+
+        Utils::writeBinary<double>(&read_path_probs_sstream, path_probs_group.first);
+        Utils::writeBinary<uint32_t>(&read_path_probs_sstream, path_probs_group.second.size());
+
+        for (auto & path_idx: path_probs_group.second) {
+
+            Utils::writeBinary<uint32_t>(&read_path_probs_sstream, path_idx);
+        }
+    }
+
+    ReadPathProbabilities read_path_probs;
+    read_path_probs.deserialize(&read_path_probs_sstream);
+
+    return read_path_probs;
+}
+
+class TestPathAbundanceEstimator : public PathAbundanceEstimator {
+
+    public:
+
+        TestPathAbundanceEstimator() : PathAbundanceEstimator(10000, 0.001, 0, 1, 1, pow(10, -8)) {}
+
+        using PathAbundanceEstimator::constructProbabilityMatrix;
+        using PathAbundanceEstimator::detractNoiseAndNormalizeProbabilityMatrix;
+        using PathAbundanceEstimator::EMAbundanceEstimator;
+};
+
+TEST_CASE("Batched path abundance estimates equal single cluster estimates") {
+
+    const uint32_t num_clusters = 8;
+
+    vector<vector<ReadPathProbabilities> > cluster_probs(num_clusters);
+    vector<uint32_t> cluster_num_paths(num_clusters);
+
+    for (uint32_t i = 0; i < num_clusters; ++i) {
+
+        cluster_num_paths.at(i) = 2 + i;
+
+        for (uint32_t j = 0; j < 3 + 2 * i; ++j) {
+
+            const uint32_t path_idx = j % cluster_num_paths.at(i);
+            cluster_probs.at(i).emplace_back(createReadPathProbabilities(1 + j % 3, 0.05, {{0.6, {path_idx}}, {0.35, {(path_idx + 1) % cluster_num_paths.at(i)}}}));
+        }
+    }
+
+    // Cluster without reads.
+    cluster_probs.at(2).clear();
+
+    TestPathAbundanceEstimator path_abundance_estimator;
+
+    vector<PathClusterEstimates> single_path_cluster_estimates(num_clusters);
+    vector<PathClusterEstimates> batch_path_cluster_estimates(num_clusters);
+
+    vector<PathClusterEstimates *> batch_path_cluster_estimates_ptrs;
+    vector<const vector<ReadPathProbabilities> *> batch_cluster_probs;
+
+    vector<mt19937> mt_rngs(num_clusters);
+    vector<mt19937 *> mt_rng_ptrs;
+
+    for (uint32_t i = 0; i < num_clusters; ++i) {
+
+        single_path_cluster_estimates.at(i).paths = vector<PathInfo>(cluster_num_paths.at(i), PathInfo(""));
+        batch_path_cluster_estimates.at(i).paths = single_path_cluster_estimates.at(i).paths;
+
+        mt19937 mt_rng(i);
+        path_abundance_estimator.estimate(&(single_path_cluster_estimates.at(i)), cluster_probs.at(i), &mt_rng);
+
+        batch_path_cluster_estimates_ptrs.emplace_back(&(batch_path_cluster_estimates.at(i)));
+        batch_cluster_probs.emplace_back(&(cluster_probs.at(i)));
+
+        mt_rngs.at(i).seed(i);
+        mt_rng_ptrs.emplace_back(&(mt_rngs.at(i)));
+    }
+
+    path_abundance_estimator.estimateBatch(batch_path_cluster_estimates_ptrs, batch_cluster_probs, mt_rng_ptrs);
+
+    for (uint32_t i = 0; i < num_clusters; ++i) {
+
+        REQUIRE(batch_path_cluster_estimates.at(i).abundances.cols() == cluster_num_paths.at(i));
+        REQUIRE(batch_path_cluster_estimates.at(i).abundances.isApprox(single_path_cluster_estimates.at(i).abundances, pow(10, -8)));
+    }
+
+    REQUIRE(batch_path_cluster_estimates.at(2).abundances.isZero());
+    REQUIRE(Utils::doubleCompare(batch_path_cluster_estimates.at(3).abundances.sum(), 18 * (1 - 0.05)));
+
+    SECTION("Batched path abundance estimates equal estimates from the unbatched EM") {
+
+        for (uint32_t i = 0; i < num_clusters; ++i) {
+
+            if (cluster_probs.at(i).empty()) {
+
+                continue;
+            }
+
+            Utils::ColMatrixXd read_path_probs;
+            Utils::ColVectorXd noise_probs;
+            Utils::RowVectorXd read_counts;
+
+            path_abundance_estimator.constructProbabilityMatrix(&read_path_probs, &noise_probs, &read_counts, cluster_probs.at(i), cluster_num_paths.at(i));
+            path_abundance_estimator.detractNoiseAndNormalizeProbabilityMatrix(&read_path_probs, &noise_probs, &read_counts);
+
+            PathClusterEstimates path_cluster_estimates;
+            path_cluster_estimates.initEstimates(cluster_num_paths.at(i), 0, false);
+
+            ProbabilityMatrixBuffer read_path_probs_buffer;
+            path_abundance_estimator.EMAbundanceEstimator(&path_cluster_estimates, ProbabilityMatrixView(read_path_probs, read_counts), read_counts.sum(), &read_path_probs_buffer);
+            path_cluster_estimates.abundances *= read_counts.sum();
+
+            REQUIRE(path_cluster_estimates.abundances.isApprox(batch_path_cluster_estimates.at(i).abundances, pow(10, -8)));
+        }
+    }
+}
+
+TEST_CASE("Path abundances of trivial clusters are uniform over the read paths") {
+
+    vector<ReadPathProbabilities> cluster_probs;
+    cluster_probs.emplace_back(createReadPathProbabilities(2, 0.1, {{0.9, {0, 2}}}));
+    cluster_probs.emplace_back(createReadPathProbabilities(3, 0.2, {{0, {1}}, {0.8, {0, 2}}}));
+
+    PathAbundanceEstimator path_abundance_estimator(10000, 0.001, 0, 1, 1, pow(10, -8));
+
+    PathClusterEstimates path_cluster_estimates;
+    path_cluster_estimates.paths = vector<PathInfo>(3, PathInfo(""));
+
+    mt19937 mt_rng(1);
+    path_abundance_estimator.estimate(&path_cluster_estimates, cluster_probs, &mt_rng);
+
+    REQUIRE(path_cluster_estimates.abundances.cols() == 3);
+    REQUIRE(Utils::doubleCompare(path_cluster_estimates.abundances(0, 0), (2 * 0.9 + 3 * 0.8) / 2));
+    REQUIRE(Utils::doubleCompare(path_cluster_estimates.abundances(0, 1), 0));
+    REQUIRE(Utils::doubleCompare(path_cluster_estimates.abundances(0, 2), (2 * 0.9 + 3 * 0.8) / 2));
+
+    SECTION("Clusters with different read paths are not trivial") {
+
+        cluster_probs.emplace_back(createReadPathProbabilities(1, 0.1, {{0.9, {1}}}));
+
+        path_abundance_estimator.estimate(&path_cluster_estimates, cluster_probs, &mt_rng);
+
+        REQUIRE(path_cluster_estimates.abundances.cols() == 3);
+        REQUIRE(Utils::doubleCompare(path_cluster_estimates.abundances.sum(), 2 * 0.9 + 3 * 0.8 + 0.9));
+        REQUIRE(abs(path_cluster_estimates.abundances(0, 1) - 0.9) < pow(10, -4));
+    }
+}
+
+TEST_CASE("Nested path abundance estimates are independent of the number of threads") {
+
+    const uint32_t num_groups = 2;
+    const uint32_t num_group_paths = 4;
+
+    mt19937 mt_rng(9);
+    uniform_real_distribution<double> prob_sampler(0, 1);
+
+    vector<ReadPathProbabilities> cluster_probs;
+
+    for (uint32_t i = 0; i < 40; ++i) {
+
+        vector<uint32_t> read_path_ids;
+
+        for (uint32_t j = 0; j < num_groups * num_group_paths; ++j) {
+
+            if (prob_sampler(mt_rng) < 0.4) {
+
+                read_path_ids.emplace_back(j);
+            }
+        }
+
+        if (!read_path_ids.empty()) {
+
+            cluster_probs.emplace_back(createReadPathProbabilities(1 + i % 2, 0.05, {{0.95 / read_path_ids.size(), read_path_ids}}));
+        }
+    }
+
+    sort(cluster_probs.begin(), cluster_probs.end());
+
+    PathClusterEstimates init_path_cluster_estimates;
+    init_path_cluster_estimates.paths = vector<PathInfo>(num_groups * num_group_paths, PathInfo(""));
+
+    for (uint32_t i = 0; i < init_path_cluster_estimates.paths.size(); ++i) {
+
+        init_path_cluster_estimates.paths.at(i).group_id = i / num_group_paths;
+    }
+
+    NestedPathAbundanceEstimator path_abundance_estimator(2, 200, false, false, 10000, 0.001, 5, 1, 1, pow(10, -8));
+
+    auto path_cluster_estimates = requireThreadIndependentEstimates([&](PathClusterEstimates * cur_path_cluster_estimates, mt19937 * cur_mt_rng) {
+
+        path_abundance_estimator.estimate(cur_path_cluster_estimates, cluster_probs, cur_mt_rng);
+
+    }, init_path_cluster_estimates, 4, 3);
+
+    REQUIRE(path_cluster_estimates.abundances.cols() == num_groups * num_group_paths);
+    REQUIRE(!path_cluster_estimates.gibbs_read_count_samples.empty());
+}
+
+TEST_CASE("Gibbs samples of multiple chains are independent of the number of threads") {
+
+    const uint32_t num_paths = 5;
+
+    // Not a multiple of the number of chains, such that the chains draw
+    // different numbers of samples.
+    const uint32_t num_gibbs_samples = 7;
+    const uint32_t num_gibbs_chains = 3;
+
+    mt19937 mt_rng(11);
+    uniform_real_distribution<double> prob_sampler(0, 1);
+
+    vector<ReadPathProbabilities> cluster_probs;
+
+    for (uint32_t i = 0; i < 30; ++i) {
+
+        vector<uint32_t> read_path_ids;
+
+        for (uint32_t j = 0; j < num_paths; ++j) {
+
+            if (prob_sampler(mt_rng) < 0.5) {
+
+                read_path_ids.emplace_back(j);
+            }
+        }
+
+        if (!read_path_ids.empty()) {
+
+            cluster_probs.emplace_back(createReadPathProbabilities(1 + i % 3, 0.05, {{0.95 / read_path_ids.size(), read_path_ids}}));
+        }
+    }
+
+    sort(cluster_probs.begin(), cluster_probs.end());
+
+    PathClusterEstimates init_path_cluster_estimates;
+    init_path_cluster_estimates.paths = vector<PathInfo>(num_paths, PathInfo(""));
+
+    PathAbundanceEstimator path_abundance_estimator(10000, 0.001, num_gibbs_samples, 1, num_gibbs_chains, pow(10, -8));
+
+    auto path_cluster_estimates = requireThreadIndependentEstimates([&](PathClusterEstimates * cur_path_cluster_estimates, mt19937 * cur_mt_rng) {
+
+        path_abundance_estimator.estimate(cur_path_cluster_estimates, cluster_probs, cur_mt_rng);
+
+    }, init_path_cluster_estimates, 4, 5);
+
+    REQUIRE(path_cluster_estimates.abundances.cols() == num_paths);
+    REQUIRE(path_cluster_estimates.gibbs_read_count_samples.size() == 1);
+    REQUIRE(path_cluster_estimates.gibbs_read_count_samples.front().samples.size() == num_paths);
+
+    for (auto & path_samples: path_cluster_estimates.gibbs_read_count_samples.front().samples) {
+
+        REQUIRE(path_samples.size() == num_gibbs_samples);
+    }
+}
+
+class TestNestedPathAbundanceEstimator : public NestedPathAbundanceEstimator {
+
+    public:
+
+        TestNestedPathAbundanceEstimator() : NestedPathAbundanceEstimator(2, 1, false, false, 100000, pow(10, -10), 0, 1, 1, pow(10, -8)) {}
+
+        using PathAbundanceEstimator::EMAbundanceEstimator;
+        using NestedPathAbundanceEstimator::initNearestSubsetEMAbundances;
+};
+
+TEST_CASE("Warm started EM abundances equal cold started EM abundances") {
+
+    Utils::ColMatrixXd read_path_probs(6, 4);
+    read_path_probs << 0.7, 0.2, 0.1, 0, 0.1, 0.6, 0.2, 0.1, 0, 0.3, 0.5, 0.2, 0.2, 0, 0.2, 0.6, 0.5, 0.5, 0, 0, 0, 0, 0.4, 0.6;
+
+    Utils::RowVectorXd read_counts(1, 6);
+    read_counts << 3, 2, 4, 1, 2, 3;
+
+    const vector<vector<uint32_t> > prev_path_subsets({{0, 1, 2}, {5, 6}});
+
+    vector<Utils::RowVectorXd> prev_abundances({Utils::RowVectorXd(1, 3), Utils::RowVectorXd(1, 2)});
+    prev_abundances.front() << 0.1, 0.7, 0.2;
+    prev_abundances.back() << 0.5, 0.5;
+
+    SECTION("Warm start converges to the unique maximum likelihood abundances") {
+
+        TestNestedPathAbundanceEstimator path_abundance_estimator;
+
+        const ProbabilityMatrixView subset_read_path_probs(read_path_probs, read_counts, {0, 1, 2, 3});
+        ProbabilityMatrixBuffer read_path_probs_buffer;
+
+        PathClusterEstimates cold_path_cluster_estimates;
+        cold_path_cluster_estimates.initEstimates(4, 0, false);
+
+        path_abundance_estimator.EMAbundanceEstimator(&cold_path_cluster_estimates, subset_read_path_probs, read_counts.sum(), &read_path_probs_buffer);
+
+        PathClusterEstimates warm_path_cluster_estimates;
+        path_abundance_estimator.initNearestSubsetEMAbundances(&(warm_path_cluster_estimates.abundances), subset_read_path_probs, {0, 1, 2, 3}, prev_path_subsets, prev_abundances);
+
+        REQUIRE(warm_path_cluster_estimates.abundances.cols() == 4);
+        REQUIRE(Utils::doubleCompare(warm_path_cluster_estimates.abundances.sum(), 1));
+        REQUIRE(warm_path_cluster_estimates.abundances(0, 1) > warm_path_cluster_estimates.abundances(0, 0));
+
+        path_abundance_estimator.EMAbundanceEstimator(&warm_path_cluster_estimates, subset_read_path_probs, read_counts.sum(), &read_path_probs_buffer);
+
+        REQUIRE(warm_path_cluster_estimates.abundances.isApprox(cold_path_cluster_estimates.abundances, pow(10, -6)));
+    }
+
+    SECTION("Warm start splits paths with identical read probabilities evenly") {
+
+        read_path_probs.col(2) = read_path_probs.col(1);
+        read_path_probs = read_path_probs.array().colwise() / read_path_probs.rowwise().sum().array();
+
+        TestNestedPathAbundanceEstimator path_abundance_estimator;
+
+        const ProbabilityMatrixView subset_read_path_probs(read_path_probs, read_counts, {0, 1, 2, 3});
+        ProbabilityMatrixBuffer read_path_probs_buffer;
+
+        PathClusterEstimates cold_path_cluster_estimates;
+        cold_path_cluster_estimates.initEstimates(4, 0, false);
+
+        path_abundance_estimator.EMAbundanceEstimator(&cold_path_cluster_estimates, subset_read_path_probs, read_counts.sum(), &read_path_probs_buffer);
+
+        PathClusterEstimates warm_path_cluster_estimates;
+        path_abundance_estimator.initNearestSubsetEMAbundances(&(warm_path_cluster_estimates.abundances), subset_read_path_probs, {0, 1, 2, 3}, prev_path_subsets, prev_abundances);
+
+        REQUIRE(warm_path_cluster_estimates.abundances.cols() == 4);
+        REQUIRE(Utils::doubleCompare(warm_path_cluster_estimates.abundances.sum(), 1));
+        REQUIRE(Utils::doubleCompare(warm_path_cluster_estimates.abundances(0, 1), warm_path_cluster_estimates.abundances(0, 2)));
+
+        path_abundance_estimator.EMAbundanceEstimator(&warm_path_cluster_estimates, subset_read_path_probs, read_counts.sum(), &read_path_probs_buffer);
+
+        REQUIRE(Utils::doubleCompare(warm_path_cluster_estimates.abundances(0, 1), warm_path_cluster_estimates.abundances(0, 2)));
+        REQUIRE(warm_path_cluster_estimates.abundances.isApprox(cold_path_cluster_estimates.abundances, pow(10, -6)));
+    }
+}
@@ -0,0 +1,223 @@
+
+#include "catch.hpp"
+
+#include <random>
+
+#include "../path_estimator.hpp"
+#include "../utils.hpp"
+#include "estimator_test_utils.hpp"
+
+
+class TestPathEstimator : public PathEstimator {
+
+    public:
+
+        TestPathEstimator() : PathEstimator(pow(10, -8)) {}
+
+        void estimate(PathClusterEstimates * path_cluster_estimates, const vector<ReadPathProbabilities> & cluster_probs, mt19937 * mt_rng) {}
+
+        using PathEstimator::calculatePathGroupPosteriorsFull;
+        using PathEstimator::calculatePathGroupPosteriorsBounded;
+        using PathEstimator::estimatePathGroupPosteriorsGibbs;
+};
+
+static void simulateProbabilityMatrix(Utils::ColMatrixXd * read_path_probs, Utils::ColVectorXd * noise_probs, Utils::RowVectorXd * read_counts, const uint32_t num_reads, const uint32_t num_paths, mt19937 * mt_rng) {
+
+    uniform_real_distribution<double> prob_sampler(0, 1);
+
+    *read_path_probs = Utils::ColMatrixXd::Zero(num_reads, num_paths);
+    *noise_probs = Utils::ColVectorXd(num_reads);
+    *read_counts = Utils::RowVectorXd(num_reads);
+
+    for (uint32_t i = 0; i < num_reads; ++i) {
+
+        // Every third read is mainly supported by path 0 and the others by path 2.
+        // Each read is also weakly supported by path i mod num_paths.
+        (*read_path_probs)(i, (i % 3 == 0) ? 0 : 2) = 0.6 + 0.4 * prob_sampler(*mt_rng);
+        (*read_path_probs)(i, i % num_paths) += 0.2 * prob_sampler(*mt_rng);
+
+        read_path_probs->row(i) /= read_path_probs->row(i).sum();
+
+        (*noise_probs)(i) = 0.01;
+        read_path_probs->row(i) *= (1 - (*noise_probs)(i));
+
+        (*read_counts)(i) = 1 + i % 2;
+    }
+}
+
+TEST_CASE("Gibbs sampled path group posteriors approximate exact posteriors") {
+
+    const uint32_t num_paths = 5;
+    const uint32_t group_size = 3;
+
+    mt19937 mt_rng(13);
+
+    Utils::ColMatrixXd read_path_probs;
+    Utils::ColVectorXd noise_probs;
+    Utils::RowVectorXd read_counts;
+
+    simulateProbabilityMatrix(&read_path_probs, &noise_probs, &read_counts, 40, num_paths, &mt_rng);
+
+    const vector<uint32_t> path_counts(num_paths, 1);
+
+    TestPathEstimator path_estimator;
+
+    PathClusterEstimates full_path_cluster_estimates;
+    path_estimator.calculatePathGroupPosteriorsFull(&full_path_cluster_estimates, read_path_probs, noise_probs, read_counts, path_counts, group_size);
+
+    PathClusterEstimates gibbs_path_cluster_estimates;
+    path_estimator.estimatePathGroupPosteriorsGibbs(&gibbs_path_cluster_estimates, read_path_probs, noise_probs, read_counts, path_counts, group_size, &mt_rng);
+
+    REQUIRE(gibbs_path_cluster_estimates.posteriors.size() == gibbs_path_cluster_estimates.path_group_sets.size());
+    REQUIRE(Utils::doubleCompare(accumulate(gibbs_path_cluster_estimates.posteriors.begin(), gibbs_path_cluster_estimates.posteriors.end(), 0.0), 1));
+
+    for (size_t i = 0; i < full_path_cluster_estimates.path_group_sets.size(); ++i) {
+
+        double gibbs_posterior = 0;
+
+        for (size_t j = 0; j < gibbs_path_cluster_estimates.path_group_sets.size(); ++j) {
+
+            if (gibbs_path_cluster_estimates.path_group_sets.at(j) == full_path_cluster_estimates.path_group_sets.at(i)) {
+
+                gibbs_posterior = gibbs_path_cluster_estimates.posteriors.at(j);
+            }
+        }
+
+        REQUIRE(abs(gibbs_posterior - full_path_cluster_estimates.posteriors.at(i)) < 0.05);
+    }
+}
+
+TEST_CASE("Gibbs sampled path group posteriors are independent of the number of threads") {
+
+    const uint32_t num_paths = 6;
+    const uint32_t group_size = 4;
+
+    mt19937 mt_rng(17);
+
+    Utils::ColMatrixXd read_path_probs;
+    Utils::ColVectorXd noise_probs;
+    Utils::RowVectorXd read_counts;
+
+    simulateProbabilityMatrix(&read_path_probs, &noise_probs, &read_counts, 50, num_paths, &mt_rng);
+
+    const vector<uint32_t> path_counts(num_paths, 1);
+
+    TestPathEstimator path_estimator;
+
+    auto path_cluster_estimates = requireThreadIndependentEstimates([&](PathClusterEstimates * cur_path_cluster_estimates, mt19937 * cur_mt_rng) {
+
+        path_estimator.estimatePathGroupPosteriorsGibbs(cur_path_cluster_estimates, read_path_probs, noise_probs, read_counts, path_counts, group_size, cur_mt_rng);
+
+    }, PathClusterEstimates(), 4, 3);
+
+    REQUIRE(!path_cluster_estimates.posteriors.empty());
+    REQUIRE(Utils::doubleCompare(accumulate(path_cluster_estimates.posteriors.begin(), path_cluster_estimates.posteriors.end(), 0.0), 1));
+}
+
+TEST_CASE("Exact path group posteriors are calculated for all groups") {
+
+    const uint32_t num_paths = 4;
+
+    mt19937 mt_rng(7);
+
+    Utils::ColMatrixXd read_path_probs;
+    Utils::ColVectorXd noise_probs;
+    Utils::RowVectorXd read_counts;
+
+    simulateProbabilityMatrix(&read_path_probs, &noise_probs, &read_counts, 30, num_paths, &mt_rng);
+
+    const vector<uint32_t> path_counts(num_paths, 1);
+
+    TestPathEstimator path_estimator;
+
+    PathClusterEstimates path_cluster_estimates;
+    path_estimator.calculatePathGroupPosteriorsFull(&path_cluster_estimates, read_path_probs, noise_probs, read_counts, path_counts, 1);
+
+    REQUIRE(path_cluster_estimates.path_group_sets.size() == num_paths);
+    REQUIRE(path_cluster_estimates.posteriors.size() == num_paths);
+
+    for (uint32_t i = 0; i < num_paths; ++i) {
+
+        REQUIRE(path_cluster_estimates.path_group_sets.at(i) == vector<uint32_t>({i}));
+    }
+
+    REQUIRE(Utils::doubleCompare(accumulate(path_cluster_estimates.posteriors.begin(), path_cluster_estimates.posteriors.end(), 0.0), 1));
+
+    SECTION("Path groups below precision are not stored") {
+
+        const uint32_t group_size = 4;
+
+        PathClusterEstimates group_path_cluster_estimates;
+        path_estimator.calculatePathGroupPosteriorsFull(&group_path_cluster_estimates, read_path_probs, noise_probs, read_counts, path_counts, group_size);
+
+        REQUIRE(!group_path_cluster_estimates.path_group_sets.empty());
+        REQUIRE(group_path_cluster_estimates.path_group_sets.size() < 35);
+        REQUIRE(group_path_cluster_estimates.posteriors.size() == group_path_cluster_estimates.path_group_sets.size());
+
+        double sum_posterior = 0;
+
+        for (size_t i = 0; i < group_path_cluster_estimates.path_group_sets.size(); ++i) {
+
+            auto & path_group = group_path_cluster_estimates.path_group_sets.at(i);
+
+            REQUIRE(path_group.size() == group_size);
+            REQUIRE(is_sorted(path_group.begin(), path_group.end()));
+
+            if (i > 0) {
+
+                REQUIRE(group_path_cluster_estimates.path_group_sets.at(i - 1) < path_group);
+            }
+
+            REQUIRE(group_path_cluster_estimates.posteriors.at(i) >= pow(10, -8));
+            sum_posterior += group_path_cluster_estimates.posteriors.at(i);
+        }
+
+        REQUIRE(sum_posterior > 0.999999);
+        REQUIRE(sum_posterior <= 1 + pow(10, -8));
+    }
+}
+
+TEST_CASE("Bounded path group posteriors equal exact posteriors within threshold") {
+
+    const uint32_t num_paths = 6;
+
+    mt19937 mt_rng(11);
+
+    Utils::ColMatrixXd read_path_probs;
+    Utils::ColVectorXd noise_probs;
+    Utils::RowVectorXd read_counts;
+
+    simulateProbabilityMatrix(&read_path_probs, &noise_probs, &read_counts, 30, num_paths, &mt_rng);
+
+    const vector<uint32_t> path_counts({1, 2, 1, 3, 1, 1});
+
+    TestPathEstimator path_estimator;
+
+    for (uint32_t group_size = 1; group_size <= 4; ++group_size) {
+
+        PathClusterEstimates full_path_cluster_estimates;
+        path_estimator.calculatePathGroupPosteriorsFull(&full_path_cluster_estimates, read_path_probs, noise_probs, read_counts, path_counts, group_size);
+
+        PathClusterEstimates bounded_path_cluster_estimates;
+        path_estimator.calculatePathGroupPosteriorsBounded(&bounded_path_cluster_estimates, read_path_probs, noise_probs, read_counts, path_counts, group_size, pow(10, -12));
+
+        REQUIRE(bounded_path_cluster_estimates.posteriors.size() == bounded_path_cluster_estimates.path_group_sets.size());
+        REQUIRE(is_sorted(bounded_path_cluster_estimates.path_group_sets.begin(), bounded_path_cluster_estimates.path_group_sets.end()));
+
+        uint32_t bounded_idx = 0;
+
+        for (size_t i = 0; i < full_path_cluster_estimates.path_group_sets.size(); ++i) {
+
+            if (full_path_cluster_estimates.posteriors.at(i) > pow(10, -6)) {
+
+                while (bounded_path_cluster_estimates.path_group_sets.at(bounded_idx) != full_path_cluster_estimates.path_group_sets.at(i)) {
+
+                    ++bounded_idx;
+                    REQUIRE(bounded_idx < bounded_path_cluster_estimates.path_group_sets.size());
+                }
+
+                REQUIRE(abs(bounded_path_cluster_estimates.posteriors.at(bounded_idx) - full_path_cluster_estimates.posteriors.at(i)) < pow(10, -8));
+            }
+        }
+    }
+}
@@ -0,0 +1,99 @@
+
+#include "catch.hpp"
+
+#include <random>
+
+#include "../path_group_likelihood_kernel.hpp"
+#include "../utils.hpp"
+
+
+static double calcDenseLogLikelihood(const vector<uint32_t> & path_group, const Utils::ColMatrixXd & read_path_probs, const Utils::ColVectorXd & noise_probs, const Utils::RowVectorXd & read_counts) {
+
+    Utils::ColVectorXd group_read_probs = noise_probs;
+
+    for (auto & path_idx: path_group) {
+
+        group_read_probs += (read_path_probs.col(path_idx) / static_cast<double>(path_group.size()));
+    }
+
+    return read_counts * group_read_probs.array().log().matrix();
+}
+
+TEST_CASE("Path group likelihood kernel equals dense log-likelihood") {
+
+    const uint32_t num_reads = 30;
+    const uint32_t num_paths = 5;
+    const uint32_t group_size = 3;
+
+    mt19937 mt_rng(5);
+    uniform_real_distribution<double> prob_sampler(0, 1);
+
+    Utils::ColMatrixXd read_path_probs = Utils::ColMatrixXd::Zero(num_reads, num_paths);
+    Utils::ColVectorXd noise_probs = Utils::ColVectorXd::Constant(num_reads, 0.01);
+    Utils::RowVectorXd read_counts(num_reads);
+
+    for (uint32_t i = 0; i < num_reads; ++i) {
+
+        for (uint32_t j = 0; j < num_paths; ++j) {
+
+            if (prob_sampler(mt_rng) < 0.5) {
+
+                read_path_probs(i, j) = prob_sampler(mt_rng);
+            }
+        }
+
+        read_counts(i) = 1 + i % 3;
+    }
+
+    PathGroupLikelihoodKernel likelihood_kernel(read_path_probs, noise_probs, read_counts, group_size);
+
+    REQUIRE(likelihood_kernel.numPaths() == num_paths);
+    REQUIRE(likelihood_kernel.groupSize() == group_size);
+
+    for (uint32_t i = 0; i < num_paths; ++i) {
+
+        REQUIRE(likelihood_kernel.pathReadIndices().at(i).size() == (read_path_probs.col(i).array() > 0).count());
+        REQUIRE(Utils::doubleCompare(likelihood_kernel.pathReadProbs().at(i).sum(), read_path_probs.col(i).sum() / group_size));
+    }
+
+    SECTION("Groups sharing prefixes reuse the prefix cache") {
+
+        PathGroupPrefixCache prefix_cache;
+
+        for (uint32_t i = 0; i < num_paths; ++i) {
+
+            for (uint32_t j = 0; j < num_paths; ++j) {
+
+                for (uint32_t k = 0; k < num_paths; ++k) {
+
+                    const vector<uint32_t> path_group({i, j, k});
+                    REQUIRE(abs(likelihood_kernel.logLikelihood(path_group, &prefix_cache) - calcDenseLogLikelihood(path_group, read_path_probs, noise_probs, read_counts)) < pow(10, -8));
+                }
+            }
+        }
+    }
+
+    SECTION("Groups with zero probability prefix reads are evaluated") {
+
+        noise_probs(0) = 0;
+        read_path_probs(0, 1) = 0.5;
+
+        PathGroupLikelihoodKernel zero_likelihood_kernel(read_path_probs, noise_probs, read_counts, group_size);
+        PathGroupPrefixCache prefix_cache;
+
+        for (uint32_t i = 0; i < num_paths; ++i) {
+
+            const vector<uint32_t> path_group({0, 0, i});
+            const double log_likelihood = zero_likelihood_kernel.logLikelihood(path_group, &prefix_cache);
+
+            if (read_path_probs(0, 0) + read_path_probs(0, i) > 0) {
+
+                REQUIRE(abs(log_likelihood - calcDenseLogLikelihood(path_group, read_path_probs, noise_probs, read_counts)) < pow(10, -8));
+
+            } else {
+
+                REQUIRE(std::isinf(log_likelihood));
+            }
+        }
+    }
+}
@@ -76,5 +76,133 @@ TEST_CASE("Path index can calculate path lengths") {
     	REQUIRE(Utils::doubleCompare(paths_index.effectivePathLength(0, fragment_length_dist), 18));
     	REQUIRE(Utils::doubleCompare(paths_index.effectivePathLength(1, fragment_length_dist), 1));
 	}
+
+	SECTION("Node successors exclude the endmarker and are cached") {
+
+		REQUIRE(paths_index.successors(gbwt::Node::encode(1, false)) == vector<gbwt::node_type>({gbwt::Node::encode(2, false), gbwt::Node::encode(3, false)}));
+		REQUIRE(paths_index.successors(gbwt::Node::encode(2, false)) == vector<gbwt::node_type>({gbwt::Node::encode(4, false)}));
+		REQUIRE(paths_index.successors(gbwt::Node::encode(4, false)).empty());
+		REQUIRE(paths_index.successors(gbwt::Node::encode(2, true)).empty());
+
+		REQUIRE(&paths_index.successors(gbwt::Node::encode(1, false)) == &paths_index.successors(gbwt::Node::encode(1, false)));
+	}
+
+	SECTION("Search extensions using decoded records equal search extensions") {
+
+		gbwt::FastLocate empty_r_index;
+		PathsIndex paths_index_no_r(gbwt_index, empty_r_index, graph);
+
+		vector<gbwt::node_type> start_nodes = {gbwt::Node::encode(1, false), gbwt::Node::encode(3, false), gbwt::Node::encode(1, false), gbwt::Node::encode(2, false), gbwt::Node::encode(3, false)};
+		vector<gbwt::node_type> extension_nodes = {gbwt::Node::encode(2, false), gbwt::Node::encode(4, false), gbwt::Node::encode(3, false), gbwt::Node::encode(4, false), gbwt::Node::encode(2, false)};
+
+		auto record_nodes = start_nodes;
+		record_nodes.emplace_back(gbwt::ENDMARKER);
+
+		REQUIRE(paths_index_no_r.decodesRecords());
+		REQUIRE(!paths_index.decodesRecords());
+
+		GBWTRecordBatch gbwt_records;
+		paths_index_no_r.decodeRecords(&gbwt_records, &record_nodes);
+
+		REQUIRE(record_nodes.size() == 4);
+		REQUIRE(gbwt_records.find(gbwt::Node::encode(1, false)));
+		REQUIRE(!gbwt_records.find(gbwt::Node::encode(4, false)));
+		REQUIRE(!gbwt_records.find(gbwt::ENDMARKER));
+
+		GBWTRecordBatch gbwt_records_r;
+		paths_index.decodeRecords(&gbwt_records_r, &record_nodes);
+
+		REQUIRE(!gbwt_records_r.find(gbwt::Node::encode(1, false)));
+
+		for (size_t i = 0; i < start_nodes.size(); ++i) {
+
+			pair<gbwt::SearchState, gbwt::size_type> gbwt_search;
+			paths_index.find(&gbwt_search, start_nodes.at(i));
+
+			auto gbwt_search_records = gbwt_search;
+			auto gbwt_search_records_no_r = gbwt_search;
+
+			paths_index.extend(&gbwt_search, extension_nodes.at(i));
+			paths_index.extend(&gbwt_search_records, extension_nodes.at(i), gbwt_records_r);
+			paths_index_no_r.extend(&gbwt_search_records_no_r, extension_nodes.at(i), gbwt_records);
+
+			REQUIRE(gbwt_search_records.first.empty() == gbwt_search.first.empty());
+			REQUIRE(gbwt_search_records_no_r.first.empty() == gbwt_search.first.empty());
+
+			if (!gbwt_search.first.empty()) {
+
+				REQUIRE(gbwt_search_records.first == gbwt_search.first);
+				REQUIRE(gbwt_search_records_no_r.first == gbwt_search.first);
+			}
+		}
+	}
+
+	SECTION("Paths without repeated nodes contain no cyclic nodes") {
+
+		for (uint32_t i = 1; i <= 4; ++i) {
+
+			REQUIRE(!paths_index.isCyclicNode(gbwt::Node::encode(i, false)));
+			REQUIRE(!paths_index.isCyclicNode(gbwt::Node::encode(i, true)));
+		}
+	}
 }
 
+
+TEST_CASE("Path index can find nodes visited more than once by a path") {
+
+    const string graph_str = R"(
+    	{
+    		"node": [
+    			{"id": 1, "sequence": "GGGG"},
+    			{"id": 2, "sequence": "AA"},
+    			{"id": 3, "sequence": "C"}
+    		],
+            "edge": [
+                {"from": 1, "to": 2},
+                {"from": 2, "to": 1},
+                {"from": 2, "to": 3}
+            ]
+    	}
+    )";
+
+	vg::Graph graph;
+	Utils::json2pb(graph, graph_str);
+
+	gbwt::Verbosity::set(gbwt::Verbosity::SILENT);
+    gbwt::GBWTBuilder gbwt_builder(gbwt::bit_length(gbwt::Node::encode(3, true)));
+
+    gbwt::vector_type gbwt_thread_1(5);
+    gbwt::vector_type gbwt_thread_2(2);
+   
+    gbwt_thread_1[0] = gbwt::Node::encode(1, false);
+    gbwt_thread_1[1] = gbwt::Node::encode(2, false);
+    gbwt_thread_1[2] = gbwt::Node::encode(1, false);
+    gbwt_thread_1[3] = gbwt::Node::encode(2, false);
+    gbwt_thread_1[4] = gbwt::Node::encode(3, false);
+
+    gbwt_thread_2[0] = gbwt::Node::encode(2, false);
+    gbwt_thread_2[1] = gbwt::Node::encode(3, false);
+
+    gbwt_builder.insert(gbwt_thread_1, true);
+    gbwt_builder.insert(gbwt_thread_2, true);
+
+    gbwt_builder.finish();
+
+    std::stringstream gbwt_stream;
+    gbwt_builder.index.serialize(gbwt_stream);
+
+    gbwt::GBWT gbwt_index;
+    gbwt_index.load(gbwt_stream);
+
+    gbwt::FastLocate r_index(gbwt_index);
+    PathsIndex paths_index(gbwt_index, r_index, graph);
+
+    REQUIRE(paths_index.bidirectional());
+
+    REQUIRE(paths_index.isCyclicNode(gbwt::Node::encode(1, false)));
+    REQUIRE(paths_index.isCyclicNode(gbwt::Node::encode(1, true)));
+    REQUIRE(paths_index.isCyclicNode(gbwt::Node::encode(2, false)));
+    REQUIRE(paths_index.isCyclicNode(gbwt::Node::encode(2, true)));
+    REQUIRE(!paths_index.isCyclicNode(gbwt::Node::encode(3, false)));
+    REQUIRE(!paths_index.isCyclicNode(gbwt::Node::encode(3, true)));
+}
@@ -0,0 +1,67 @@
+
+#include "catch.hpp"
+
+#include "../probability_matrix_view.hpp"
+#include "../utils.hpp"
+
+
+TEST_CASE("Probability matrix view contains reads with non-zero path probabilities") {
+
+    Utils::ColMatrixXd read_path_probs(4, 3);
+    read_path_probs << 0.5, 0.5, 0, 0, 0, 1, 0, 0.2, 0.8, 1, 0, 0;
+
+    Utils::RowVectorXd read_counts(1, 4);
+    read_counts << 1, 2, 3, 4;
+
+    ProbabilityMatrixView read_path_probs_view(read_path_probs, read_counts);
+
+    REQUIRE(read_path_probs_view.rows() == 4);
+    REQUIRE(read_path_probs_view.cols() == 3);
+    REQUIRE(Utils::doubleCompare(read_path_probs_view.totalReadCount(), 10));
+
+    for (uint32_t i = 0; i < read_path_probs.rows(); ++i) {
+
+        REQUIRE(Utils::doubleCompare(read_path_probs_view.readCount(i), read_counts(0, i)));
+
+        for (uint32_t j = 0; j < read_path_probs.cols(); ++j) {
+
+            REQUIRE(Utils::doubleCompare(read_path_probs_view(i, j), read_path_probs(i, j)));
+        }
+    }
+
+    SECTION("Probability matrix view of path subset excludes zero probability reads") {
+
+        ProbabilityMatrixView subset_read_path_probs_view(read_path_probs, read_counts, vector<uint32_t>({2, 1}));
+
+        REQUIRE(subset_read_path_probs_view.rows() == 3);
+        REQUIRE(subset_read_path_probs_view.cols() == 2);
+        REQUIRE(Utils::doubleCompare(subset_read_path_probs_view.totalReadCount(), 6));
+
+        REQUIRE(Utils::doubleCompare(subset_read_path_probs_view(0, 0), 0));
+        REQUIRE(Utils::doubleCompare(subset_read_path_probs_view(0, 1), 0.5));
+        REQUIRE(Utils::doubleCompare(subset_read_path_probs_view(1, 0), 1));
+        REQUIRE(Utils::doubleCompare(subset_read_path_probs_view(2, 0), 0.8));
+        REQUIRE(Utils::doubleCompare(subset_read_path_probs_view(2, 1), 0.2));
+        REQUIRE(Utils::doubleCompare(subset_read_path_probs_view.readCount(2), 3));
+
+        ProbabilityMatrixBuffer read_path_probs_buffer;
+        read_path_probs_view.gather(&read_path_probs_buffer);
+
+        REQUIRE(read_path_probs_buffer.read_path_probs.rows() == 4);
+        REQUIRE(read_path_probs_buffer.read_path_probs.cols() == 3);
+
+        subset_read_path_probs_view.gather(&read_path_probs_buffer);
+
+        REQUIRE(read_path_probs_buffer.read_path_probs.rows() == 4);
+        REQUIRE(read_path_probs_buffer.read_path_probs.cols() == 3);
+
+        Utils::ColMatrixXd expected_subset_read_path_probs(3, 2);
+        expected_subset_read_path_probs << 0, 0.5, 1, 0, 0.8, 0.2;
+
+        Utils::RowVectorXd expected_subset_read_counts(1, 3);
+        expected_subset_read_counts << 1, 2, 3;
+
+        REQUIRE(read_path_probs_buffer.read_path_probs.topLeftCorner(3, 2) == expected_subset_read_path_probs);
+        REQUIRE(read_path_probs_buffer.read_counts.head(3) == expected_subset_read_counts);
+    }
+}
@@ -181,3 +181,40 @@ TEST_CASE("Identical read path probabilities can be merged") {
 	REQUIRE(read_path_probs.pathProbs().front().second == vector<uint32_t>({0, 1}));
 }
 
+
+TEST_CASE("Read path probabilities can be serialized") {
+
+	spp::sparse_hash_map<uint32_t, uint32_t> clustered_path_index({{100, 0}, {200, 1}});
+	FragmentLengthDist fragment_length_dist(10, 2);
+
+	vector<AlignmentPath> alignment_paths;
+	alignment_paths.emplace_back(make_pair(gbwt::SearchState(), 0), false, 10, 10, 3);
+	alignment_paths.emplace_back(make_pair(gbwt::SearchState(), 0), false, 10, 10, numeric_limits<int32_t>::lowest());
+	
+	vector<vector<gbwt::size_type> > alignment_path_ids;
+	alignment_path_ids.emplace_back(vector<gbwt::size_type>({100, 200}));
+	alignment_path_ids.emplace_back(vector<gbwt::size_type>());
+
+	vector<PathInfo> paths(2, PathInfo(""));
+	paths.front().effective_length = 3;
+	paths.back().effective_length = 3;
+
+	ReadPathProbabilities read_path_probs(3, pow(10, -8));
+	read_path_probs.calcAlignPathProbs(alignment_paths, alignment_path_ids, clustered_path_index, paths, fragment_length_dist, false, 0);
+
+	stringstream serialize_sstream;
+	read_path_probs.serialize(&serialize_sstream);
+
+	ReadPathProbabilities read_path_probs_2;
+	read_path_probs_2.deserialize(&serialize_sstream);
+
+	REQUIRE(serialize_sstream.good());
+	REQUIRE(read_path_probs_2 == read_path_probs);
+
+	REQUIRE(read_path_probs_2.readCount() == 3);
+	REQUIRE(Utils::doubleCompare(read_path_probs_2.noiseProb(), 0.1));
+
+	REQUIRE(read_path_probs_2.pathProbs().size() == 1);
+	REQUIRE(Utils::doubleCompare(read_path_probs_2.pathProbs().front().first, 0.45));
+	REQUIRE(read_path_probs_2.pathProbs().front().second == vector<uint32_t>({0, 1}));
+}
@@ -10,6 +10,7 @@
 #include <sstream>
 #include <algorithm>
 #include <cmath>
+#include <random>
 
 #include "Eigen/Dense"
 #include "Eigen/Sparse"
@@ -57,6 +58,7 @@ namespace Utils {
     
     typedef Eigen::Matrix<bool, Eigen::Dynamic, Eigen::Dynamic, Eigen::ColMajor> ColMatrixXb;
     typedef Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic, Eigen::ColMajor> ColMatrixXd;
+    typedef Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic, Eigen::RowMajor> RowMatrixXd;
 
     typedef Eigen::SparseMatrix<bool, Eigen::ColMajor> ColSparseMatrixXb;
     typedef Eigen::SparseMatrix<double, Eigen::ColMajor> ColSparseMatrixXd;
@@ -118,6 +120,79 @@ namespace Utils {
         return round(min(static_cast<double>(numeric_limits<int32_t>::max()), max(static_cast<double>(numeric_limits<int32_t>::lowest()), value)));
     }
 
+    // SplitMix64 generator (https://prng.di.unimi.it/splitmix64.c).
+    inline uint64_t splitMix64(uint64_t * state) {
+
+        uint64_t value = (*state += 0x9e3779b97f4a7c15);
+        value = (value ^ (value >> 30)) * 0xbf58476d1ce4e5b9;
+        value = (value ^ (value >> 27)) * 0x94d049bb133111eb;
+
+        return (value ^ (value >> 31));
+    }
+
+    // Derive seed of an independent random number stream from a base seed 
+    // and a stream (counter) id.
+    inline uint64_t streamSeed(const uint64_t seed, const uint64_t stream_id) {
+
+        uint64_t state = stream_id;
+        state = seed ^ splitMix64(&state);
+
+        return splitMix64(&state);
+    }
+
+    // Derive base seed of independent random number streams from a
+    // generator. Streams derived from it using streamSeed therefore only
+    // depend on the generator and not on the number of threads.
+    inline uint64_t deriveStreamSeed(mt19937 * mt_rng) {
+
+        uint64_t seed = (*mt_rng)();
+        seed = (seed << 32) | (*mt_rng)();
+
+        return seed;
+    }
+
+    // Create Mersenne Twister generator of a random number stream (see
+    // streamSeed).
+    inline mt19937 streamMersenneTwister(const uint64_t seed, const uint64_t stream_id) {
+
+        const uint64_t stream_seed = streamSeed(seed, stream_id);
+
+        seed_seq stream_seed_seq({static_cast<uint32_t>(stream_seed), static_cast<uint32_t>(stream_seed >> 32)});
+        return mt19937(stream_seed_seq);
+    }
+
+    // Write (trivially copyable) value to binary stream.
+    template<class T>
+    inline void writeBinary(ostream * out_stream, const T & value) {
+
+        out_stream->write(reinterpret_cast<const char *>(&value), sizeof(T));
+    }
+
+    // Read (trivially copyable) value from binary stream.
+    template<class T>
+    inline T readBinary(istream * in_stream) {
+
+        T value;
+        in_stream->read(reinterpret_cast<char *>(&value), sizeof(T));
+
+        return value;
+    }
+
+    inline void writeBinaryString(ostream * out_stream, const string & value) {
+
+        assert(value.size() <= numeric_limits<uint32_t>::max());
+        writeBinary<uint32_t>(out_stream, value.size());
+        out_stream->write(value.data(), value.size());
+    }
+
+    inline string readBinaryString(istream * in_stream) {
+
+        string value(readBinary<uint32_t>(in_stream), ' ');
+        in_stream->read(&(value[0]), value.size());
+
+        return value;
+    }
+
     //------------------------------------------------------------------------------
 
     /*